@@ -3,7 +3,7 @@ set -e
 
 CC=${CC:-g++}
 CFLAGS="${CFLAGS} -x c++ -I src -Wno-writable-strings -Wno-write-strings"
-LDFLAGS="${LDFLAGS} -lm"
+LDFLAGS="${LDFLAGS} -lm -pthread"
 
 BUILD_DIR="build"
 BUILD_EXT=""
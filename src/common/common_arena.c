@@ -1,9 +1,25 @@
+static u64 arena_commit_size(ArenaFlags flags) {
+    return (flags & ArenaFlags_LargePages) ? os_large_page_size() : ARENA_COMMIT_SIZE;
+}
+
 internal Arena* arena_alloc_(ArenaParams params) {
   u64 page_size = params.page_size;
+  u64 page_commit = page_size;
+  ArenaFlags flags = params.flags;
   
   // allocate initial block
   void* base = params.optional_backing_buffer;
-  if (base == NULL) {
+  if (base != NULL) {
+    flags = ArenaFlags_ZERO;
+  } else if (flags & ArenaFlags_Reserve) {
+    u64 commit_size = arena_commit_size(flags);
+    page_size = AlignPow2(page_size, commit_size);
+    page_commit = commit_size;
+    base = (flags & ArenaFlags_LargePages) ? os_reserve_large(page_size) : os_reserve(page_size);
+    Assert(base != NULL);
+    b8 committed = os_commit(base, page_commit);
+    Assert(committed);
+  } else {
     base = os_allocate(page_size);
   }
   
@@ -14,27 +30,83 @@ internal Arena* arena_alloc_(ArenaParams params) {
       .current = arena,
       .free_stack = NULL,
       .page_offset = ARENA_HEADER_SIZE,
-      .page_size = params.page_size,
+      .page_size = page_size,
       .base_offset = 0,
+      .page_commit = page_commit,
+      .flags = flags,
+      .concurrent = NULL,
+      .next_overflow = NULL,
       .allocation_site_file = params.allocation_site_file,
       .allocation_site_line = params.allocation_site_line,
   };
   return arena;
 }
 
+// @note chunks of a concurrent arena go back with its range
+static void arena_release_page(Arena* page) {
+    if (page->concurrent != NULL) {
+        return;
+    }
+    if (page->flags & ArenaFlags_Reserve) {
+        os_release(page, page->page_size);
+    } else {
+        os_deallocate(page);
+    }
+}
+
 internal void arena_release(Arena* arena) {
     // @note assumes free pages are only marked on bottom
     for (Arena *x = arena->free_stack, *prev = NULL; x != NULL && x != arena; x = prev) {
         prev = x->prev;
-        os_deallocate(x);
+        arena_release_page(x);
     }
 
     for (Arena *x = arena, *prev = NULL; x != NULL; x = prev) {
         prev = x->prev;
-        os_deallocate(x);
+        arena_release_page(x);
     }
 }
 
+// carves a page of at least size off the range of concurrent
+static Arena* arena_concurrent_chunk(ArenaConcurrent* concurrent, u64 size) {
+    size = AlignPow2(Max(size, concurrent->chunk_size), arena_commit_size(concurrent->flags));
+    u64 offset = AtomicAddU64(&concurrent->offset, size);
+    bool overflow = offset + size > concurrent->reserve_size;
+
+    // @note chunks don't overlap, so threads commit their own without locking.
+    // once the range ran out they are reserved on their own, the range only
+    // keeps what threads push close together
+    u8* base = concurrent->base + offset;
+    if (overflow) {
+        base = (u8*)((concurrent->flags & ArenaFlags_LargePages) ? os_reserve_large(size) : os_reserve(size));
+        AssertAlways(base != NULL);
+    }
+    b8 committed = os_commit(base, size);
+    Assert(committed);
+    Arena* page = arena_alloc_((ArenaParams){
+        .page_size = size,
+        .flags = ArenaFlags_ZERO,
+        .optional_backing_buffer = base,
+        .allocation_site_file = (char*)__FILE__,
+        .allocation_site_line = __LINE__,
+    });
+    page->concurrent = concurrent;
+
+    // @note the exchange hands back the head when it lost the race
+    if (overflow) {
+        Arena* head = NULL;
+        for (;;) {
+            page->next_overflow = head;
+            Arena* before = (Arena*)AtomicCompareExchangePtr(&concurrent->overflow, head, page);
+            if (before == head) {
+                break;
+            }
+            head = before;
+        }
+    }
+    return page;
+}
+
 internal void* arena_push(Arena* arena, u64 size, u64 align) {
     Arena* current = arena->current;
     u64 page_offset_before = AlignPow2(current->page_offset, align);
@@ -53,6 +125,8 @@ internal void* arena_push(Arena* arena, u64 size, u64 align) {
             new_page->page_offset = ARENA_HEADER_SIZE;
             new_page->allocation_site_file = current->allocation_site_file;
             new_page->allocation_site_line = current->allocation_site_line;
+        } else if (current->concurrent != NULL) {
+            new_page = arena_concurrent_chunk(current->concurrent, AlignPow2(size + ARENA_HEADER_SIZE, align));
         } else {
             u64 new_page_size = current->page_size;
             if(size + ARENA_HEADER_SIZE > new_page_size) {
@@ -61,6 +135,8 @@ internal void* arena_push(Arena* arena, u64 size, u64 align) {
     
              new_page = arena_alloc_((ArenaParams){
                 .page_size = new_page_size,
+                .flags = current->flags,
+                .optional_backing_buffer = NULL,
                 .allocation_site_file = current->allocation_site_file,
                 .allocation_site_line = current->allocation_site_line
             });
@@ -75,6 +151,14 @@ internal void* arena_push(Arena* arena, u64 size, u64 align) {
         Assert(page_offset_after <= current->page_size); // @todo reserve across pages
     }
 
+    // commit reserved pages as they fill up, what's committed stays for reuse
+    if (page_offset_after > current->page_commit) {
+        u64 page_commit = Min(AlignPow2(page_offset_after, arena_commit_size(current->flags)), current->page_size);
+        b8 committed = os_commit((u8*)current + current->page_commit, page_commit - current->page_commit);
+        Assert(committed);
+        current->page_commit = page_commit;
+    }
+
     // push onto current page
     current->page_offset = page_offset_after;
     return (u8*)current + page_offset_before;
@@ -90,7 +174,7 @@ internal void arena_pop_to(Arena* arena, u64 offset) {
     // free pages if needed @note assumes free pages are only marked on bottom
     while (offset < current->base_offset + ARENA_HEADER_SIZE) {
         stack_pop_n(arena->current, prev);
-        os_deallocate(current);
+        arena_release_page(current);
         current = arena->current;
 
         Assert(!(offset > current->base_offset && offset < current->base_offset + ARENA_HEADER_SIZE));
@@ -126,4 +210,46 @@ internal Temp temp_begin(Arena* arena) {
 
 internal void temp_end(Temp temp) {
     arena_pop_to(temp.arena, temp.offset);
+}
+
+// concurrent arenas
+internal ArenaConcurrent* arena_concurrent_alloc(u64 reserve_size, u64 chunk_size, ArenaFlags flags) {
+    ArenaConcurrent* concurrent = (ArenaConcurrent*)os_allocate(sizeof(ArenaConcurrent));
+    u64 commit_size = arena_commit_size(flags);
+    *concurrent = (ArenaConcurrent){
+        .base = NULL,
+        .reserve_size = AlignPow2(reserve_size, commit_size),
+        .chunk_size = AlignPow2(Max(chunk_size, ARENA_HEADER_SIZE), commit_size),
+        .flags = flags,
+        .offset = 0,
+        .overflow = NULL,
+    };
+    concurrent->base = (u8*)((flags & ArenaFlags_LargePages) ? os_reserve_large(concurrent->reserve_size) : os_reserve(concurrent->reserve_size));
+    Assert(concurrent->base != NULL);
+    return concurrent;
+}
+
+static void arena_concurrent_release_overflow(ArenaConcurrent* concurrent) {
+    for (Arena *x = concurrent->overflow, *next = NULL; x != NULL; x = next) {
+        next = x->next_overflow;
+        os_release(x, x->page_size);
+    }
+    concurrent->overflow = NULL;
+}
+
+internal void arena_concurrent_release(ArenaConcurrent* concurrent) {
+    arena_concurrent_release_overflow(concurrent);
+    os_release(concurrent->base, concurrent->reserve_size);
+    os_deallocate(concurrent);
+}
+
+// @note the range stays committed for the next lanes, chunks that didn't fit
+// it are given back
+internal void arena_concurrent_clear(ArenaConcurrent* concurrent) {
+    arena_concurrent_release_overflow(concurrent);
+    concurrent->offset = 0;
+}
+
+internal Arena* arena_concurrent_lane(ArenaConcurrent* concurrent, u64 size) {
+    return arena_concurrent_chunk(concurrent, size + ARENA_HEADER_SIZE);
 }
\ No newline at end of file
@@ -2,15 +2,31 @@
 
 #define ARENA_HEADER_SIZE 128
 
+typedef enum ArenaFlags {
+    ArenaFlags_ZERO = 0,
+    // pages are address space reserved up front and committed as they fill
+    // up, so pushes stay contiguous until a page runs out
+    ArenaFlags_Reserve = 1 << 0,
+    // backs reserved pages with huge pages, fewer tlb misses for large
+    // structures that are walked at random
+    ArenaFlags_LargePages = 1 << 1,
+} ArenaFlags;
+
+// reserved pages are committed in steps of this, or of a large page
+#define ARENA_COMMIT_SIZE KB(64)
+
 typedef struct ArenaParams ArenaParams;
 struct ArenaParams
 {
     u64 page_size;
+    ArenaFlags flags;
     void *optional_backing_buffer;
     char *allocation_site_file;
     int allocation_site_line;
 };
 
+typedef struct ArenaConcurrent ArenaConcurrent;
+
 typedef struct Arena Arena;
 struct Arena
 {
@@ -23,6 +39,14 @@ struct Arena
     u64 page_size;
     u64 base_offset;
 
+    // how much of a reserved page is usable, page_size for the others
+    u64 page_commit;
+    ArenaFlags flags;
+    // set on lanes of a concurrent arena, their pages are its chunks
+    ArenaConcurrent* concurrent;
+    // chunks reserved on their own once the range ran out, see ArenaConcurrent
+    Arena* next_overflow;
+
     char *allocation_site_file;
     int allocation_site_line;
 };
@@ -38,8 +62,10 @@ struct Temp
 global u64 arena_default_page_size = KB(1);
 
 internal Arena *arena_alloc_(ArenaParams params);
-#define arena_alloc()               arena_alloc_((ArenaParams){.page_size = arena_default_page_size, .optional_backing_buffer = NULL, .allocation_site_file = (char*)__FILE__, .allocation_site_line = __LINE__})
-#define arena_alloc_ps(ps)          arena_alloc_((ArenaParams){.page_size = ps, .optional_backing_buffer = NULL, .allocation_site_file = (char*)__FILE__, .allocation_site_line = __LINE__})
+#define arena_alloc()               arena_alloc_((ArenaParams){.page_size = arena_default_page_size, .flags = ArenaFlags_ZERO, .optional_backing_buffer = NULL, .allocation_site_file = (char*)__FILE__, .allocation_site_line = __LINE__})
+#define arena_alloc_ps(ps)          arena_alloc_((ArenaParams){.page_size = ps, .flags = ArenaFlags_ZERO, .optional_backing_buffer = NULL, .allocation_site_file = (char*)__FILE__, .allocation_site_line = __LINE__})
+// @note ps is reserved per page, f is ArenaFlags_LargePages or ArenaFlags_ZERO
+#define arena_alloc_reserve(ps, f)  arena_alloc_((ArenaParams){.page_size = ps, .flags = IntToEnum(ArenaFlags, ArenaFlags_Reserve | (f)), .optional_backing_buffer = NULL, .allocation_site_file = (char*)__FILE__, .allocation_site_line = __LINE__})
 internal void arena_release(Arena *arena);
 
 internal void *arena_push(Arena *arena, u64 size, u64 align);
@@ -52,6 +78,40 @@ internal void  arena_clear(Arena *arena);
 internal Temp temp_begin(Arena *arena);
 internal void temp_end(Temp temp);
 
+// ============================================================================
+// concurrent arena
+// ============================================================================
+// a reserved range several threads push into at once. every thread pushes
+// into an arena of its own, a lane, whose pages are chunks taken off the range
+// with an atomic bump. the push macros work on lanes as usual and what the
+// threads pushed ends up in one range without merging.
+// lanes made one after the other on one thread are laid out in that order,
+// so as long as a lane's data fits its first chunk the layout doesn't depend
+// on how the threads were scheduled
+struct ArenaConcurrent
+{
+    u8* base;
+    u64 reserve_size;
+    u64 chunk_size;
+    ArenaFlags flags;
+
+    // bytes of the range handed out, bumped atomically
+    u64 offset;
+    // @note chunks that don't fit the range any more are reserved on their
+    // own and pushed here atomically, they go with the concurrent arena
+    Arena* overflow;
+};
+
+// @note chunks are multiples of the commit size, ArenaFlags_LargePages makes
+// that a large page
+internal ArenaConcurrent* arena_concurrent_alloc(u64 reserve_size, u64 chunk_size, ArenaFlags flags);
+internal void             arena_concurrent_release(ArenaConcurrent* concurrent);
+// @note the lanes are gone afterwards, expects none of them to be in use
+internal void             arena_concurrent_clear(ArenaConcurrent* concurrent);
+// a lane with room for at least size in its first chunk, can be called from
+// any thread. lanes go with their concurrent arena, only release or clear that
+internal Arena*           arena_concurrent_lane(ArenaConcurrent* concurrent, u64 size);
+
 // push helper macros
 #define push_array_no_zero_aligned(a, T, c, align)  (T*)arena_push((a), sizeof(T)*(c), (align))
 #define push_array_aligned(a, T, c, align)          (T*)memset(push_array_no_zero_aligned(a, T, c, align), 0, sizeof(T)*(c))
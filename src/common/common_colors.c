@@ -34,4 +34,238 @@ internal vec3_f32 hsl_to_rgb(vec3_f32 hsl) {
         case 5:  return make_3f32(l, p, q);
         default: return make_3f32(1,1,1);
     }
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// pixel formats
+// ============================================================================
+internal u64 pixel_format_size(PixelFormat format) {
+    switch (format) {
+        case PixelFormat_RGB32F:  return sizeof(vec3_f32);
+        case PixelFormat_RGBA16F: return 4*sizeof(u16);
+        case PixelFormat_RGBE8:   return 4;
+        default: NotImplemented;
+    }
+    return 0;
+}
+
+static u32 colors_bits_from_f32(f32 x) {
+    u32 bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+static f32 colors_f32_from_bits(u32 bits) {
+    f32 x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+internal u16 f16_from_f32(f32 x) {
+    u32 bits = colors_bits_from_f32(x);
+    u32 sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    u32 half;
+    if (bits >= (127 + 16) << 23) {
+        // overflows to inf, nans stay quiet nans
+        half = (bits > 255u << 23) ? 0x7e00 : 0x7c00;
+    } else if (bits < 113 << 23) {
+        // @note adding a float with the exponent of the smallest denormal
+        // rounds the mantissa into place
+        u32 magic = ((127 - 15) + (23 - 10) + 1) << 23;
+        half = colors_bits_from_f32(colors_f32_from_bits(bits) + colors_f32_from_bits(magic)) - magic;
+    } else {
+        u32 mantissa_odd = (bits >> 13) & 1;
+        bits += ((u32)(15 - 127) << 23) + 0xfff + mantissa_odd;
+        half = bits >> 13;
+    }
+    return (u16)(half | (sign >> 16));
+}
+
+internal f32 f32_from_f16(u16 x) {
+    u32 shifted_exponent = 0x7c00u << 13;
+    u32 bits = ((u32)x & 0x7fff) << 13;
+    u32 exponent = bits & shifted_exponent;
+
+    bits += (127 - 15) << 23;
+    if (exponent == shifted_exponent) {
+        bits += (128 - 16) << 23;
+    } else if (exponent == 0) {
+        // denormals are renormalized by the fpu
+        bits += 1 << 23;
+        bits = colors_bits_from_f32(colors_f32_from_bits(bits) - colors_f32_from_bits(113 << 23));
+    }
+    return colors_f32_from_bits(bits | (((u32)x & 0x8000) << 16));
+}
+
+internal void rgbe_from_3f32(u8* out_rgbe, vec3_f32 c) {
+    f32 max_component = Max(c.x, Max(c.y, c.z));
+    if (max_component < 1e-32f) {
+        out_rgbe[0] = out_rgbe[1] = out_rgbe[2] = out_rgbe[3] = 0;
+        return;
+    }
+
+    int exponent;
+    f32 normalize = (f32)frexp(max_component, &exponent)*256.f/max_component;
+    out_rgbe[0] = (u8)(c.x*normalize);
+    out_rgbe[1] = (u8)(c.y*normalize);
+    out_rgbe[2] = (u8)(c.z*normalize);
+    out_rgbe[3] = (u8)(exponent + 128);
+}
+
+internal vec3_f32 rgbe_to_3f32(const u8* rgbe) {
+    if (rgbe[3] == 0) {
+        return make_3f32(0.f, 0.f, 0.f);
+    }
+    f32 scale = (f32)ldexp(1.0, rgbe[3] - (128 + 8));
+    return make_3f32(rgbe[0]*scale, rgbe[1]*scale, rgbe[2]*scale);
+}
+
+#if COLORS_SSE2
+// splits 4 pixels into a register per channel
+static void colors_load_4x3f32(const vec3_f32* pixels, __m128* r, __m128* g, __m128* b) {
+    const f32* p = (const f32*)pixels;
+    __m128 a = _mm_loadu_ps(p + 0); // r0 g0 b0 r1
+    __m128 c = _mm_loadu_ps(p + 4); // g1 b1 r2 g2
+    __m128 d = _mm_loadu_ps(p + 8); // b2 r3 g3 b3
+
+    __m128 r2g2r3g3 = _mm_shuffle_ps(c, d, _MM_SHUFFLE(2, 1, 3, 2));
+    __m128 g0b0g1b1 = _mm_shuffle_ps(a, c, _MM_SHUFFLE(1, 0, 2, 1));
+    *r = _mm_shuffle_ps(a, r2g2r3g3, _MM_SHUFFLE(2, 0, 3, 0));
+    *g = _mm_shuffle_ps(g0b0g1b1, r2g2r3g3, _MM_SHUFFLE(3, 1, 2, 0));
+    *b = _mm_shuffle_ps(g0b0g1b1, d, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+static __m128i colors_select_si128(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// f16_from_f32 on 4 lanes, the halves end up in the low bits of each lane
+static __m128i colors_f16_from_f32_sse2(__m128 x) {
+    __m128i bits = _mm_castps_si128(x);
+    __m128i sign = _mm_and_si128(bits, _mm_set1_epi32((int)0x80000000u));
+    bits = _mm_xor_si128(bits, sign);
+
+    __m128i is_inf_nan = _mm_cmpgt_epi32(bits, _mm_set1_epi32(((127 + 16) << 23) - 1));
+    __m128i is_nan = _mm_cmpgt_epi32(bits, _mm_set1_epi32(255 << 23));
+    __m128i inf_nan = colors_select_si128(is_nan, _mm_set1_epi32(0x7e00), _mm_set1_epi32(0x7c00));
+
+    __m128i is_denormal = _mm_cmplt_epi32(bits, _mm_set1_epi32(113 << 23));
+    __m128i magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(bits), _mm_castsi128_ps(magic))), magic);
+
+    __m128i mantissa_odd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+    __m128i normal = _mm_add_epi32(bits, _mm_set1_epi32((int)((u32)(15 - 127) << 23) + 0xfff));
+    normal = _mm_srli_epi32(_mm_add_epi32(normal, mantissa_odd), 13);
+
+    __m128i half = colors_select_si128(is_denormal, denormal, normal);
+    half = colors_select_si128(is_inf_nan, inf_nan, half);
+    return _mm_or_si128(half, _mm_srli_epi32(sign, 16));
+}
+
+static void colors_pack_4x_rgba16f(u16* out, const vec3_f32* pixels) {
+    __m128 r, g, b;
+    colors_load_4x3f32(pixels, &r, &g, &b);
+
+    __m128i rg = _mm_or_si128(colors_f16_from_f32_sse2(r), _mm_slli_epi32(colors_f16_from_f32_sse2(g), 16));
+    __m128i ba = _mm_or_si128(colors_f16_from_f32_sse2(b), _mm_set1_epi32(0x3c00 << 16));
+    _mm_storeu_si128((__m128i*)(out + 0), _mm_unpacklo_epi32(rg, ba));
+    _mm_storeu_si128((__m128i*)(out + 8), _mm_unpackhi_epi32(rg, ba));
+}
+
+// @note matches rgbe_from_3f32, frexp(max)*256/max is the power of two
+// 2^(134 - biased exponent of max) so it's built from the exponent bits
+static void colors_pack_4x_rgbe8(u8* out, const vec3_f32* pixels) {
+    __m128 r, g, b;
+    colors_load_4x3f32(pixels, &r, &g, &b);
+
+    __m128 max_component = _mm_max_ps(r, _mm_max_ps(g, b));
+    __m128i is_zero = _mm_castps_si128(_mm_cmplt_ps(max_component, _mm_set1_ps(1e-32f)));
+    __m128i exponent = _mm_srli_epi32(_mm_slli_epi32(_mm_castps_si128(max_component), 1), 24);
+    __m128 normalize = _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(261), exponent), 23));
+
+    __m128i rgbe = _mm_cvttps_epi32(_mm_mul_ps(r, normalize));
+    rgbe = _mm_or_si128(rgbe, _mm_slli_epi32(_mm_cvttps_epi32(_mm_mul_ps(g, normalize)), 8));
+    rgbe = _mm_or_si128(rgbe, _mm_slli_epi32(_mm_cvttps_epi32(_mm_mul_ps(b, normalize)), 16));
+    rgbe = _mm_or_si128(rgbe, _mm_slli_epi32(_mm_add_epi32(exponent, _mm_set1_epi32(2)), 24));
+    _mm_storeu_si128((__m128i*)out, _mm_andnot_si128(is_zero, rgbe));
+}
+#endif
+
+internal void pack_pixels(PixelFormat format, void* out, const vec3_f32* pixels, u64 count) {
+    u64 i = 0;
+    switch (format) {
+        case PixelFormat_RGB32F: {
+            memcpy(out, pixels, sizeof(vec3_f32)*count);
+            i = count;
+        } break;
+        case PixelFormat_RGBA16F: {
+            u16* halves = (u16*)out;
+#if COLORS_SSE2
+            for (; i + 4 <= count; i += 4) {
+                colors_pack_4x_rgba16f(&halves[i*4], &pixels[i]);
+            }
+#endif
+            for (; i < count; i++) {
+                halves[i*4 + 0] = f16_from_f32(pixels[i].x);
+                halves[i*4 + 1] = f16_from_f32(pixels[i].y);
+                halves[i*4 + 2] = f16_from_f32(pixels[i].z);
+                halves[i*4 + 3] = 0x3c00;
+            }
+        } break;
+        case PixelFormat_RGBE8: {
+            u8* rgbe = (u8*)out;
+#if COLORS_SSE2
+            for (; i + 4 <= count; i += 4) {
+                colors_pack_4x_rgbe8(&rgbe[i*4], &pixels[i]);
+            }
+#endif
+            for (; i < count; i++) {
+                rgbe_from_3f32(&rgbe[i*4], pixels[i]);
+            }
+        } break;
+        default: NotImplemented;
+    }
+}
+
+internal void unpack_pixels(PixelFormat format, vec3_f32* out, const void* pixels, u64 count) {
+    switch (format) {
+        case PixelFormat_RGB32F: {
+            memcpy(out, pixels, sizeof(vec3_f32)*count);
+        } break;
+        case PixelFormat_RGBA16F: {
+            const u16* halves = (const u16*)pixels;
+            for EachIndex(i, count) {
+                out[i] = make_3f32(f32_from_f16(halves[i*4 + 0]), f32_from_f16(halves[i*4 + 1]), f32_from_f16(halves[i*4 + 2]));
+            }
+        } break;
+        case PixelFormat_RGBE8: {
+            const u8* rgbe = (const u8*)pixels;
+            for EachIndex(i, count) {
+                out[i] = rgbe_to_3f32(&rgbe[i*4]);
+            }
+        } break;
+        default: NotImplemented;
+    }
+}
+
+internal void convert_pixels(PixelFormat out_format, void* out, PixelFormat format, const void* pixels, u64 count) {
+    if (out_format == format) {
+        memcpy(out, pixels, pixel_format_size(format)*count);
+    } else if (format == PixelFormat_RGB32F) {
+        pack_pixels(out_format, out, (const vec3_f32*)pixels, count);
+    } else if (out_format == PixelFormat_RGB32F) {
+        unpack_pixels(format, (vec3_f32*)out, pixels, count);
+    } else {
+        // @note goes through f32 a chunk at a time so there's no full copy
+        vec3_f32 chunk[PIXELS_CONVERT_CHUNK];
+        u64 in_size = pixel_format_size(format);
+        u64 out_size = pixel_format_size(out_format);
+        for (u64 i = 0; i < count; i += PIXELS_CONVERT_CHUNK) {
+            u64 n = Min(count - i, (u64)PIXELS_CONVERT_CHUNK);
+            unpack_pixels(format, chunk, (const u8*)pixels + i*in_size, n);
+            pack_pixels(out_format, (u8*)out + i*out_size, chunk, n);
+        }
+    }
+}
@@ -1,3 +1,37 @@
 #pragma once
 
-internal vec3_f32 hsl_to_rgb(vec3_f32 hsl);
\ No newline at end of file
+internal vec3_f32 hsl_to_rgb(vec3_f32 hsl);
+
+// ============================================================================
+// pixel formats
+// ============================================================================
+// compact pixels for framebuffers that are only written out, rgbe shares one
+// exponent between the channels like radiance .hdr files do
+typedef enum PixelFormat {
+    // vec3_f32, 12 bytes
+    PixelFormat_RGB32F,
+    // half floats with alpha 1, 8 bytes
+    PixelFormat_RGBA16F,
+    // u8 mantissas and a shared exponent, 4 bytes
+    PixelFormat_RGBE8,
+    PixelFormat_Count ENUM_CASE_UNUSED,
+} PixelFormat;
+
+#if ARCH_X64
+    #include <emmintrin.h>
+    #define COLORS_SSE2 1
+#endif
+
+// pixels are converted in chunks of this many when neither side is f32
+#define PIXELS_CONVERT_CHUNK 64
+
+internal u64      pixel_format_size(PixelFormat format);
+// rounds to nearest even, too large values become inf
+internal u16      f16_from_f32(f32 x);
+internal f32      f32_from_f16(u16 x);
+// @note the same rounding as stb_image_write
+internal void     rgbe_from_3f32(u8* out_rgbe, vec3_f32 c);
+internal vec3_f32 rgbe_to_3f32(const u8* rgbe);
+internal void     pack_pixels(PixelFormat format, void* out, const vec3_f32* pixels, u64 count);
+internal void     unpack_pixels(PixelFormat format, vec3_f32* out, const void* pixels, u64 count);
+internal void     convert_pixels(PixelFormat out_format, void* out, PixelFormat format, const void* pixels, u64 count);
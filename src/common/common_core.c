@@ -35,4 +35,21 @@
     }
 #else
     #error Compiler not supported.
-#endif
\ No newline at end of file
+#endif
+
+internal u32 reverse_bits_u32(u32 x) {
+#if COMPILER_CLANG
+    return __builtin_bitreverse32(x);
+#else
+    #if COMPILER_GCC
+    x = __builtin_bswap32(x);
+    #else
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    #endif
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+#endif
+}
@@ -158,6 +158,16 @@ typedef double   f64;
     #define force_inline
 #endif
 
+// @note promises the pointer is the only way its memory is accessed in scope,
+// lets loops over several arrays vectorize without runtime overlap checks
+#if COMPILER_MSVC
+    #define restrict_ptr __restrict
+#elif COMPILER_CLANG || COMPILER_GCC
+    #define restrict_ptr __restrict__
+#else
+    #define restrict_ptr
+#endif
+
 // linkage
 
 #if OS_WEB && COMPILER_CLANG
@@ -187,6 +197,36 @@ typedef double   f64;
     #error no_inline not defined for this compiler.
 #endif
 
+// @note hint only, the address may be invalid
+#if COMPILER_MSVC && (ARCH_X64 || ARCH_X86)
+    #include <xmmintrin.h>
+    #define Prefetch(ptr) _mm_prefetch((const char*)(ptr), _MM_HINT_T0)
+#elif COMPILER_CLANG || COMPILER_GCC
+    #define Prefetch(ptr) __builtin_prefetch((ptr), 0, 3)
+#else
+    #define Prefetch(ptr) (void)(ptr)
+#endif
+
+// @note returns the value from before, no ordering with other memory
+#if COMPILER_MSVC
+    #include <intrin.h>
+    #define AtomicAddU64(ptr, v) ((u64)_InterlockedExchangeAdd64((volatile __int64*)(ptr), (__int64)(v)))
+#elif COMPILER_CLANG || COMPILER_GCC
+    #define AtomicAddU64(ptr, v) __atomic_fetch_add((ptr), (u64)(v), __ATOMIC_RELAXED)
+#else
+    #error AtomicAddU64 not defined for this compiler.
+#endif
+
+// @note returns the value from before, *ptr is desired now if that was
+// expected. a full barrier
+#if COMPILER_MSVC
+    #define AtomicCompareExchangePtr(ptr, expected, desired) _InterlockedCompareExchangePointer((void* volatile*)(ptr), (void*)(desired), (void*)(expected))
+#elif COMPILER_CLANG || COMPILER_GCC
+    #define AtomicCompareExchangePtr(ptr, expected, desired) __sync_val_compare_and_swap((ptr), (expected), (desired))
+#else
+    #error AtomicCompareExchangePtr not defined for this compiler.
+#endif
+
 #if COMPILER_CLANG
     #define ENUM_CASE_UNUSED [[maybe_unused]]
 #else
@@ -275,4 +315,5 @@ typedef double   f64;
 
 // bit bashing
 internal u64 count_ones_u64(u64 x);
-internal u64 count_leading_zeros_u64(u64 x);
\ No newline at end of file
+internal u64 count_leading_zeros_u64(u64 x);
+internal u32 reverse_bits_u32(u32 x);
\ No newline at end of file
@@ -13,7 +13,8 @@ internal void thread_release() {
     }
 
     for EachElement(i, ctx->arenas) {
-        ctx->arenas[i] = arena_alloc();
+        arena_release(ctx->arenas[i]);
+        ctx->arenas[i] = NULL;
     }
     thread_local_ctx = NULL;
 }
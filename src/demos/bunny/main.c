@@ -11,68 +11,96 @@ static RT_Handle add_lambertian_billboard_material(RT_World* world, vec3_f32 alb
     return mat;
 }
 
-static RT_Handle add_mesh(RT_World* world, const MS_Mesh* ms_mesh, NTString8 name) {
-    RT_Handle rt_mesh = rt_world_add_mesh(world);
-    RT_Mesh* rt_mesh_ptr = rt_world_resolve_mesh(world, rt_mesh);
-    rt_mesh_ptr->vertices = ms_mesh->vertices;
-    rt_mesh_ptr->vertices_count = ms_mesh->vertices_count;
-    rt_mesh_ptr->indices = ms_mesh->indices;
-    rt_mesh_ptr->indices_count = ms_mesh->indices_count;
-    rt_mesh_ptr->primitive = ms_mesh->primitive;
-    rt_mesh_ptr->attrs = ms_mesh->attrs;
+typedef struct BunnyLoad BunnyLoad;
+struct BunnyLoad {
+    Arena* arena;
+    MS_LoadSettings settings;
+    RT_Mesh* mesh;
+    OS_FileMap file;
+};
+
+// maps the mesh converted from the obj before or converts it, then fills in
+// the mesh its blas is built from
+static void load_bunny(void* data) {
+    BunnyLoad* load = (BunnyLoad*)data;
+    MS_LoadResult asset = ms_convert_obj(load->arena, ntstr8_lit("data/bunny.obj"), ntstr8_lit("data/bunny.mesh"), load->settings, &load->file);
+    Assert(asset.error.length == 0);
+
+    RT_Mesh* mesh = load->mesh;
+    mesh->vertices = asset.v.vertices;
+    mesh->vertices_count = asset.v.vertices_count;
+    mesh->indices = asset.v.indices;
+    mesh->indices_count = asset.v.indices_count;
+    mesh->primitive = asset.v.primitive;
+    mesh->attrs = asset.v.attrs;
 #if BUILD_DEBUG
-    rt_mesh_ptr->name = name;
+    mesh->name = ntstr8_lit("bunny");
 #endif
-    return rt_mesh;
-}
-
-static void add_instance(RT_World* world, RT_Handle mesh, RT_Handle mat) {
-    RT_Handle instance = rt_world_add_instance(world);
-    RT_Instance* instance_ptr = rt_world_resolve_instance(world, instance);
-    instance_ptr->type = RT_InstanceType_Mesh;
-    instance_ptr->material = mat;
-    instance_ptr->mesh.handle = mesh;
-    instance_ptr->mesh.rotation = make_identity_quat();
-    instance_ptr->mesh.scale = make_scale_3f32(1.f);
 }
 
 demo_hook void render(const DEMO_Settings* settings) {
     {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
-        MS_LoadResult bunny_asset = ms_load_obj(
-            scratch.arena,
-            ntstr8_lit("data/bunny.obj"),
-            (MS_LoadSettings){
-                .primitive=GEO_Primitive_TRI_LIST,
-                .attrs=GEO_VertexAttributes_PN
-            }
-        );
-        Assert(bunny_asset.error.length == 0);
+        MS_LoadSettings load_settings = {
+            .primitive=GEO_Primitive_TRI_LIST,
+            .attrs=GEO_VertexAttributes_PN
+        };
 
-        {DeferResource(RT_World* world = rt_make_world((RT_WorldSettings){}), rt_world_cleanup(world)) {
-            RT_TracerSettings tsettings = get_rt_tracer_settings(settings, (DEMO_ExtraTracerSettings){});
-            {DeferResource(RT_Handle tracer = rt_make_tracer(tsettings), rt_tracer_cleanup(tracer)) {
-                RT_Handle bunny_mesh = add_mesh(world, &bunny_asset.v, ntstr8_lit("bunny"));
-                
-                rt_tracer_build_blas(tracer, world);
+        // @note a scene exported as data/bunny.glb is used as it is, otherwise
+        // the obj is converted once and later runs map the mesh file until
+        // the obj changes
+        OS_FileMap scene_file;
+        MS_SceneLoadResult scene = ms_load_gltf(scratch.arena, ntstr8_lit("data/bunny.glb"), load_settings, &scene_file);
 
-                RT_Handle white = add_lambertian_billboard_material(world, make_scale_3f32(0.73));
-                add_instance(world, bunny_mesh, white);
+        // @note not scratch, the load may run on a thread that is waiting on
+        // the graph and resets its scratch arenas
+        {DeferResource(Arena* mesh_arena = arena_alloc(), arena_release(mesh_arena)) {
+            BunnyLoad load = {.arena = mesh_arena, .settings = load_settings};
+            {DeferResource(RT_World* world = rt_make_world((RT_WorldSettings){}), rt_world_cleanup(world)) {
+                RT_TracerSettings tsettings = get_rt_tracer_settings(settings, (DEMO_ExtraTracerSettings){});
+                {DeferResource(RT_Handle tracer = rt_make_tracer(tsettings), rt_tracer_cleanup(tracer)) {
+                    RT_Handle white = add_lambertian_billboard_material(world, make_scale_3f32(0.73));
 
-                rt_tracer_build_tlas(tracer, world);
+                    // @note the mesh is added empty and filled in by the load
+                    RT_Handle bunny = zero_struct;
+                    if (scene.error.length > 0) {
+                        bunny = rt_world_add_mesh(world);
+                        load.mesh = rt_world_resolve_mesh(world, bunny);
+
+                        RT_Instance* instance = rt_world_resolve_instance(world, rt_world_add_instance(world));
+                        instance->type = RT_InstanceType_Mesh;
+                        instance->material = white;
+                        instance->mesh.handle = bunny;
+                        instance->mesh.translation = zero_struct;
+                        instance->mesh.rotation = make_identity_quat();
+                        instance->mesh.scale = make_scale_3f32(1.f);
+                    } else {
+                        add_scene(world, &scene.v, white);
+                    }
+
+                    // @note the meshes of a scene build in parallel, the tlas
+                    // after the last one. the obj loads as a task of the graph
+                    // and its blas builds once it is done
+                    {DeferResource(Arena* graph_arena = arena_alloc(), arena_release(graph_arena)) {
+                        JOB_Graph graph = job_make_graph(graph_arena);
+                        rt_tracer_begin_build(tracer, world, &graph);
+                        if (load.mesh != NULL) {
+                            JOB_Task* loaded = job_task_make(&graph, load_bunny, &load);
+                            rt_tracer_schedule_blas(tracer, bunny, loaded);
+                            job_task_submit(loaded);
+                        }
+                        rt_tracer_schedule_tlas(tracer);
+                        job_graph_wait(&graph);
+                    }}
 
-                {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
-                    int width = settings->width, height = settings->height;
-                    vec3_f32* buffer = push_array(scratch.arena, vec3_f32, width*height);
-                    
                     RT_CastSettings csettings = get_rt_cast_settings(settings,
                         make_3f32(-0.3, 1.2, 3.5), make_3f32(-0.3, 1.2, 0),
                         (DEMO_ExtraCastSettings){.vfov=DegreesToRad(45)}
                     );
-                    rt_tracer_cast(tracer, csettings, buffer, width, height);
-
-                    stbi_write_hdr(settings->out.cstr, width, height, 3, &buffer[0].v[0]);
+                    cast_and_write(settings, tracer, csettings);
                 }}}
-            }}
-        }
+            }
+            os_unmap_file(load.file);
+        }}
+        os_unmap_file(scene_file);
     }}
-}
\ No newline at end of file
+}
@@ -209,18 +209,11 @@ demo_hook void render(const DEMO_Settings* settings) {
 
             rt_tracer_build_tlas(tracer, world);
 
-            {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
-                int width = settings->width, height = settings->height;
-                vec3_f32* buffer = push_array(scratch.arena, vec3_f32, width*height);
-                
-                RT_CastSettings csettings = get_rt_cast_settings(settings,
-                    make_3f32(0, 0, 2.4f*extents), make_3f32(0, 0, 0),
-                    (DEMO_ExtraCastSettings){.vfov=DegreesToRad(40)}
-                );
-                rt_tracer_cast(tracer, csettings, buffer, width, height);
-
-                stbi_write_hdr(settings->out.cstr, width, height, 3, &buffer[0].v[0]);
-            }}}
-        }}
+            RT_CastSettings csettings = get_rt_cast_settings(settings,
+                make_3f32(0, 0, 2.4f*extents), make_3f32(0, 0, 0),
+                (DEMO_ExtraCastSettings){.vfov=DegreesToRad(40)}
+            );
+            cast_and_write(settings, tracer, csettings);
+        }}}
     }
 }
\ No newline at end of file
@@ -0,0 +1,292 @@
+// ============================================================================
+// distributed rendering
+// ============================================================================
+// @note sockets may hand over less than asked for
+static bool distributed_read(OS_Handle socket, void* data, u64 size) {
+    u64 done = 0;
+    while (done < size) {
+        u64 read = os_socket_read(socket, (u8*)data + done, size - done);
+        if (read == 0) {
+            return false;
+        }
+        done += read;
+    }
+    return true;
+}
+
+static bool distributed_write(OS_Handle socket, const void* data, u64 size) {
+    return os_socket_write(socket, data, size) == size;
+}
+
+// hands tiles to one worker and places what comes back
+static void coordinator_worker_main(void* data) {
+    DEMO_CoordinatorWorker* worker = (DEMO_CoordinatorWorker*)data;
+    DEMO_Coordinator* coordinator = worker->coordinator;
+    ThreadCtx ctx;
+    thread_equip(&ctx);
+
+    int stride = coordinator->rect.x1 - coordinator->rect.x0;
+    bool ok = true;
+    while (ok) {
+        // @note with nothing left to hand out, tiles in flight on other
+        // workers may still come back
+        u32 idx = 0;
+        bool stop = false;
+        os_mutex_lock(coordinator->mutex);
+        for (;;) {
+            if (coordinator->retry_count > 0) {
+                idx = coordinator->retry[--coordinator->retry_count];
+                break;
+            }
+            if (coordinator->next_tile < coordinator->tile_count) {
+                idx = coordinator->next_tile++;
+                break;
+            }
+            if (coordinator->tiles_done == coordinator->tile_count) {
+                stop = true;
+                break;
+            }
+            os_condition_variable_wait(coordinator->cv, coordinator->mutex);
+        }
+        os_mutex_unlock(coordinator->mutex);
+        if (stop) {
+            break;
+        }
+
+        const RT_PixelRect* rect = &coordinator->rect;
+        int tile_x = rect->x0 + (int)(idx % coordinator->tiles_x)*DEMO_DISTRIBUTED_TILE_SIZE;
+        int tile_y = rect->y0 + (int)(idx / coordinator->tiles_x)*DEMO_DISTRIBUTED_TILE_SIZE;
+        DEMO_WorkTile tile = {
+            .x0 = tile_x,
+            .y0 = tile_y,
+            .x1 = Min(tile_x + DEMO_DISTRIBUTED_TILE_SIZE, rect->x1),
+            .y1 = Min(tile_y + DEMO_DISTRIBUTED_TILE_SIZE, rect->y1),
+        };
+
+        // @note rows go straight to their place in the image
+        ok = distributed_write(worker->socket, &tile, sizeof(tile));
+        for (int y = tile.y0; y < tile.y1 && ok; y++) {
+            vec3_f32* row = &coordinator->radiance[(u64)(y - rect->y0)*stride + (tile.x0 - rect->x0)];
+            ok = distributed_read(worker->socket, row, sizeof(vec3_f32)*(tile.x1 - tile.x0));
+        }
+
+        os_mutex_lock(coordinator->mutex);
+        if (ok) {
+            coordinator->tiles_done++;
+            coordinator->row_tiles_done[idx / coordinator->tiles_x]++;
+        } else {
+            coordinator->retry[coordinator->retry_count++] = idx;
+        }
+        os_condition_variable_broadcast(coordinator->cv);
+        os_mutex_unlock(coordinator->mutex);
+    }
+
+    if (ok) {
+        DEMO_WorkTile stop = {.x0 = -1, .y0 = -1, .x1 = -1, .y1 = -1};
+        distributed_write(worker->socket, &stop, sizeof(stop));
+    } else {
+        fprintf(stderr, "lost a worker, handing its tile to another one\n");
+    }
+
+    os_mutex_lock(coordinator->mutex);
+    coordinator->live_workers--;
+    os_condition_variable_broadcast(coordinator->cv);
+    os_mutex_unlock(coordinator->mutex);
+
+    thread_release();
+}
+
+// launches the workers and starts handing out tiles to every one that
+// connects, returns how many did
+static u32 coordinator_start(const DEMO_Settings* settings, DEMO_Coordinator* coordinator, Arena* arena) {
+    coordinator->path = ntstr8_concatenate(arena, settings->out, ntstr8_lit(".workers.sock"));
+    coordinator->listener = os_socket_listen(coordinator->path);
+    if (os_is_handle_zero(coordinator->listener)) {
+        fprintf(stderr, "can't listen on %s\n", coordinator->path.cstr);
+        return 0;
+    }
+
+    // workers get the arguments of the coordinator and split the cores
+    u32 worker_count = Min((u32)settings->workers, DEMO_DISTRIBUTED_MAX_WORKERS);
+    u32 threads = Max(os_logical_core_count()/worker_count, 1);
+    char** argv = push_array(arena, char*, settings->argc + 3);
+    for EachIndex(i, (u64)settings->argc) {
+        argv[i] = settings->argv[i];
+    }
+    argv[settings->argc + 0] = ntstr8_concatenate(arena, ntstr8_lit("--worker="), coordinator->path).cstr;
+    argv[settings->argc + 1] = push_array(arena, char, 32);
+    snprintf(argv[settings->argc + 1], 32, "--threads=%u", threads);
+    argv[settings->argc + 2] = NULL;
+
+    for EachIndexU32(i, worker_count) {
+        coordinator->processes[coordinator->launched] = os_process_launch(argv);
+        if (!os_is_handle_zero(coordinator->processes[coordinator->launched])) {
+            coordinator->launched++;
+        }
+    }
+
+    coordinator->mutex = os_mutex_alloc();
+    coordinator->cv = os_condition_variable_alloc();
+
+    // @note a worker that dies before it connects is noticed while polling
+    // the listener, it is waited on here and not again
+    bool exited[DEMO_DISTRIBUTED_MAX_WORKERS] = {0};
+    u32 alive = coordinator->launched;
+    while (coordinator->connected < alive) {
+        if (!os_socket_wait(coordinator->listener, 0.1)) {
+            for EachIndexU32(i, coordinator->launched) {
+                if (!exited[i] && os_process_poll(coordinator->processes[i])) {
+                    exited[i] = true;
+                    alive--;
+                }
+            }
+            continue;
+        }
+
+        DEMO_CoordinatorWorker* worker = &coordinator->workers[coordinator->connected];
+        worker->coordinator = coordinator;
+        worker->socket = os_socket_accept(coordinator->listener);
+        if (os_is_handle_zero(worker->socket)) {
+            continue;
+        }
+
+        os_mutex_lock(coordinator->mutex);
+        coordinator->live_workers++;
+        os_mutex_unlock(coordinator->mutex);
+        worker->thread = os_thread_launch(coordinator_worker_main, worker);
+        if (os_is_handle_zero(worker->thread)) {
+            // @note closing the socket has the worker stop, its exit is
+            // noticed like any other
+            os_mutex_lock(coordinator->mutex);
+            coordinator->live_workers--;
+            os_mutex_unlock(coordinator->mutex);
+            os_socket_close(worker->socket);
+            continue;
+        }
+        coordinator->connected++;
+    }
+
+    // the exited ones were already waited on
+    u32 waiting = 0;
+    for EachIndexU32(i, coordinator->launched) {
+        if (!exited[i]) {
+            coordinator->processes[waiting++] = coordinator->processes[i];
+        }
+    }
+    coordinator->launched = waiting;
+    return coordinator->connected;
+}
+
+// waits until a row of tiles is traced, false once no worker is left to trace it
+static bool coordinator_wait_row(DEMO_Coordinator* coordinator, u32 row) {
+    os_mutex_lock(coordinator->mutex);
+    while (coordinator->row_tiles_done[row] < coordinator->tiles_x && coordinator->live_workers > 0) {
+        os_condition_variable_wait(coordinator->cv, coordinator->mutex);
+    }
+    bool done = coordinator->row_tiles_done[row] == coordinator->tiles_x;
+    os_mutex_unlock(coordinator->mutex);
+    return done;
+}
+
+static void coordinator_finish(DEMO_Coordinator* coordinator) {
+    if (os_is_handle_zero(coordinator->listener)) {
+        return;
+    }
+    for EachIndexU32(i, coordinator->connected) {
+        os_thread_join(coordinator->workers[i].thread);
+        os_socket_close(coordinator->workers[i].socket);
+    }
+    // @note closing the listener turns away workers that connected too late
+    os_socket_close(coordinator->listener);
+    os_delete_file(coordinator->path);
+    for EachIndexU32(i, coordinator->launched) {
+        os_process_wait(coordinator->processes[i]);
+    }
+    os_condition_variable_release(coordinator->cv);
+    os_mutex_release(coordinator->mutex);
+}
+
+void cast_distributed(const DEMO_Settings* settings) {
+    {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
+        DEMO_Coordinator* coordinator = push_array(scratch.arena, DEMO_Coordinator, 1);
+        coordinator->rect = (RT_PixelRect){.x0 = 0, .y0 = 0, .x1 = settings->width, .y1 = settings->height};
+        if (settings->crop) {
+            coordinator->rect = settings->crop_window;
+        }
+        int out_width = coordinator->rect.x1 - coordinator->rect.x0;
+        int out_height = coordinator->rect.y1 - coordinator->rect.y0;
+        coordinator->radiance = push_array(scratch.arena, vec3_f32, (u64)out_width*out_height);
+        coordinator->tiles_x = (u32)(out_width + DEMO_DISTRIBUTED_TILE_SIZE - 1)/DEMO_DISTRIBUTED_TILE_SIZE;
+        coordinator->tiles_y = (u32)(out_height + DEMO_DISTRIBUTED_TILE_SIZE - 1)/DEMO_DISTRIBUTED_TILE_SIZE;
+        coordinator->tile_count = coordinator->tiles_x*coordinator->tiles_y;
+        coordinator->retry = push_array(scratch.arena, u32, coordinator->tile_count);
+        coordinator->row_tiles_done = push_array(scratch.arena, u32, coordinator->tiles_y);
+
+        f64 start = os_now_seconds();
+        u32 connected = coordinator_start(settings, coordinator, scratch.arena);
+
+        // @note streamed rows of tiles are written as soon as they are traced
+        u64 pixel_size = pixel_format_size(settings->framebuffer);
+        IMG_Writer writer;
+        bool writing = settings->stream || settings->framebuffer != PixelFormat_RGB32F;
+        bool ok = !writing || img_writer_begin(&writer, scratch.arena, settings->out, img_format_from_path(settings->out), out_width, out_height);
+        u8* pixels = push_array_no_zero(scratch.arena, u8, pixel_size*out_width*(settings->stream ? DEMO_DISTRIBUTED_TILE_SIZE : out_height));
+        bool complete = connected > 0;
+        for (u32 row = 0; row < coordinator->tiles_y && complete; row++) {
+            complete = coordinator_wait_row(coordinator, row);
+            if (complete && ok && settings->stream) {
+                int y0 = (int)row*DEMO_DISTRIBUTED_TILE_SIZE;
+                int rows = Min(DEMO_DISTRIBUTED_TILE_SIZE, out_height - y0);
+                pack_pixels(settings->framebuffer, pixels, &coordinator->radiance[(u64)y0*out_width], (u64)out_width*rows);
+                img_writer_write_rows(&writer, settings->framebuffer, pixels, rows);
+            }
+        }
+        coordinator_finish(coordinator);
+
+        if (complete) {
+            fprintf(stderr, "traced %u tiles on %u workers in %.3fs\n", coordinator->tile_count, connected, os_now_seconds() - start);
+            if (!writing) {
+                stbi_write_hdr(settings->out.cstr, out_width, out_height, 3, &coordinator->radiance[0].v[0]);
+            } else if (ok && !settings->stream) {
+                pack_pixels(settings->framebuffer, pixels, coordinator->radiance, (u64)out_width*out_height);
+                img_writer_write_rows(&writer, settings->framebuffer, pixels, out_height);
+            }
+        } else {
+            fprintf(stderr, "workers failed, %u of %u tiles traced\n", coordinator->tiles_done, coordinator->tile_count);
+        }
+        if (writing && !img_writer_end(&writer)) {
+            fprintf(stderr, "failed writing %s\n", settings->out.cstr);
+        }
+    }}
+}
+
+void work(const DEMO_Settings* settings, RT_Handle tracer, RT_CastSettings csettings) {
+    OS_Handle socket = os_socket_connect(settings->worker);
+    if (os_is_handle_zero(socket)) {
+        fprintf(stderr, "can't connect to %s\n", settings->worker.cstr);
+        return;
+    }
+
+    // @note partitions have to come out the same, adaptive rounds span the
+    // whole image
+    csettings.crop = true;
+    csettings.crop_buffer = true;
+    csettings.adaptive = false;
+    csettings.aovs = (RT_CastAOVs)zero_struct;
+
+    {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
+        vec3_f32* radiance = push_array_no_zero(scratch.arena, vec3_f32, DEMO_DISTRIBUTED_TILE_SIZE*DEMO_DISTRIBUTED_TILE_SIZE);
+
+        DEMO_WorkTile tile;
+        while (distributed_read(socket, &tile, sizeof(tile)) && tile.x0 >= 0) {
+            csettings.crop_window = (RT_PixelRect){.x0 = tile.x0, .y0 = tile.y0, .x1 = tile.x1, .y1 = tile.y1};
+            rt_tracer_cast(tracer, csettings, radiance, settings->width, settings->height);
+
+            u64 size = sizeof(vec3_f32)*(tile.x1 - tile.x0)*(tile.y1 - tile.y0);
+            if (!distributed_write(socket, radiance, size)) {
+                break;
+            }
+        }
+    }}
+    os_socket_close(socket);
+}
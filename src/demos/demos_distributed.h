@@ -0,0 +1,65 @@
+#pragma once
+
+// ============================================================================
+// distributed rendering
+// ============================================================================
+// the coordinator launches worker processes of the same demo with the same
+// arguments, they build the scene themselves and connect back to a local
+// socket. tiles are handed out to whichever worker is free and the traced
+// radiance of every tile is sent back and placed into the image. a tile
+// whose worker goes away is handed to another one.
+// samples are seeded by pixel and sample index alone, so the merged image is
+// the same however the tiles fall to the workers
+#define DEMO_DISTRIBUTED_TILE_SIZE 64
+#define DEMO_DISTRIBUTED_MAX_WORKERS 64
+
+// a tile to trace, all -1 tells the worker to stop
+typedef struct DEMO_WorkTile DEMO_WorkTile;
+struct DEMO_WorkTile {
+    s32 x0;
+    s32 y0;
+    s32 x1;
+    s32 y1;
+};
+
+typedef struct DEMO_Coordinator DEMO_Coordinator;
+
+typedef struct DEMO_CoordinatorWorker DEMO_CoordinatorWorker;
+struct DEMO_CoordinatorWorker {
+    DEMO_Coordinator* coordinator;
+    OS_Handle socket;
+    OS_Handle thread;
+};
+
+struct DEMO_Coordinator {
+    RT_PixelRect rect;
+    vec3_f32* radiance;
+    u32 tiles_x;
+    u32 tiles_y;
+    u32 tile_count;
+
+    NTString8 path;
+    OS_Handle listener;
+    OS_Handle processes[DEMO_DISTRIBUTED_MAX_WORKERS];
+    u32 launched;
+    DEMO_CoordinatorWorker workers[DEMO_DISTRIBUTED_MAX_WORKERS];
+    u32 connected;
+
+    // guarded by the mutex, the condition variable is signaled whenever a
+    // tile is done or a worker goes away
+    OS_Handle mutex;
+    OS_Handle cv;
+    u32 next_tile;
+    u32 tiles_done;
+    // tiles of workers that went away, handed out before new ones
+    u32* retry;
+    u32 retry_count;
+    u32* row_tiles_done;
+    u32 live_workers;
+};
+
+// renders the image on settings->workers processes and writes it out, the
+// coordinator doesn't build the scene
+void cast_distributed(const DEMO_Settings* settings);
+// traces the tiles the coordinator at settings->worker sends until it says stop
+void work(const DEMO_Settings* settings, RT_Handle tracer, RT_CastSettings csettings);
@@ -1,9 +1,13 @@
 #include "common/common_inc.c"
 #include "os/os_inc.c"
+#include "job/job.c"
 #include "geo/geo.c"
 #include "mesh/mesh.c"
 #include "lbvh/lbvh.c"
 #include "raytracer/raytracer_inc.c"
+#include "image/image.c"
+#include "demos/demos_server.c"
+#include "demos/demos_distributed.c"
 
 int main(int argc, char** argv) {
     ThreadCtx main_ctx;
@@ -18,11 +22,13 @@ int main(int argc, char** argv) {
         .height=DEFAULT_HEIGHT,
         .samples=1,
         .bounces=DEFAULT_BOUNCES,
+        .sampler=RT_SamplerType_Sobol,
+        .argc=argc,
+        .argv=argv,
     };
 
     // argument parsing
     int positional_i = 0;
-    int seed = 0;
     for (int i = 1; i < argc; i++) {
         NTString8 arg = make_ntstr8(argv[i], strlen(argv[i]));
         
@@ -62,8 +68,95 @@ int main(int argc, char** argv) {
             } else {
                 settings.bounces = (u8)bounces;
             }
+        } else if (ntstr8_eq(arg, ntstr8_lit("--interleave"))) {
+            settings.interleave = true;
+        } else if (ntstr8_eq(arg, ntstr8_lit("--no-roulette"))) {
+            settings.no_roulette = true;
+        } else if (ntstr8_eq(arg, ntstr8_lit("--no-nee"))) {
+            settings.no_nee = true;
+        } else if (ntstr8_eq(arg, ntstr8_lit("--light-power"))) {
+            settings.light_power = true;
+        } else if (ntstr8_eq(arg, ntstr8_lit("--large-pages"))) {
+            settings.large_pages = true;
+        } else if (ntstr8_begins_with(arg, "--adaptive")) {
+            if (sscanf(arg.cstr, "--adaptive=%f", &settings.adaptive_error) != 1 || settings.adaptive_error <= 0.f) {
+                fprintf(stderr, "invalid ERROR argument, must be > 0");
+                bad = true;
+            }
+        } else if (ntstr8_begins_with(arg, "--budget")) {
+            if (sscanf(arg.cstr, "--budget=%d", &settings.budget) != 1 || settings.budget <= 0) {
+                fprintf(stderr, "invalid BUDGET argument, must be > 0");
+                bad = true;
+            }
+        } else if (ntstr8_begins_with(arg, "--time")) {
+            if (sscanf(arg.cstr, "--time=%f", &settings.time) != 1 || settings.time <= 0.f) {
+                fprintf(stderr, "invalid SECONDS argument, must be > 0");
+                bad = true;
+            }
+        } else if (ntstr8_begins_with(arg, "--checkpoint=")) {
+            const char* path = arg.cstr + strlen("--checkpoint=");
+            settings.checkpoint = make_ntstr8((char*)path, strlen(path));
+        } else if (ntstr8_begins_with(arg, "--checkpoint-interval")) {
+            if (sscanf(arg.cstr, "--checkpoint-interval=%f", &settings.checkpoint_interval) != 1 || settings.checkpoint_interval <= 0.f) {
+                fprintf(stderr, "invalid INTERVAL argument, must be > 0");
+                bad = true;
+            }
+        } else if (ntstr8_begins_with(arg, "--serve=")) {
+            const char* path = arg.cstr + strlen("--serve=");
+            settings.serve = make_ntstr8((char*)path, strlen(path));
+        } else if (ntstr8_begins_with(arg, "--workers")) {
+            if (sscanf(arg.cstr, "--workers=%d", &settings.workers) != 1 || settings.workers <= 0) {
+                fprintf(stderr, "invalid WORKERS argument, must be > 0");
+                bad = true;
+            }
+        } else if (ntstr8_begins_with(arg, "--worker=")) {
+            const char* path = arg.cstr + strlen("--worker=");
+            settings.worker = make_ntstr8((char*)path, strlen(path));
+        } else if (ntstr8_begins_with(arg, "--sample-counts=")) {
+            const char* path = arg.cstr + strlen("--sample-counts=");
+            settings.sample_counts_out = make_ntstr8((char*)path, strlen(path));
+        } else if (ntstr8_begins_with(arg, "--albedo=")) {
+            const char* path = arg.cstr + strlen("--albedo=");
+            settings.albedo_out = make_ntstr8((char*)path, strlen(path));
+        } else if (ntstr8_begins_with(arg, "--normal=")) {
+            const char* path = arg.cstr + strlen("--normal=");
+            settings.normal_out = make_ntstr8((char*)path, strlen(path));
+        } else if (ntstr8_begins_with(arg, "--depth=")) {
+            const char* path = arg.cstr + strlen("--depth=");
+            settings.depth_out = make_ntstr8((char*)path, strlen(path));
+        } else if (ntstr8_eq(arg, ntstr8_lit("--denoise"))) {
+            settings.denoise = true;
+        } else if (ntstr8_eq(arg, ntstr8_lit("--progress"))) {
+            settings.progress = true;
+        } else if (ntstr8_eq(arg, ntstr8_lit("--stream"))) {
+            settings.stream = true;
+        } else if (ntstr8_eq(arg, ntstr8_lit("--framebuffer=f32"))) {
+            settings.framebuffer = PixelFormat_RGB32F;
+        } else if (ntstr8_eq(arg, ntstr8_lit("--framebuffer=half"))) {
+            settings.framebuffer = PixelFormat_RGBA16F;
+        } else if (ntstr8_eq(arg, ntstr8_lit("--framebuffer=rgbe"))) {
+            settings.framebuffer = PixelFormat_RGBE8;
+        } else if (ntstr8_begins_with(arg, "--threads")) {
+            if (sscanf(arg.cstr, "--threads=%d", &settings.threads) != 1 || settings.threads <= 0) {
+                fprintf(stderr, "invalid THREADS argument, must be > 0");
+                bad = true;
+            }
+        } else if (ntstr8_begins_with(arg, "--crop")) {
+            RT_PixelRect* w = &settings.crop_window;
+            if (sscanf(arg.cstr, "--crop=%d,%d,%d,%d", &w->x0, &w->y0, &w->x1, &w->y1) != 4 || w->x0 < 0 || w->y0 < 0 || w->x1 <= w->x0 || w->y1 <= w->y0) {
+                fprintf(stderr, "invalid crop window argument, must be X0,Y0,X1,Y1 with X0 < X1 and Y0 < Y1");
+                bad = true;
+            } else {
+                settings.crop = true;
+            }
+        } else if (ntstr8_eq(arg, ntstr8_lit("--sampler=random"))) {
+            settings.sampler = RT_SamplerType_Random;
+        } else if (ntstr8_eq(arg, ntstr8_lit("--sampler=sobol"))) {
+            settings.sampler = RT_SamplerType_Sobol;
+        } else if (ntstr8_eq(arg, ntstr8_lit("--sampler=bluenoise"))) {
+            settings.sampler = RT_SamplerType_BlueNoise;
         } else if (ntstr8_begins_with(arg, "--seed")) {
-            if (sscanf(arg.cstr, "--seed=%d", &seed) != 1) {
+            if (sscanf(arg.cstr, "--seed=%d", &settings.seed) != 1) {
                 fprintf(stderr, "invalid SEED argument");
                 bad = true;
             }
@@ -71,10 +164,14 @@ int main(int argc, char** argv) {
             fprintf(stderr, "invalid argument \"%s\", skipping\n", arg.cstr);
         }
     }
-    if (settings.out.length == 0) {
+    if (settings.out.length == 0 && settings.serve.length == 0) {
         fprintf(stderr, "missing required positional argument OUT\n");
         bad = true;
     }
+    if (settings.crop && (settings.crop_window.x1 > settings.width || settings.crop_window.y1 > settings.height)) {
+        fprintf(stderr, "crop window is outside of the image\n");
+        bad = true;
+    }
     if (help || bad) {
         if (bad)
             printf("\n");
@@ -88,16 +185,48 @@ int main(int argc, char** argv) {
             "   --height=HEIGHT     set the height of image to HEIGHT pixels. defaults to %d\n"
             "   --samples=SAMPLES   set the number of samples per pixel to SAMPLES x SAMPLES. defaults to 1\n"
             "   --bounces=BOUNCES   set the maximum number of ray bounces to BOUNCES. defaults to %d\n"
-            "   --seed=SEED         seed random number generators with SEED\n",
+            "   --seed=SEED         seed random number generators with SEED\n"
+            "   --sampler=SAMPLER   pick sample points with random, sobol or bluenoise. defaults to sobol\n"
+            "   --interleave        interleave the traversal of several primary rays to hide memory latency\n"
+            "   --no-roulette       trace every path to BOUNCES instead of terminating dim paths early\n"
+            "   --no-nee            only find lights by chance instead of sampling them directly\n"
+            "   --light-power       pick lights by power alone instead of their contribution to each point\n"
+            "   --large-pages       keep the bvhs in huge pages\n"
+            "   --adaptive=ERROR    keep sampling pixels until their relative error is below ERROR\n"
+            "   --budget=BUDGET     stop adaptive sampling after BUDGET samples per pixel on average. defaults to 4 x SAMPLES x SAMPLES\n"
+            "   --time=SECONDS      keep adding samples to every pixel until SECONDS have passed, instead of SAMPLES x SAMPLES\n"
+            "   --checkpoint=FILE   with --time, save the render to FILE as it goes and carry on from FILE if it has one\n"
+            "   --checkpoint-interval=INTERVAL save the render every INTERVAL seconds. defaults to 60\n"
+            "   --sample-counts=FILE write the number of samples taken per pixel to FILE\n"
+            "   --albedo=FILE       write the albedo of the surfaces seen by the camera to FILE\n"
+            "   --normal=FILE       write the normals of the surfaces seen by the camera to FILE\n"
+            "   --depth=FILE        write the distance to the surfaces seen by the camera to FILE\n"
+            "   --denoise           filter the noise out of the image, guided by its albedo, normals and depth\n"
+            "   --stream            write OUT band by band as it renders instead of holding the whole image, as .pfm if OUT ends in it. no aovs, denoising or --time\n"
+            "   --framebuffer=FORMAT hold the image as f32, half or rgbe pixels. defaults to f32, the others take no aovs, denoising or --time\n"
+            "   --progress          report the tiles done and rays per second while rendering\n"
+            "   --crop=X0,Y0,X1,Y1  only render pixels X0 to X1 and Y0 to Y1 (exclusive) of the image, OUT is cropped to them\n"
+            "   --threads=THREADS   run parallel work on THREADS threads. defaults to one per core\n"
+            "   --serve=SOCKET      keep the scene loaded and render the jobs sent to the unix socket SOCKET instead of OUT, see demos_server.h\n"
+            "   --workers=WORKERS   split the image into tiles traced by WORKERS processes of this demo. no aovs, denoising, adaptive or --time\n",
             DEFAULT_WIDTH, DEFAULT_HEIGHT, DEFAULT_BOUNCES
         );
         return !help;
     }
 
-    rand_seed((u64)seed);
+    rand_seed((u64)settings.seed);
+    // @note the calling thread works too
+    job_init((settings.threads > 0) ? (u32)settings.threads - 1 : 0);
 
-    // call demo hook
-    render(&settings);
+    // @note the coordinator only hands out tiles, workers build the scene
+    if (settings.workers > 0 && settings.worker.length == 0) {
+        cast_distributed(&settings);
+    } else {
+        // call demo hook
+        render(&settings);
+    }
+
+    job_shutdown();
     return 0;
 }
 
@@ -122,10 +251,18 @@ RT_CastSettings get_rt_cast_settings(const DEMO_Settings* settings, vec3_f32 eye
         .right=right,
         .viewport=make_3f32(focus_plane_height*aspect_ratio, focus_plane_height, focus_distance),
         .samples=settings->samples,
+        .sampler=settings->sampler,
+        .seed=(u32)settings->seed,
         .ior=1.f,
         .defocus=extra.defocus_angle > 0.f,
         .defocus_disk=make_2f32(defocus_radius, defocus_radius),
         .orthographic=extra.orthographic,
+        .adaptive=settings->adaptive_error > 0.f,
+        .adaptive_error=settings->adaptive_error,
+        .adaptive_budget=(settings->budget > 0) ? (u32)settings->budget : 4u*settings->samples*settings->samples,
+        .crop=settings->crop,
+        .crop_window=settings->crop_window,
+        .crop_buffer=true,
     };
 }
 
@@ -133,5 +270,215 @@ RT_TracerSettings get_rt_tracer_settings(const DEMO_Settings* settings, DEMO_Ext
     return (RT_TracerSettings){
         .max_bounces=settings->bounces,
         .sky=!extra.no_sky,
+        .traversal=settings->interleave ? RT_TraversalMode_Interleaved : RT_TraversalMode_Single,
+        .russian_roulette=!settings->no_roulette,
+        .next_event_estimation=!settings->no_nee,
+        .light_sampling=settings->light_power ? RT_LightSampling_Power : RT_LightSampling_Tree,
+        .large_pages=settings->large_pages,
     };
-}
\ No newline at end of file
+}
+
+void add_scene(RT_World* world, const MS_Scene* scene, RT_Handle material) {
+    {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
+        RT_Handle* meshes = push_array(scratch.arena, RT_Handle, scene->meshes_count);
+        for EachIndexU32(i, scene->meshes_count) {
+            const MS_Mesh* ms_mesh = &scene->meshes[i];
+            meshes[i] = rt_world_add_mesh(world);
+            RT_Mesh* mesh = rt_world_resolve_mesh(world, meshes[i]);
+            mesh->vertices = ms_mesh->vertices;
+            mesh->vertices_count = ms_mesh->vertices_count;
+            mesh->indices = ms_mesh->indices;
+            mesh->indices_count = ms_mesh->indices_count;
+            mesh->primitive = ms_mesh->primitive;
+            mesh->attrs = ms_mesh->attrs;
+#if BUILD_DEBUG
+            mesh->name = ntstr8_lit("scene");
+#endif
+        }
+
+        for EachIndexU32(i, scene->instances_count) {
+            const MS_SceneInstance* ms_instance = &scene->instances[i];
+            RT_Instance* instance = rt_world_resolve_instance(world, rt_world_add_instance(world));
+            instance->type = RT_InstanceType_Mesh;
+            instance->material = material;
+            instance->mesh.handle = meshes[ms_instance->mesh];
+            instance->mesh.translation = ms_instance->translation;
+            instance->mesh.rotation = ms_instance->rotation;
+            instance->mesh.scale = ms_instance->scale;
+        }
+    }}
+}
+
+static void print_progress(void* user_data, RT_CastProgress progress) {
+    fprintf(stderr, "\r%u/%u tiles, %.2f Mrays/s", progress.tiles_done, progress.tile_count, progress.rays_per_second/Million(1.0));
+    if (progress.tiles_done == progress.tile_count) {
+        fprintf(stderr, "\n");
+    }
+}
+
+typedef struct DEMO_BandWriter DEMO_BandWriter;
+struct DEMO_BandWriter {
+    IMG_Writer* writer;
+    PixelFormat format;
+};
+
+static void write_band(void* user_data, int y, int rows, const void* pixels) {
+    DEMO_BandWriter* band_writer = (DEMO_BandWriter*)user_data;
+    img_writer_write_rows(band_writer->writer, band_writer->format, pixels, rows);
+}
+
+void cast_and_write(const DEMO_Settings* settings, RT_Handle tracer, RT_CastSettings csettings) {
+    // @note workers get the arguments of the coordinator, --workers included
+    if (settings->worker.length > 0) {
+        work(settings, tracer, csettings);
+        return;
+    }
+    if (settings->serve.length > 0) {
+        serve(settings, tracer, csettings);
+        return;
+    }
+    if (settings->stream) {
+        cast_and_stream(settings, tracer, csettings);
+        return;
+    }
+    if (settings->framebuffer != PixelFormat_RGB32F) {
+        cast_and_pack(settings, tracer, csettings);
+        return;
+    }
+
+    {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
+        // @note the buffers only cover the crop window
+        int width = settings->width, height = settings->height;
+        int out_width = width, out_height = height;
+        if (csettings.crop) {
+            out_width = csettings.crop_window.x1 - csettings.crop_window.x0;
+            out_height = csettings.crop_window.y1 - csettings.crop_window.y0;
+        }
+        vec3_f32* buffer = push_array(scratch.arena, vec3_f32, out_width*out_height);
+
+        if (settings->sample_counts_out.length > 0) {
+            csettings.aovs.sample_count = push_array(scratch.arena, u32, out_width*out_height);
+        }
+        if (settings->denoise || settings->albedo_out.length > 0) {
+            csettings.aovs.albedo = push_array(scratch.arena, vec3_f32, out_width*out_height);
+        }
+        if (settings->denoise || settings->normal_out.length > 0) {
+            csettings.aovs.normal = push_array(scratch.arena, vec3_f32, out_width*out_height);
+        }
+        if (settings->denoise || settings->depth_out.length > 0) {
+            csettings.aovs.depth = push_array(scratch.arena, f32, out_width*out_height);
+        }
+        bool progressive = settings->time > 0.f;
+        if (settings->denoise && (settings->samples > 1 || csettings.adaptive || progressive)) {
+            csettings.aovs.variance = push_array(scratch.arena, f32, out_width*out_height);
+        }
+
+        if (progressive) {
+            bool checkpoint = settings->checkpoint.length > 0;
+            if (checkpoint) {
+                f64 interval = (settings->checkpoint_interval > 0.f) ? settings->checkpoint_interval : 60.0;
+                rt_tracer_set_checkpoint(tracer, settings->checkpoint, interval);
+            }
+            if (checkpoint && rt_tracer_resume_accumulation(tracer, csettings, width, height, settings->checkpoint)) {
+                printf("resumed from %s\n", settings->checkpoint.cstr);
+            } else {
+                rt_tracer_begin_accumulation(tracer, csettings, width, height);
+            }
+
+            u32 samples = rt_tracer_accumulate_for(tracer, settings->time);
+            if (checkpoint) {
+                rt_tracer_checkpoint(tracer);
+            }
+            rt_tracer_resolve_accumulation(tracer, buffer);
+            rt_tracer_end_accumulation(tracer);
+            printf("accumulated %u samples per pixel\n", samples);
+        } else if (settings->progress && !csettings.adaptive) {
+            RT_Handle job = rt_tracer_cast_async(tracer, csettings, buffer, width, height, print_progress, NULL);
+            rt_cast_wait(job);
+        } else {
+            rt_tracer_cast(tracer, csettings, buffer, width, height);
+        }
+
+        if (settings->denoise) {
+            RT_DenoiseSettings dsettings = {
+                .iterations=4,
+                .sigma_color=4.f,
+                .sigma_albedo=0.05f,
+                .sigma_normal=0.3f,
+                .sigma_depth=1.f,
+            };
+            rt_denoise(dsettings, buffer, csettings.aovs, buffer, out_width, out_height);
+        }
+
+        stbi_write_hdr(settings->out.cstr, out_width, out_height, 3, &buffer[0].v[0]);
+
+        if (settings->albedo_out.length > 0) {
+            stbi_write_hdr(settings->albedo_out.cstr, out_width, out_height, 3, &csettings.aovs.albedo[0].v[0]);
+        }
+        if (settings->normal_out.length > 0) {
+            stbi_write_hdr(settings->normal_out.cstr, out_width, out_height, 3, &csettings.aovs.normal[0].v[0]);
+        }
+        if (settings->depth_out.length > 0) {
+            stbi_write_hdr(settings->depth_out.cstr, out_width, out_height, 1, csettings.aovs.depth);
+        }
+
+        if (csettings.aovs.sample_count) {
+            f32* counts = push_array_no_zero(scratch.arena, f32, out_width*out_height);
+            for EachIndex(idx, out_width*out_height) {
+                counts[idx] = (f32)csettings.aovs.sample_count[idx];
+            }
+            stbi_write_hdr(settings->sample_counts_out.cstr, out_width, out_height, 1, counts);
+        }
+    }}
+}
+
+void cast_and_stream(const DEMO_Settings* settings, RT_Handle tracer, RT_CastSettings csettings) {
+    {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
+        int out_width = settings->width, out_height = settings->height;
+        if (csettings.crop) {
+            out_width = csettings.crop_window.x1 - csettings.crop_window.x0;
+            out_height = csettings.crop_window.y1 - csettings.crop_window.y0;
+        }
+
+        IMG_Writer writer;
+        if (!img_writer_begin(&writer, scratch.arena, settings->out, img_format_from_path(settings->out), out_width, out_height)) {
+            fprintf(stderr, "can't write to %s\n", settings->out.cstr);
+            img_writer_end(&writer);
+            return;
+        }
+
+        DEMO_BandWriter band_writer = {.writer=&writer, .format=settings->framebuffer};
+        RT_StreamSettings stream = {
+            .format=settings->framebuffer,
+            .write_band=write_band,
+            .user_data=&band_writer,
+        };
+        rt_tracer_cast_streamed(tracer, csettings, settings->width, settings->height, stream);
+
+        if (!img_writer_end(&writer)) {
+            fprintf(stderr, "failed writing %s\n", settings->out.cstr);
+        }
+    }}
+}
+
+void cast_and_pack(const DEMO_Settings* settings, RT_Handle tracer, RT_CastSettings csettings) {
+    {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
+        int out_width = settings->width, out_height = settings->height;
+        if (csettings.crop) {
+            out_width = csettings.crop_window.x1 - csettings.crop_window.x0;
+            out_height = csettings.crop_window.y1 - csettings.crop_window.y0;
+        }
+
+        u8* pixels = push_array_no_zero(scratch.arena, u8, pixel_format_size(settings->framebuffer)*out_width*out_height);
+        rt_tracer_cast_packed(tracer, csettings, settings->framebuffer, pixels, settings->width, settings->height);
+
+        IMG_Writer writer;
+        bool ok = img_writer_begin(&writer, scratch.arena, settings->out, img_format_from_path(settings->out), out_width, out_height);
+        if (ok) {
+            img_writer_write_rows(&writer, settings->framebuffer, pixels, out_height);
+        }
+        if (!img_writer_end(&writer)) {
+            fprintf(stderr, "failed writing %s\n", settings->out.cstr);
+        }
+    }}
+}
@@ -2,10 +2,12 @@
 
 #include "common/common_inc.h"
 #include "os/os_inc.h"
+#include "job/job.h"
 #include "geo/geo.h"
 #include "mesh/mesh.h"
 #include "lbvh/lbvh.h"
 #include "raytracer/raytracer_inc.h"
+#include "image/image.h"
 
 #include "tracing/tracing.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -20,7 +22,36 @@ struct DEMO_Settings {
     int         height;
     u8          samples;
     u8          bounces;
+    bool        interleave;
+    bool        no_roulette;
+    bool        no_nee;
+    bool        light_power;
+    bool        large_pages;
+    f32         adaptive_error;
+    int         budget;
+    f32         time;
+    f32         checkpoint_interval;
+    RT_SamplerType sampler;
+    int         seed;
+    bool        denoise;
+    bool        progress;
+    bool        stream;
+    PixelFormat framebuffer;
+    int         threads;
+    bool        crop;
+    RT_PixelRect crop_window;
     NTString8   out; 
+    NTString8   sample_counts_out;
+    NTString8   albedo_out;
+    NTString8   normal_out;
+    NTString8   depth_out;
+    NTString8   checkpoint;
+    NTString8   serve;
+    int         workers;
+    NTString8   worker;
+    // the command line, passed on to workers
+    int         argc;
+    char**      argv;
 };
 
 demo_hook void render(const DEMO_Settings* settings);
@@ -40,4 +71,19 @@ struct DEMO_ExtraTracerSettings {
     bool no_sky;
 };
 
-RT_TracerSettings get_rt_tracer_settings(const DEMO_Settings* settings, DEMO_ExtraTracerSettings extra);
\ No newline at end of file
+RT_TracerSettings get_rt_tracer_settings(const DEMO_Settings* settings, DEMO_ExtraTracerSettings extra);
+
+// adds the meshes of scene to world and every instance of them with material,
+// the meshes have to outlive the world
+void add_scene(RT_World* world, const MS_Scene* scene, RT_Handle material);
+
+// casts into a buffer of settings->width x settings->height and writes it and
+// any requested aovs out
+void cast_and_write(const DEMO_Settings* settings, RT_Handle tracer, RT_CastSettings csettings);
+// writes the image out as it's rendered, never holding more than a few bands of it
+void cast_and_stream(const DEMO_Settings* settings, RT_Handle tracer, RT_CastSettings csettings);
+// casts into a framebuffer of settings->framebuffer pixels and writes it out
+void cast_and_pack(const DEMO_Settings* settings, RT_Handle tracer, RT_CastSettings csettings);
+
+#include "demos/demos_server.h"
+#include "demos/demos_distributed.h"
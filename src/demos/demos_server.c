@@ -0,0 +1,297 @@
+// ============================================================================
+// render server
+// ============================================================================
+static void server_reply(DEMO_ServerClient* client, const char* format, ...) {
+    char reply[DEMO_SERVER_MAX_LINE];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(reply, sizeof(reply) - 1, format, args);
+    va_end(args);
+
+    length = Clamp(length, 0, (int)sizeof(reply) - 2);
+    reply[length++] = '\n';
+    os_socket_write(client->socket, reply, (u64)length);
+}
+
+// fills job from the arguments of a cast line, false with the reason in error
+static bool server_parse_job(const DEMO_Server* server, char* args, DEMO_ServerJob* job, const char** error) {
+    MemoryZeroStruct(job);
+    job->settings = *server->settings;
+    job->settings.crop = false;
+    // @note the other outputs of the command line would be overwritten by
+    // every job
+    job->settings.serve = (NTString8)zero_struct;
+    job->settings.checkpoint = (NTString8)zero_struct;
+    job->settings.sample_counts_out = (NTString8)zero_struct;
+    job->settings.albedo_out = (NTString8)zero_struct;
+    job->settings.normal_out = (NTString8)zero_struct;
+    job->settings.depth_out = (NTString8)zero_struct;
+
+    char* next;
+    for (char* arg = strtok_r(args, " \t", &next); arg != NULL; arg = strtok_r(NULL, " \t", &next)) {
+        DEMO_Settings* s = &job->settings;
+        RT_PixelRect* c = &s->crop_window;
+        int samples;
+        if (strncmp(arg, "out=", 4) == 0) {
+            snprintf(job->out, sizeof(job->out), "%s", arg + 4);
+        } else if (sscanf(arg, "width=%d", &s->width) == 1) {
+        } else if (sscanf(arg, "height=%d", &s->height) == 1) {
+        } else if (sscanf(arg, "seed=%d", &s->seed) == 1) {
+        } else if (sscanf(arg, "samples=%d", &samples) == 1) {
+            if (samples <= 0 || samples > 255) {
+                *error = "samples must be > 0 and <= 255";
+                return false;
+            }
+            s->samples = (u8)samples;
+        } else if (sscanf(arg, "eye=%f,%f,%f", &job->eye.x, &job->eye.y, &job->eye.z) == 3) {
+            job->has_eye = true;
+        } else if (sscanf(arg, "subject=%f,%f,%f", &job->subject.x, &job->subject.y, &job->subject.z) == 3) {
+            job->has_subject = true;
+        } else if (sscanf(arg, "crop=%d,%d,%d,%d", &c->x0, &c->y0, &c->x1, &c->y1) == 4) {
+            s->crop = true;
+        } else {
+            *error = "bad argument";
+            return false;
+        }
+    }
+
+    DEMO_Settings* s = &job->settings;
+    if (job->out[0] == '\0') {
+        *error = "missing out=FILE";
+        return false;
+    }
+    if (s->width <= 0 || s->height <= 0) {
+        *error = "width and height must be > 0";
+        return false;
+    }
+    if (s->width > DEMO_SERVER_MAX_SIZE || s->height > DEMO_SERVER_MAX_SIZE) {
+        *error = "width and height must be <= 16384";
+        return false;
+    }
+    if (s->crop && (s->crop_window.x0 < 0 || s->crop_window.y0 < 0 ||
+                    s->crop_window.x1 > s->width || s->crop_window.y1 > s->height ||
+                    s->crop_window.x0 >= s->crop_window.x1 || s->crop_window.y0 >= s->crop_window.y1)) {
+        *error = "crop window is outside of the image";
+        return false;
+    }
+    s->out = make_ntstr8(job->out, strlen(job->out));
+    return true;
+}
+
+// rebuilds the camera of the demo for job, the lens is recovered from the
+// cast settings the demo made
+static RT_CastSettings server_cast_settings(const DEMO_Server* server, const DEMO_ServerJob* job) {
+    const RT_CastSettings* base = &server->csettings;
+    f32 focus_distance = base->viewport.z;
+
+    DEMO_ExtraCastSettings extra = {
+        .defocus_angle = base->defocus ? 2.f*atan_f32(base->defocus_disk.x/focus_distance) : 0.f,
+        .orthographic = base->orthographic,
+        .vfov = 2.f*atan_f32(base->viewport.y/(2.f*focus_distance)),
+    };
+    vec3_f32 eye = job->has_eye ? job->eye : base->eye;
+    vec3_f32 subject = job->has_subject ? job->subject : add_3f32(base->eye, mul_3f32(base->forward, focus_distance));
+    return get_rt_cast_settings(&job->settings, eye, subject, extra);
+}
+
+static void server_client_main(void* data) {
+    DEMO_ServerClient* client = (DEMO_ServerClient*)data;
+    DEMO_Server* server = client->server;
+    ThreadCtx ctx;
+    thread_equip(&ctx);
+
+    char line[DEMO_SERVER_MAX_LINE];
+    u64 length = 0;
+    bool open = true;
+    while (open) {
+        u64 read = os_socket_read(client->socket, line + length, sizeof(line) - 1 - length);
+        if (read == 0) {
+            break;
+        }
+        length += read;
+
+        char* end;
+        while (open && (end = (char*)memchr(line, '\n', length)) != NULL) {
+            *end = '\0';
+            u64 consumed = (u64)(end - line) + 1;
+            if (end > line && end[-1] == '\r') {
+                end[-1] = '\0';
+            }
+
+            char* args = line + strspn(line, " \t");
+            if (strncmp(args, "cast", 4) == 0 && (args[4] == ' ' || args[4] == '\0')) {
+                DEMO_ServerJob job;
+                const char* error = NULL;
+                if (!server_parse_job(server, args + 4, &job, &error)) {
+                    server_reply(client, "error %s", error);
+                } else {
+                    os_mutex_lock(server->mutex);
+                    client->job = &job;
+                    os_condition_variable_broadcast(server->cv);
+                    // @note a running job is waited for even on quit, it lives
+                    // on this stack
+                    while (!job.done && !(server->quit && !job.running)) {
+                        os_condition_variable_wait(server->cv, server->mutex);
+                    }
+                    client->job = NULL;
+                    bool done = job.done;
+                    os_mutex_unlock(server->mutex);
+
+                    if (done) {
+                        server_reply(client, "ok %.3f", job.seconds);
+                    } else {
+                        server_reply(client, "error shutting down");
+                        open = false;
+                    }
+                }
+            } else if (strcmp(args, "quit") == 0) {
+                os_mutex_lock(server->mutex);
+                server->quit = true;
+                os_condition_variable_broadcast(server->cv);
+                os_mutex_unlock(server->mutex);
+                server_reply(client, "ok");
+                open = false;
+            } else if (args[0] != '\0') {
+                server_reply(client, "error unknown command");
+            }
+
+            memmove(line, line + consumed, length - consumed);
+            length -= consumed;
+        }
+
+        if (length == sizeof(line) - 1) {
+            server_reply(client, "error line too long");
+            break;
+        }
+    }
+
+    os_mutex_lock(server->mutex);
+    client->finished = true;
+    os_mutex_unlock(server->mutex);
+
+    thread_release();
+}
+
+// @note fine with the server mutex held for finished clients, their thread
+// doesn't take it again
+static void server_reap_client(DEMO_ServerClient* client) {
+    os_thread_join(client->thread);
+    os_socket_close(client->socket);
+    client->used = false;
+    client->finished = false;
+}
+
+static void server_accept_main(void* data) {
+    DEMO_Server* server = (DEMO_Server*)data;
+    ThreadCtx ctx;
+    thread_equip(&ctx);
+
+    for (;;) {
+        OS_Handle socket = os_socket_accept(server->listener);
+        if (os_is_handle_zero(socket)) {
+            break;
+        }
+
+        os_mutex_lock(server->mutex);
+        DEMO_ServerClient* slot = NULL;
+        for EachElement(i, server->clients) {
+            DEMO_ServerClient* client = &server->clients[i];
+            if (client->used && client->finished) {
+                server_reap_client(client);
+            }
+            if (slot == NULL && !client->used) {
+                slot = client;
+            }
+        }
+        if (!server->quit && slot != NULL) {
+            slot->server = server;
+            slot->socket = socket;
+            slot->thread = os_thread_launch(server_client_main, slot);
+            slot->used = !os_is_handle_zero(slot->thread);
+        }
+        bool accepted = slot != NULL && slot->used && !server->quit;
+        os_mutex_unlock(server->mutex);
+
+        if (!accepted) {
+            os_socket_close(socket);
+        }
+    }
+
+    thread_release();
+}
+
+// the next job in turn after the client served last, NULL if there's none.
+// expects the server mutex to be held
+static DEMO_ServerJob* server_next_job(DEMO_Server* server) {
+    for EachIndexU32(i, DEMO_SERVER_MAX_CLIENTS) {
+        u32 idx = (server->next_client + i) % DEMO_SERVER_MAX_CLIENTS;
+        DEMO_ServerJob* job = server->clients[idx].job;
+        if (job != NULL && !job->running && !job->done) {
+            server->next_client = idx + 1;
+            return job;
+        }
+    }
+    return NULL;
+}
+
+void serve(const DEMO_Settings* settings, RT_Handle tracer, RT_CastSettings csettings) {
+    DEMO_Server* server = (DEMO_Server*)os_allocate(sizeof(DEMO_Server));
+    MemoryZeroStruct(server);
+    server->settings = settings;
+    server->tracer = tracer;
+    server->csettings = csettings;
+
+    server->listener = os_socket_listen(settings->serve);
+    if (os_is_handle_zero(server->listener)) {
+        fprintf(stderr, "can't listen on %s\n", settings->serve.cstr);
+        os_deallocate(server);
+        return;
+    }
+    server->mutex = os_mutex_alloc();
+    server->cv = os_condition_variable_alloc();
+    server->accept_thread = os_thread_launch(server_accept_main, server);
+    printf("serving on %s\n", settings->serve.cstr);
+    fflush(stdout);
+
+    // @note jobs render here one after the other, each on the whole job system
+    os_mutex_lock(server->mutex);
+    for (;;) {
+        DEMO_ServerJob* job = NULL;
+        while (!server->quit && (job = server_next_job(server)) == NULL) {
+            os_condition_variable_wait(server->cv, server->mutex);
+        }
+        if (server->quit) {
+            break;
+        }
+        job->running = true;
+        os_mutex_unlock(server->mutex);
+
+        f64 start = os_now_seconds();
+        cast_and_write(&job->settings, tracer, server_cast_settings(server, job));
+        f64 seconds = os_now_seconds() - start;
+        printf("%s: %.3fs\n", job->out, seconds);
+        fflush(stdout);
+
+        os_mutex_lock(server->mutex);
+        job->seconds = seconds;
+        job->done = true;
+        os_condition_variable_broadcast(server->cv);
+    }
+    os_mutex_unlock(server->mutex);
+
+    // wake up the accept thread and the clients waiting on their sockets
+    os_socket_shutdown(server->listener);
+    os_thread_join(server->accept_thread);
+    for EachElement(i, server->clients) {
+        DEMO_ServerClient* client = &server->clients[i];
+        if (client->used) {
+            os_socket_shutdown(client->socket);
+            server_reap_client(client);
+        }
+    }
+
+    os_socket_close(server->listener);
+    os_condition_variable_release(server->cv);
+    os_mutex_release(server->mutex);
+    os_deallocate(server);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+// ============================================================================
+// render server
+// ============================================================================
+// keeps the world and tracer a demo built and renders jobs sent to it over a
+// unix domain socket, one per line:
+//
+//   cast out=FILE [width=W] [height=H] [samples=S] [seed=N]
+//        [eye=X,Y,Z] [subject=X,Y,Z] [crop=X0,Y0,X1,Y1]
+//   quit
+//
+// anything left out is taken from the command line and the demo's camera.
+// every line is answered with "ok SECONDS" once the job is written or with
+// "error MESSAGE". a client has one job in flight at a time and the clients
+// take turns, so a client queueing many jobs can't starve the others
+#define DEMO_SERVER_MAX_CLIENTS 64
+#define DEMO_SERVER_MAX_LINE 1024
+// @note bounds what one job allocates, the buffers are width*height pixels
+#define DEMO_SERVER_MAX_SIZE 16384
+
+typedef struct DEMO_ServerJob DEMO_ServerJob;
+struct DEMO_ServerJob {
+    DEMO_Settings settings;
+    char out[DEMO_SERVER_MAX_LINE];
+    bool has_eye;
+    vec3_f32 eye;
+    bool has_subject;
+    vec3_f32 subject;
+
+    // guarded by the server mutex
+    bool running;
+    bool done;
+    f64 seconds;
+};
+
+typedef struct DEMO_Server DEMO_Server;
+
+typedef struct DEMO_ServerClient DEMO_ServerClient;
+struct DEMO_ServerClient {
+    DEMO_Server* server;
+    OS_Handle socket;
+    OS_Handle thread;
+
+    // guarded by the server mutex
+    bool used;
+    bool finished;
+    DEMO_ServerJob* job;
+};
+
+struct DEMO_Server {
+    const DEMO_Settings* settings;
+    RT_Handle tracer;
+    RT_CastSettings csettings;
+
+    OS_Handle listener;
+    OS_Handle accept_thread;
+
+    // guarded by the mutex, signaled when a job comes in or finishes and on quit
+    OS_Handle mutex;
+    OS_Handle cv;
+    DEMO_ServerClient clients[DEMO_SERVER_MAX_CLIENTS];
+    u32 next_client;
+    bool quit;
+};
+
+// takes over from cast_and_write until a client sends quit
+void serve(const DEMO_Settings* settings, RT_Handle tracer, RT_CastSettings csettings);
@@ -0,0 +1,159 @@
+// ============================================================================
+// image writers
+// ============================================================================
+internal IMG_Format img_format_from_path(NTString8 path) {
+    if (path.length >= 4 && strcmp(path.cstr + path.length - 4, ".pfm") == 0) {
+        return IMG_Format_PFM;
+    }
+    return IMG_Format_HDR;
+}
+
+// run-length encodes one channel, runs of IMG_HDR_MIN_RUN or more equal bytes
+// become a count and the byte, the bytes in between are dumped as they are
+static u64 img_hdr_encode_channel(u8* out, const u8* channel, int width) {
+    u64 size = 0;
+    int x = 0;
+    while (x < width) {
+        int run = x;
+        while (run + IMG_HDR_MIN_RUN - 1 < width && !(channel[run] == channel[run + 1] && channel[run] == channel[run + 2])) {
+            run++;
+        }
+        if (run + IMG_HDR_MIN_RUN - 1 >= width) {
+            run = width;
+        }
+
+        while (x < run) {
+            int length = Min(run - x, IMG_HDR_MAX_DUMP);
+            out[size++] = (u8)length;
+            memcpy(&out[size], &channel[x], length);
+            size += length;
+            x += length;
+        }
+
+        if (run < width) {
+            while (run < width && channel[run] == channel[x]) {
+                run++;
+            }
+            while (x < run) {
+                int length = Min(run - x, IMG_HDR_MAX_RUN);
+                out[size++] = (u8)(128 + length);
+                out[size++] = channel[x];
+                x += length;
+            }
+        }
+    }
+    return size;
+}
+
+// @note out_line needs img_hdr_line_size(width) bytes, run-length encoding is
+// only defined for widths in [8, 32768) so other rows are stored flat
+internal u64 img_hdr_encode_scanline(u8* out_line, const u8* rgbe, int width) {
+    if (width < 8 || width >= 32768) {
+        memcpy(out_line, rgbe, (u64)width*4);
+        return (u64)width*4;
+    }
+
+    // channels are encoded one after the other, staged at the end of the line
+    u8* planes = out_line + img_hdr_line_size(width) - (u64)width*4;
+    for EachIndex(x, (u64)width) {
+        for (int c = 0; c < 4; c++) {
+            planes[c*width + x] = rgbe[x*4 + c];
+        }
+    }
+
+    u64 size = 0;
+    out_line[size++] = 2;
+    out_line[size++] = 2;
+    out_line[size++] = (u8)(width >> 8);
+    out_line[size++] = (u8)(width & 0xff);
+    for (int c = 0; c < 4; c++) {
+        // @note the encoded channels stay in front of the staged ones, see
+        // img_hdr_line_size
+        size += img_hdr_encode_channel(&out_line[size], &planes[c*width], width);
+    }
+    return size;
+}
+
+internal u64 img_hdr_line_size(int width) {
+    // worst case is every channel dumped in IMG_HDR_MAX_DUMP chunks, plus room
+    // to stage the unencoded channels
+    u64 encoded = 4 + 4*((u64)width + (u64)width/IMG_HDR_MAX_DUMP + 1);
+    return encoded + (u64)width*4;
+}
+
+internal bool img_writer_begin(IMG_Writer* writer, Arena* arena, NTString8 path, IMG_Format format, int width, int height) {
+    MemoryZeroStruct(writer);
+    writer->format = format;
+    writer->width = width;
+    writer->height = height;
+
+    writer->file = os_open_writeonly_file(path);
+    if (os_is_handle_zero(writer->file)) {
+        return false;
+    }
+
+    char header[128];
+    int header_length = 0;
+    switch (format) {
+        case IMG_Format_HDR: {
+            header_length = snprintf(header, sizeof(header), "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y %d +X %d\n", height, width);
+            writer->line = push_array_no_zero(arena, u8, img_hdr_line_size(width));
+            writer->row = push_array_no_zero(arena, u8, (u64)width*pixel_format_size(PixelFormat_RGBE8));
+        } break;
+        case IMG_Format_PFM: {
+            // @note a negative scale marks little endian
+            header_length = snprintf(header, sizeof(header), "PF\n%d %d\n-1.0\n", width, height);
+            writer->row = push_array_no_zero(arena, u8, (u64)width*pixel_format_size(PixelFormat_RGB32F));
+        } break;
+        default: NotImplemented;
+    }
+
+    writer->header_size = (u64)header_length;
+    writer->ok = os_write_file(writer->file, header, writer->header_size) == writer->header_size;
+    return writer->ok;
+}
+
+internal void img_writer_write_rows(IMG_Writer* writer, PixelFormat format, const void* rows, int row_count) {
+    Assert(writer->rows_written + row_count <= writer->height);
+
+    u64 row_size = pixel_format_size(format)*writer->width;
+    for (int i = 0; i < row_count && writer->ok; i++) {
+        const void* row = (const u8*)rows + (u64)i*row_size;
+        int y = writer->rows_written + i;
+
+        switch (writer->format) {
+            case IMG_Format_HDR: {
+                // @note rgbe rows are encoded as they are
+                const u8* rgbe = (const u8*)row;
+                if (format != PixelFormat_RGBE8) {
+                    convert_pixels(PixelFormat_RGBE8, writer->row, format, row, writer->width);
+                    rgbe = writer->row;
+                }
+                u64 size = img_hdr_encode_scanline(writer->line, rgbe, writer->width);
+                writer->ok = os_write_file(writer->file, writer->line, size) == size;
+            } break;
+            case IMG_Format_PFM: {
+                // @note pfm stores the bottom row first, the file size is known
+                // up front so every row goes straight to its place
+                const void* floats = row;
+                if (format != PixelFormat_RGB32F) {
+                    convert_pixels(PixelFormat_RGB32F, writer->row, format, row, writer->width);
+                    floats = writer->row;
+                }
+                u64 float_row_size = sizeof(vec3_f32)*writer->width;
+                os_set_file_offset(writer->file, writer->header_size + (u64)(writer->height - 1 - y)*float_row_size);
+                writer->ok = os_write_file(writer->file, floats, float_row_size) == float_row_size;
+            } break;
+            default: NotImplemented;
+        }
+    }
+    writer->rows_written += row_count;
+}
+
+internal bool img_writer_end(IMG_Writer* writer) {
+    if (os_is_handle_zero(writer->file)) {
+        return false;
+    }
+    os_close_file(writer->file);
+    return writer->ok && writer->rows_written == writer->height;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// ============================================================================
+// image writers
+// ============================================================================
+// rows are written top to bottom as they come in, so an image never has to be
+// in memory as a whole
+typedef enum IMG_Format {
+    // radiance rgbe with run-length encoded scanlines
+    IMG_Format_HDR,
+    // portable float map, 3 little endian floats per pixel
+    IMG_Format_PFM,
+    IMG_Format_Count ENUM_CASE_UNUSED,
+} IMG_Format;
+
+typedef struct IMG_Writer IMG_Writer;
+struct IMG_Writer {
+    OS_Handle file;
+    IMG_Format format;
+    int width;
+    int height;
+    int rows_written;
+    u64 header_size;
+    bool ok;
+
+    // one encoded scanline
+    u8* line;
+    // a row converted to what the format stores, for rows that come in other
+    // pixel formats
+    u8* row;
+};
+
+// run lengths of the hdr scanline encoding
+#define IMG_HDR_MIN_RUN 3
+#define IMG_HDR_MAX_RUN 127
+#define IMG_HDR_MAX_DUMP 128
+
+// picks the format from the extension of path, hdr unless it's .pfm
+internal IMG_Format img_format_from_path(NTString8 path);
+
+internal bool img_writer_begin(IMG_Writer* writer, Arena* arena, NTString8 path, IMG_Format format, int width, int height);
+internal void img_writer_write_rows(IMG_Writer* writer, PixelFormat format, const void* rows, int row_count);
+// false if any write failed or not every row was written
+internal bool img_writer_end(IMG_Writer* writer);
+
+internal u64  img_hdr_encode_scanline(u8* out_line, const u8* rgbe, int width);
+internal u64  img_hdr_line_size(int width);
@@ -0,0 +1,266 @@
+// ============================================================================
+// job system
+// ============================================================================
+// @note expects the system mutex to be held
+static void job_unlink_range(JOB_Range* range) {
+    JOB_Range* prev = NULL;
+    for EachList_N(r, JOB_Range, job_system.first, next_in_queue) {
+        if (r == range) {
+            if (prev == NULL) {
+                job_system.first = r->next_in_queue;
+            } else {
+                prev->next_in_queue = r->next_in_queue;
+            }
+            if (job_system.last == r) {
+                job_system.last = prev;
+            }
+            break;
+        }
+        prev = r;
+    }
+}
+
+// hands out the next chunk of range, the range leaves the queue with its last
+// chunk, expects the system mutex to be held
+static bool job_claim_chunk(JOB_Range* range, u64* out_begin, u64* out_end) {
+    if (range->next >= range->count) {
+        return false;
+    }
+
+    *out_begin = range->next;
+    *out_end = Min(range->next + range->grain, range->count);
+    range->next = *out_end;
+    if (range->next >= range->count) {
+        job_unlink_range(range);
+    }
+    return true;
+}
+
+// runs a claimed chunk with the mutex released, expects it to be held
+static void job_run_chunk(JOB_Range* range, u64 begin, u64 end) {
+    os_mutex_unlock(job_system.mutex);
+    range->func(range->data, begin, end);
+    os_mutex_lock(job_system.mutex);
+
+    range->pending--;
+    if (range->pending == 0) {
+        os_condition_variable_broadcast(job_system.done_cv);
+    }
+}
+
+// @note without job_init there is nothing to lock, tasks all run on the thread
+// waiting for their graph
+static void job_lock() {
+    if (!os_is_handle_zero(job_system.mutex)) {
+        os_mutex_lock(job_system.mutex);
+    }
+}
+
+static void job_unlock() {
+    if (!os_is_handle_zero(job_system.mutex)) {
+        os_mutex_unlock(job_system.mutex);
+    }
+}
+
+// queues the task once nothing holds it back anymore, expects the system mutex
+// to be held
+static void job_task_release(JOB_Task* task) {
+    Assert(task->waits > 0);
+    task->waits--;
+    if (task->waits == 0) {
+        sllist_push_n(job_system.first_task, job_system.last_task, task, next_in_queue);
+        if (!os_is_handle_zero(job_system.work_cv)) {
+            os_condition_variable_broadcast(job_system.work_cv);
+        }
+    }
+}
+
+// runs a queued task with the mutex released and releases its dependents,
+// expects it to be held
+static void job_run_task(JOB_Task* task) {
+    job_unlock();
+    task->func(task->data);
+    job_lock();
+
+    task->done = true;
+    for EachList(link, JOB_TaskLink, task->first_dependent) {
+        job_task_release(link->task);
+    }
+    task->graph->pending--;
+    // @note wakes the threads waiting for the graph as well
+    if (!os_is_handle_zero(job_system.work_cv)) {
+        os_condition_variable_broadcast(job_system.work_cv);
+    }
+}
+
+// runs a chunk of the first range or else the first queued task, false when
+// there's nothing to do. expects the system mutex to be held
+// @note ranges go first, their callers are blocked on them
+static bool job_run_next() {
+    JOB_Range* range = job_system.first;
+    u64 begin, end;
+    if (range != NULL && job_claim_chunk(range, &begin, &end)) {
+        job_run_chunk(range, begin, end);
+        return true;
+    }
+
+    JOB_Task* task = job_system.first_task;
+    if (task != NULL) {
+        sllist_pop_n(job_system.first_task, job_system.last_task, next_in_queue);
+        job_run_task(task);
+        return true;
+    }
+    return false;
+}
+
+static void job_worker_main(void* data) {
+    ThreadCtx ctx;
+    thread_equip(&ctx);
+
+    os_mutex_lock(job_system.mutex);
+    while (!job_system.quit) {
+        if (!job_run_next()) {
+            os_condition_variable_wait(job_system.work_cv, job_system.mutex);
+        }
+    }
+    os_mutex_unlock(job_system.mutex);
+
+    thread_release();
+}
+
+internal void job_init(u32 worker_count) {
+    Assert(job_system.thread_count == 0);
+
+    if (worker_count == 0) {
+        worker_count = os_logical_core_count() - 1;
+    }
+
+    job_system.mutex = os_mutex_alloc();
+    job_system.work_cv = os_condition_variable_alloc();
+    job_system.done_cv = os_condition_variable_alloc();
+    job_system.quit = false;
+
+    if (worker_count == 0) {
+        return;
+    }
+    job_system.threads = (OS_Handle*)os_allocate(sizeof(OS_Handle)*worker_count);
+    for EachIndexU32(i, worker_count) {
+        OS_Handle thread = os_thread_launch(job_worker_main, NULL);
+        if (os_is_handle_zero(thread)) {
+            break;
+        }
+        job_system.threads[job_system.thread_count++] = thread;
+    }
+}
+
+internal void job_shutdown() {
+    if (os_is_handle_zero(job_system.mutex)) {
+        return;
+    }
+
+    os_mutex_lock(job_system.mutex);
+    job_system.quit = true;
+    os_condition_variable_broadcast(job_system.work_cv);
+    os_mutex_unlock(job_system.mutex);
+
+    for EachIndexU32(i, job_system.thread_count) {
+        os_thread_join(job_system.threads[i]);
+    }
+    if (job_system.threads != NULL) {
+        os_deallocate(job_system.threads);
+    }
+
+    os_condition_variable_release(job_system.done_cv);
+    os_condition_variable_release(job_system.work_cv);
+    os_mutex_release(job_system.mutex);
+    MemoryZeroStruct(&job_system);
+}
+
+internal u32 job_worker_count() {
+    return job_system.thread_count;
+}
+
+internal void job_parallel_for(u64 count, u64 grain, JOB_RangeFunction* func, void* data) {
+    if (count == 0) {
+        return;
+    }
+    grain = Max(grain, 1);
+
+    if (job_system.thread_count == 0 || count <= grain) {
+        func(data, 0, count);
+        return;
+    }
+
+    // @note lives on the stack, the caller doesn't return before the last
+    // chunk finished
+    JOB_Range range = {
+        .func = func,
+        .data = data,
+        .count = count,
+        .grain = grain,
+        .next = 0,
+        .pending = (count + grain - 1)/grain,
+    };
+
+    os_mutex_lock(job_system.mutex);
+    sllist_push_n(job_system.first, job_system.last, &range, next_in_queue);
+    os_condition_variable_broadcast(job_system.work_cv);
+
+    u64 begin, end;
+    while (job_claim_chunk(&range, &begin, &end)) {
+        job_run_chunk(&range, begin, end);
+    }
+    while (range.pending > 0) {
+        os_condition_variable_wait(job_system.done_cv, job_system.mutex);
+    }
+    os_mutex_unlock(job_system.mutex);
+}
+
+internal JOB_Graph job_make_graph(Arena* arena) {
+    JOB_Graph graph = {
+        .arena = arena,
+        .pending = 0,
+    };
+    return graph;
+}
+
+internal JOB_Task* job_task_make(JOB_Graph* graph, JOB_TaskFunction* func, void* data) {
+    job_lock();
+    JOB_Task* task = push_array(graph->arena, JOB_Task, 1);
+    job_unlock();
+
+    task->graph = graph;
+    task->func = func;
+    task->data = data;
+    task->waits = 1;
+    return task;
+}
+
+internal void job_task_depend(JOB_Task* task, JOB_Task* dependency) {
+    job_lock();
+    if (!dependency->done) {
+        JOB_TaskLink* link = push_array(task->graph->arena, JOB_TaskLink, 1);
+        link->task = task;
+        stack_push(dependency->first_dependent, link);
+        task->waits++;
+    }
+    job_unlock();
+}
+
+internal void job_task_submit(JOB_Task* task) {
+    job_lock();
+    task->graph->pending++;
+    job_task_release(task);
+    job_unlock();
+}
+
+internal void job_graph_wait(JOB_Graph* graph) {
+    job_lock();
+    while (graph->pending > 0) {
+        if (!job_run_next()) {
+            Assert(!os_is_handle_zero(job_system.work_cv));
+            os_condition_variable_wait(job_system.work_cv, job_system.mutex);
+        }
+    }
+    job_unlock();
+}
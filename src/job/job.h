@@ -0,0 +1,103 @@
+#pragma once
+
+// ============================================================================
+// job system
+// ============================================================================
+// fixed pool of worker threads, each equipped with its own thread context so
+// jobs can use scratch arenas. without job_init (or with 0 workers) every job
+// runs on the calling thread
+
+// runs the items [begin, end) of a parallel for
+typedef void JOB_RangeFunction(void* data, u64 begin, u64 end);
+
+typedef struct JOB_Range JOB_Range;
+struct JOB_Range {
+    JOB_RangeFunction* func;
+    void* data;
+    u64 count;
+    u64 grain;
+
+    // next item to hand out and chunks still running, guarded by the system mutex
+    u64 next;
+    u64 pending;
+
+    JOB_Range* next_in_queue;
+};
+
+// ============================================================================
+// task graph
+// ============================================================================
+// a task runs once every task it depends on finished. tasks are made and wired
+// up first and become runnable with job_task_submit, running tasks may make and
+// submit more tasks of their graph. job_graph_wait works on whatever is queued
+// until every submitted task of the graph finished
+typedef void JOB_TaskFunction(void* data);
+
+typedef struct JOB_Task JOB_Task;
+
+typedef struct JOB_TaskLink JOB_TaskLink;
+struct JOB_TaskLink {
+    JOB_Task* task;
+    JOB_TaskLink* next;
+};
+
+typedef struct JOB_Graph JOB_Graph;
+struct JOB_Graph {
+    // tasks and links live here, guarded by the system mutex like the count of
+    // submitted tasks that didn't finish yet
+    Arena* arena;
+    u64 pending;
+};
+
+struct JOB_Task {
+    JOB_Graph* graph;
+    JOB_TaskFunction* func;
+    void* data;
+
+    // guarded by the system mutex. waits counts the unfinished dependencies
+    // and one more until the task is submitted
+    u32 waits;
+    bool done;
+    JOB_TaskLink* first_dependent;
+    JOB_Task* next_in_queue;
+};
+
+typedef struct JOB_System JOB_System;
+struct JOB_System {
+    OS_Handle mutex;
+    OS_Handle work_cv;
+    OS_Handle done_cv;
+
+    JOB_Range* first;
+    JOB_Range* last;
+
+    // tasks whose dependencies finished
+    JOB_Task* first_task;
+    JOB_Task* last_task;
+
+    OS_Handle* threads;
+    u32 thread_count;
+    bool quit;
+};
+
+global JOB_System job_system;
+
+// @note a worker_count of 0 leaves one core per caller, one worker per other core
+internal void job_init(u32 worker_count);
+internal void job_shutdown();
+internal u32  job_worker_count();
+
+// splits [0, count) into chunks of grain items, the caller works on them too
+// and returns once all of them ran
+internal void job_parallel_for(u64 count, u64 grain, JOB_RangeFunction* func, void* data);
+
+// @note arena has to outlive the graph and can't be a scratch arena, tasks
+// running on the waiting thread would reset it
+internal JOB_Graph job_make_graph(Arena* arena);
+internal JOB_Task* job_task_make(JOB_Graph* graph, JOB_TaskFunction* func, void* data);
+// @note expects task not to be submitted yet, dependencies that finished
+// already are skipped
+internal void      job_task_depend(JOB_Task* task, JOB_Task* dependency);
+internal void      job_task_submit(JOB_Task* task);
+// @note a task depending on one that is never submitted keeps this waiting
+internal void      job_graph_wait(JOB_Graph* graph);
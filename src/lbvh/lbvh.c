@@ -106,7 +106,8 @@ internal LBVH_Tree lbvh_make(Arena* arena, rng3_f32* in_aabbs, u64 count) {
     vec3_f32 extents = sub_3f32(max, min);
 
     LBVH_Tree result;
-    {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
+    // @note arena may be a scratch arena of the caller
+    {DeferResource(Temp scratch = scratch_begin_a(arena), scratch_end(scratch)) {
         NodeIndex* node_index = push_array_no_zero(scratch.arena, NodeIndex, count);
 
         // calculate morton codes and set ids
@@ -162,4 +163,39 @@ static u64 lbvh_node_query_ray(const LBVH_Node* node, const rng3_f32* in_ray, rn
 
 internal u64 lbvh_query_ray(const LBVH_Tree* lbvh, const rng3_f32* in_ray, rng_f32* inout_t_interval, LBVH_RayHitFunction hit_function, void* data) {
     return lbvh_node_query_ray(lbvh->root, in_ray, inout_t_interval, hit_function, data);
+}
+
+internal void lbvh_query_ray_begin(LBVH_RayQuery* query, const LBVH_Tree* lbvh) {
+    query->stack[0] = lbvh->root;
+    query->stack_count = 1;
+    Prefetch(lbvh->root);
+}
+
+internal bool lbvh_query_ray_done(const LBVH_RayQuery* query) {
+    return query->stack_count == 0;
+}
+
+// visits a single node and prefetches the next one, returns the id of a leaf
+// whose aabb overlaps the ray (to be tested by the caller) or 0
+internal u64 lbvh_query_ray_step(LBVH_RayQuery* query, const rng3_f32* in_ray, const rng_f32* in_t_interval) {
+    Assert(query->stack_count > 0);
+    const LBVH_Node* node = query->stack[--query->stack_count];
+
+    u64 id = 0;
+    rng_f32 t_interval = *in_t_interval;
+    if (lbvh_aabb_query_ray(node->aabb, in_ray, &t_interval)) {
+        if (node->id > 0) {
+            id = node->id;
+        } else {
+            // @note right is pushed first so left is visited first
+            Assert(query->stack_count + 2 <= LBVH_MAX_DEPTH);
+            if (node->right != NULL) query->stack[query->stack_count++] = node->right;
+            if (node->left  != NULL) query->stack[query->stack_count++] = node->left;
+        }
+    }
+
+    if (query->stack_count > 0) {
+        Prefetch(query->stack[query->stack_count-1]);
+    }
+    return id;
 }
\ No newline at end of file
@@ -15,9 +15,25 @@ struct LBVH_Tree {
 
 typedef bool (*LBVH_RayHitFunction)(u64 id, const rng3_f32* in_ray, rng_f32* inout_t_interval, void* data);
 
+// @note morton splits are bounded by the 63 code bits, identical codes split
+// in half so this covers any tree that fits in memory
+#define LBVH_MAX_DEPTH 128
+
+// resumable traversal, visits nodes in the same order as lbvh_query_ray so
+// the caller can interleave several queries and hide node fetch latency
+typedef struct LBVH_RayQuery LBVH_RayQuery;
+struct LBVH_RayQuery {
+    const LBVH_Node* stack[LBVH_MAX_DEPTH];
+    u32 stack_count;
+};
+
 internal LBVH_Tree lbvh_make(Arena* arena, rng3_f32* in_aabbs, u64 count);
 internal u64       lbvh_query_ray(const LBVH_Tree* lbvh, const rng3_f32* in_ray, rng_f32* inout_t_interval, LBVH_RayHitFunction hit_function, void* data);
 
+internal void      lbvh_query_ray_begin(LBVH_RayQuery* query, const LBVH_Tree* lbvh);
+internal bool      lbvh_query_ray_done(const LBVH_RayQuery* query);
+internal u64       lbvh_query_ray_step(LBVH_RayQuery* query, const rng3_f32* in_ray, const rng_f32* in_t_interval);
+
 #ifdef BUILD_DEBUG
     #include "extra/dump.h"
 #endif
\ No newline at end of file
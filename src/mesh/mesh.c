@@ -8,83 +8,509 @@ internal b32 ms_hash_is_eq(MS_VertexMapHash a, MS_VertexMapHash b) {
     return true;
 }
 
-internal MS_VertexMap ms_make_vertex_map(Arena* arena, u32 slots_count) {
-    MS_VertexMap result;
-    result.slots_count = slots_count;
-    result.slots = push_array(arena, MS_VertexMapNode*, result.slots_count);
-    result.vertices_count = 0;
+// @note murmur3's finalizer over the mixed indices, corners of neighbouring
+// faces share indices so they have to spread well
+internal u32 ms_hash_vertex(MS_VertexMapHash hash) {
+    u32 h = hash.indices[0]*0x9E3779B1u ^ hash.indices[1]*0x85EBCA77u ^ hash.indices[2]*0xC2B2AE3Du;
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static MS_VertexMapSlot* ms_vertex_map_slot(MS_VertexMap* map, MS_VertexMapHash hash) {
+    u32 mask = map->slots_count - 1;
+    for (u32 slot = ms_hash_vertex(hash) & mask;; slot = (slot + 1) & mask) {
+        MS_VertexMapSlot* s = &map->slots[slot];
+        if (s->index == MS_VERTEX_MAP_EMPTY || ms_hash_is_eq(s->hash, hash)) {
+            return s;
+        }
+    }
+}
+
+static void ms_vertex_map_alloc_slots(Arena* arena, MS_VertexMap* map, u32 slots_count) {
+    map->slots_count = slots_count;
+    map->slots = push_array_no_zero(arena, MS_VertexMapSlot, slots_count);
+    memset(map->slots, 0xff, sizeof(MS_VertexMapSlot)*slots_count);
+}
+
+// @note expected_count only sizes the map, it grows as needed
+internal MS_VertexMap ms_make_vertex_map(Arena* arena, u32 expected_count) {
+    MS_VertexMap result = zero_struct;
+    u32 slots_count = 16;
+    while ((u64)slots_count*MS_VERTEX_MAP_MAX_LOAD < (u64)expected_count*8) {
+        slots_count *= 2;
+    }
+    ms_vertex_map_alloc_slots(arena, &result, slots_count);
+    result.vertices_capacity = slots_count/8*MS_VERTEX_MAP_MAX_LOAD;
+    result.vertices = push_array_no_zero(arena, MS_VertexMapHash, result.vertices_capacity);
     return result;
 }
 
 internal u32 ms_add_to_vertex_map(Arena* arena, MS_VertexMap* map, MS_VertexMapHash hash) {
-    u32 slot = hash_u64((u8*)&hash, sizeof(hash)) % map->slots_count;
-    MS_VertexMapNode* list = map->slots[slot];
+    MS_VertexMapSlot* slot = ms_vertex_map_slot(map, hash);
+    if (slot->index != MS_VERTEX_MAP_EMPTY) {
+        return slot->index;
+    }
 
-    // try to find matching vertex
-    for EachList(n_vertex, MS_VertexMapNode, list) {
-        if (ms_hash_is_eq(n_vertex->hash, hash)) {
-            return n_vertex->index;
+    // double the slots and the vertices when full, the vertices rehash in order
+    if (map->vertices_count == map->vertices_capacity) {
+        ms_vertex_map_alloc_slots(arena, map, map->slots_count*2);
+        for EachIndexU32(i, map->vertices_count) {
+            MS_VertexMapSlot* s = ms_vertex_map_slot(map, map->vertices[i]);
+            s->hash = map->vertices[i];
+            s->index = i;
         }
+        slot = ms_vertex_map_slot(map, hash);
+
+        MS_VertexMapHash* vertices = push_array_no_zero(arena, MS_VertexMapHash, map->slots_count/8*MS_VERTEX_MAP_MAX_LOAD);
+        memcpy(vertices, map->vertices, sizeof(MS_VertexMapHash)*map->vertices_count);
+        map->vertices = vertices;
+        map->vertices_capacity = map->slots_count/8*MS_VERTEX_MAP_MAX_LOAD;
     }
 
-    // otherwise, create one
-    MS_VertexMapNode* vn = push_array(arena, MS_VertexMapNode, 1);
-    vn->hash = hash;
-    vn->index = map->vertices_count;
+    slot->hash = hash;
+    slot->index = map->vertices_count;
+    map->vertices[map->vertices_count] = hash;
     map->vertices_count++;
-    stack_push(map->slots[slot], vn);
-    return vn->index;
+    return slot->index;
+}
+
+internal void ms_write_vertex(u8* vertices, u32 vertex_index, MS_VertexMapHash hash, vec3_f32* positions, vec3_f32* normals, vec2_f32* uvs, GEO_VertexAttributes attrs) {
+    for EachElement(indice_i, hash.indices) {
+        GEO_VertexAttributes attr = IntToEnum(GEO_VertexAttributes, 1 << indice_i);
+        u32 index = hash.indices[indice_i];
+
+        // @note change from 1 -> 0 indexing
+        if (index == 0 || !(attrs & attr)) {
+            continue;
+        }
+        index--;
+        
+        u64 offset = geo_vertex_i_offset(attrs, attr, vertex_index);
+        switch (attr) {
+            case GEO_VertexAttributes_P: {
+                *(GEO_VertexType_P*)(vertices + offset) = positions[index];
+            }break;
+            case GEO_VertexAttributes_N: {
+                *(GEO_VertexType_N*)(vertices + offset) = normals[index];
+            }break;
+            case GEO_VertexAttributes_T: {
+                *(GEO_VertexType_T*)(vertices + offset) = uvs[index];
+            }break;
+            default: NotImplemented;
+        }
+    }
 }
 
 internal void* ms_vertex_map_data(Arena* arena, MS_VertexMap* map, vec3_f32* positions, vec3_f32* normals, vec2_f32* uvs, GEO_VertexAttributes attrs) {
     u8* result = (u8*)arena_push(arena, geo_vertex_size(attrs)*map->vertices_count, geo_vertex_align(attrs));
-    for EachIndexU32(slot, map->slots_count) {
-        for EachList(vn, MS_VertexMapNode, map->slots[slot]) {
-            for EachElement(indice_i, vn->hash.indices) {
-                GEO_VertexAttributes attr = IntToEnum(GEO_VertexAttributes, 1 << indice_i);
-                u32 index = vn->hash.indices[indice_i];
-
-                // @note change from 1 -> 0 indexing
-                if (index == 0 || !(attrs & attr)) {
-                    continue;
+    for EachIndexU32(i, map->vertices_count) {
+        ms_write_vertex(result, i, map->vertices[i], positions, normals, uvs, attrs);
+    }
+    return result;
+}
+
+internal void* ms_chunk_list_push_(Arena* arena, MS_ChunkList* list) {
+    MS_Chunk* chunk = list->last;
+    if (chunk == NULL || chunk->count == MS_CHUNK_ITEMS) {
+        chunk = push_array(arena, MS_Chunk, 1);
+        chunk->data = (u8*)arena_push(arena, list->item_size*MS_CHUNK_ITEMS, 16);
+        sllist_push(list->first, list->last, chunk);
+    }
+
+    void* item = chunk->data + chunk->count*list->item_size;
+    memset(item, 0, list->item_size);
+    chunk->count++;
+    list->count++;
+    return item;
+}
+
+internal void* ms_chunk_list_flatten(Arena* arena, const MS_ChunkList* list) {
+    u8* result = (u8*)arena_push(arena, list->item_size*list->count, 16);
+    u64 offset = 0;
+    for EachList(chunk, MS_Chunk, list->first) {
+        memcpy(result + offset, chunk->data, chunk->count*list->item_size);
+        offset += chunk->count*list->item_size;
+    }
+    return result;
+}
+
+// tokenizing
+static b32 ms_is_whitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static b32 ms_is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+internal const char* ms_skip_whitespace(const char* cursor, const char* end) {
+    while (cursor < end && ms_is_whitespace(*cursor)) {
+        cursor++;
+    }
+    return cursor;
+}
+
+// consumes c if it's next, without skipping whitespace
+internal b32 ms_parse_char(const char** cursor, const char* end, char c) {
+    if (*cursor < end && **cursor == c) {
+        (*cursor)++;
+        return true;
+    }
+    return false;
+}
+
+// @note like strtoul negative values wrap around
+internal b32 ms_parse_u32(const char** cursor, const char* end, u32* out) {
+    const char* c = ms_skip_whitespace(*cursor, end);
+    b32 negative = false;
+    if (c < end && (*c == '+' || *c == '-')) {
+        negative = *c == '-';
+        c++;
+    }
+    if (c >= end || !ms_is_digit(*c)) {
+        return false;
+    }
+
+    u32 value = 0;
+    while (c < end && ms_is_digit(*c)) {
+        value = value*10 + (u32)(*c - '0');
+        c++;
+    }
+    *out = negative ? (u32)0 - value : value;
+    *cursor = c;
+    return true;
+}
+
+// the token handed to strtof for everything the fast path can't be sure of
+static b32 ms_parse_f32_slow(const char** cursor, const char* end, f32* out) {
+    const char* c = ms_skip_whitespace(*cursor, end);
+    char token[MS_MAX_FLOAT_TOKEN + 1];
+    u64 length = 0;
+    while (c + length < end && length < MS_MAX_FLOAT_TOKEN && !ms_is_whitespace(c[length])) {
+        token[length] = c[length];
+        length++;
+    }
+    token[length] = '\0';
+
+    char* parsed_end;
+    f32 value = strtof(token, &parsed_end);
+    if (parsed_end == token) {
+        return false;
+    }
+    *out = value;
+    *cursor = c + (parsed_end - token);
+    return true;
+}
+
+// @note decimal mantissas up to 19 digits with small exponents are exact as
+// doubles and the one multiply or divide by an exact power of ten rounds them
+// correctly, rounding that to f32 again is only off when the double landed on
+// the midpoint of two floats so those are left to strtof
+internal b32 ms_parse_f32(const char** cursor, const char* end, f32* out) {
+    static const f64 powers_of_ten[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    const char* c = ms_skip_whitespace(*cursor, end);
+    b32 negative = false;
+    if (c < end && (*c == '+' || *c == '-')) {
+        negative = *c == '-';
+        c++;
+    }
+
+    u64 mantissa = 0;
+    int digits = 0, exponent = 0;
+    b32 any_digits = false;
+    while (c < end && ms_is_digit(*c)) {
+        if (mantissa != 0 || *c != '0') {
+            mantissa = mantissa*10 + (u64)(*c - '0');
+            digits++;
+        }
+        any_digits = true;
+        c++;
+    }
+    if (c < end && *c == '.') {
+        c++;
+        while (c < end && ms_is_digit(*c)) {
+            if (mantissa != 0 || *c != '0') {
+                mantissa = mantissa*10 + (u64)(*c - '0');
+                digits++;
+            }
+            exponent--;
+            any_digits = true;
+            c++;
+        }
+    }
+    if (!any_digits || digits > 19) {
+        return ms_parse_f32_slow(cursor, end, out);
+    }
+
+    if (c < end && (*c == 'e' || *c == 'E')) {
+        const char* e = c + 1;
+        b32 negative_exponent = false;
+        if (e < end && (*e == '+' || *e == '-')) {
+            negative_exponent = *e == '-';
+            e++;
+        }
+        if (e >= end || !ms_is_digit(*e)) {
+            return ms_parse_f32_slow(cursor, end, out);
+        }
+        int value = 0;
+        while (e < end && ms_is_digit(*e)) {
+            value = Min(value*10 + (*e - '0'), 100000);
+            e++;
+        }
+        exponent += negative_exponent ? -value : value;
+        c = e;
+    }
+    // hex floats, infinities and nans
+    if (c < end && (*c == 'x' || *c == 'X' || *c == 'n' || *c == 'N' || *c == 'i' || *c == 'I')) {
+        return ms_parse_f32_slow(cursor, end, out);
+    }
+
+    f64 value;
+    if (mantissa == 0) {
+        value = 0.0;
+    } else if (mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+        value = (exponent < 0) ? (f64)mantissa/powers_of_ten[-exponent] : (f64)mantissa*powers_of_ten[exponent];
+    } else {
+        return ms_parse_f32_slow(cursor, end, out);
+    }
+
+    u64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    b32 midpoint = (bits & ((1ull << 29) - 1)) == (1ull << 28);
+    if (mantissa != 0 && (midpoint || value < FLT_MIN || value > FLT_MAX)) {
+        return ms_parse_f32_slow(cursor, end, out);
+    }
+
+    *out = negative ? -(f32)value : (f32)value;
+    *cursor = c;
+    return true;
+}
+
+// obj loading
+// @note spreads corners by position index, the vertex maps hash all of them
+static u32 ms_obj_partition(MS_VertexMapHash corner, u32 partitions_count) {
+    return (u32)(((u64)corner.indices[0]*0x9E3779B97F4A7C15ull) >> 32) % partitions_count;
+}
+
+// @note the slashes have to follow right away, like in the " %u/%u/%u"
+// formats this replaced. on failure the corner keeps what was parsed
+static b32 ms_obj_parse_corner(const char** cursor, const char* end, GEO_VertexAttributes attrs, u32* p, u32* t, u32* n) {
+    switch (attrs) {
+        case GEO_VertexAttributes_P: {
+            return ms_parse_u32(cursor, end, p);
+        }break;
+        case GEO_VertexAttributes_PT: {
+            return ms_parse_u32(cursor, end, p) &&
+                ms_parse_char(cursor, end, '/') &&
+                ms_parse_u32(cursor, end, t);
+        }break;
+        case GEO_VertexAttributes_PN: {
+            return ms_parse_u32(cursor, end, p) &&
+                ms_parse_char(cursor, end, '/') &&
+                ms_parse_char(cursor, end, '/') &&
+                ms_parse_u32(cursor, end, n);
+        }break;
+        case GEO_VertexAttributes_PNT: {
+            return ms_parse_u32(cursor, end, p) &&
+                ms_parse_char(cursor, end, '/') &&
+                ms_parse_u32(cursor, end, t) &&
+                ms_parse_char(cursor, end, '/') &&
+                ms_parse_u32(cursor, end, n);
+        }break;
+        default: NotImplemented;
+    }
+    return false;
+}
+
+static void ms_obj_parse_floats(const char* cursor, const char* end, f32* out, u64 count) {
+    for EachIndex(i, count) {
+        if (!ms_parse_f32(&cursor, end, &out[i])) {
+            break;
+        }
+    }
+}
+
+static void ms_obj_parse_chunks(void* data, u64 begin, u64 end) {
+    MS_ObjLoader* loader = (MS_ObjLoader*)data;
+    for (u64 chunk_i = begin; chunk_i < end; chunk_i++) {
+        MS_ObjChunk* chunk = &loader->chunks[chunk_i];
+        chunk->arena = arena_alloc_ps(MB(1));
+        chunk->positions = ms_make_chunk_list(vec3_f32);
+        chunk->normals   = ms_make_chunk_list(vec3_f32);
+        chunk->uvs       = ms_make_chunk_list(vec2_f32);
+        chunk->corners   = ms_make_chunk_list(MS_VertexMapHash);
+        chunk->partition_counts  = push_array(chunk->arena, u64, loader->partitions_count);
+        chunk->partition_offsets = push_array(chunk->arena, u64, loader->partitions_count);
+
+        // @note 1-based index of each attribute
+        int vertices_per_face = loader->vertices_per_face;
+        u32* p = push_array(chunk->arena, u32, vertices_per_face);
+        u32* t = push_array(chunk->arena, u32, vertices_per_face);
+        u32* n = push_array(chunk->arena, u32, vertices_per_face);
+
+        const char* cursor = chunk->begin;
+        while (cursor < chunk->end) {
+            const char* line = cursor;
+            const char* line_end = (const char*)memchr(line, '\n', chunk->end - line);
+            line_end = (line_end != NULL) ? line_end + 1 : chunk->end;
+            cursor = line_end;
+
+            u64 line_length = line_end - line;
+            if (line_length >= 2 && line[0] == 'f' && line[1] == ' ') {
+                const char* c = line + 1;
+                for (int vertex_index = 0; vertex_index < vertices_per_face; vertex_index++) {
+                    p[vertex_index] = 0;
+                    t[vertex_index] = 0;
+                    n[vertex_index] = 0;
+                    if (!ms_obj_parse_corner(&c, line_end, loader->attrs, &p[vertex_index], &t[vertex_index], &n[vertex_index])) {
+                        // @todo logging
+                        fprintf(stderr, "Failed to parse face in obj: %.*s", (int)line_length, line);
+                        break;
+                    }
                 }
-                index--;
-                
-                u64 offset = geo_vertex_i_offset(attrs, attr, vn->index);
-                switch (attr) {
-                    case GEO_VertexAttributes_P: {
-                        *(GEO_VertexType_P*)(result + offset) = positions[index];
-                    }break;
-                    case GEO_VertexAttributes_N: {
-                        *(GEO_VertexType_N*)(result + offset) = normals[index];
-                    }break;
-                    case GEO_VertexAttributes_T: {
-                        *(GEO_VertexType_T*)(result + offset) = uvs[index];
-                    }break;
-                    default: NotImplemented;
+
+                for EachIndex(i, vertices_per_face) {
+                    // @note order has to match order of GEO_VertexAttributes
+                    MS_VertexMapHash* corner = ms_chunk_list_push(chunk->arena, &chunk->corners, MS_VertexMapHash);
+                    *corner = (MS_VertexMapHash){.indices = {p[i], n[i], t[i]}};
+                    chunk->partition_counts[ms_obj_partition(*corner, loader->partitions_count)]++;
                 }
+            } else if (line_length >= 2 && line[0] == 'v' && line[1] == ' ') {
+                vec3_f32* position = ms_chunk_list_push(chunk->arena, &chunk->positions, vec3_f32);
+                ms_obj_parse_floats(line + 1, line_end, position->v, ArrayLength(position->v));
+            } else if (line_length >= 3 && line[0] == 'v' && line[1] == 'n' && line[2] == ' ') {
+                vec3_f32* normal = ms_chunk_list_push(chunk->arena, &chunk->normals, vec3_f32);
+                ms_obj_parse_floats(line + 2, line_end, normal->v, ArrayLength(normal->v));
+            } else if (line_length >= 3 && line[0] == 'v' && line[1] == 't' && line[2] == ' ') {
+                vec2_f32* uv = ms_chunk_list_push(chunk->arena, &chunk->uvs, vec2_f32);
+                ms_obj_parse_floats(line + 2, line_end, uv->v, ArrayLength(uv->v));
             }
         }
     }
-    return result;
 }
 
-// loaders
-internal MS_LoadResult ms_load_obj(Arena* arena, NTString8 path, MS_LoadSettings settings) {
-    OS_Handle file = os_open_readonly_file(path);
+static void ms_obj_copy_chunk_list(u8* out, const MS_ChunkList* list) {
+    for EachList(c, MS_Chunk, list->first) {
+        memcpy(out, c->data, c->count*list->item_size);
+        out += c->count*list->item_size;
+    }
+}
 
-    if (os_is_handle_zero(file)) {
-        return (MS_LoadResult) { .error = ntstr8_lit_init("Failed to open file") };
+// moves the chunks into the merged arrays and buckets their corners
+static void ms_obj_merge_chunks(void* data, u64 begin, u64 end) {
+    MS_ObjLoader* loader = (MS_ObjLoader*)data;
+    for (u64 chunk_i = begin; chunk_i < end; chunk_i++) {
+        MS_ObjChunk* chunk = &loader->chunks[chunk_i];
+        ms_obj_copy_chunk_list((u8*)&loader->positions[chunk->positions_base], &chunk->positions);
+        ms_obj_copy_chunk_list((u8*)&loader->normals[chunk->normals_base], &chunk->normals);
+        ms_obj_copy_chunk_list((u8*)&loader->uvs[chunk->uvs_base], &chunk->uvs);
+        ms_obj_copy_chunk_list((u8*)&loader->corners[chunk->corners_base], &chunk->corners);
+
+        u32 corner_i = (u32)chunk->corners_base;
+        for EachList(c, MS_Chunk, chunk->corners.first) {
+            MS_VertexMapHash* corners = (MS_VertexMapHash*)c->data;
+            for EachIndex(i, c->count) {
+                u32 partition_i = ms_obj_partition(corners[i], loader->partitions_count);
+                loader->partitions[partition_i].corners[chunk->partition_offsets[partition_i]++] = corner_i++;
+            }
+        }
+        arena_release(chunk->arena);
     }
+}
 
-    // solve settings
-    int vertices_per_face;
+static void ms_obj_dedup_partitions(void* data, u64 begin, u64 end) {
+    MS_ObjLoader* loader = (MS_ObjLoader*)data;
+    for (u64 partition_i = begin; partition_i < end; partition_i++) {
+        MS_ObjPartition* partition = &loader->partitions[partition_i];
+        partition->map = ms_make_vertex_map(partition->arena, loader->partition_vertices_estimate);
+        partition->first_corners = push_array_no_zero(partition->arena, u32, partition->corners_count);
+
+        for EachIndex(i, partition->corners_count) {
+            u32 corner_i = partition->corners[i];
+            u32 vertices_count = partition->map.vertices_count;
+            u32 local_id = ms_add_to_vertex_map(partition->arena, &partition->map, loader->corners[corner_i]);
+            loader->local_ids[corner_i] = local_id;
+            if (local_id == vertices_count) {
+                partition->first_corners[local_id] = corner_i;
+                loader->is_first[corner_i] = 1;
+            }
+        }
+    }
+}
+
+static void ms_obj_count_blocks(void* data, u64 begin, u64 end) {
+    MS_ObjLoader* loader = (MS_ObjLoader*)data;
+    for (u64 block_i = begin; block_i < end; block_i++) {
+        u64 corners_end = Min((block_i + 1)*MS_OBJ_BLOCK_SIZE, loader->corners_count);
+        u64 count = 0;
+        for (u64 i = block_i*MS_OBJ_BLOCK_SIZE; i < corners_end; i++) {
+            count += loader->is_first[i];
+        }
+        loader->block_offsets[block_i] = count;
+    }
+}
+
+static void ms_obj_number_blocks(void* data, u64 begin, u64 end) {
+    MS_ObjLoader* loader = (MS_ObjLoader*)data;
+    for (u64 block_i = begin; block_i < end; block_i++) {
+        u64 corners_end = Min((block_i + 1)*MS_OBJ_BLOCK_SIZE, loader->corners_count);
+        u32 id = (u32)loader->block_offsets[block_i];
+        for (u64 i = block_i*MS_OBJ_BLOCK_SIZE; i < corners_end; i++) {
+            if (loader->is_first[i]) {
+                loader->first_ids[i] = id++;
+            }
+        }
+    }
+}
+
+static void ms_obj_write_blocks(void* data, u64 begin, u64 end) {
+    MS_ObjLoader* loader = (MS_ObjLoader*)data;
+    for (u64 block_i = begin; block_i < end; block_i++) {
+        u64 corners_end = Min((block_i + 1)*MS_OBJ_BLOCK_SIZE, loader->corners_count);
+        for (u64 i = block_i*MS_OBJ_BLOCK_SIZE; i < corners_end; i++) {
+            MS_VertexMapHash corner = loader->corners[i];
+            MS_ObjPartition* partition = &loader->partitions[ms_obj_partition(corner, loader->partitions_count)];
+            u32 vertex_index = loader->first_ids[partition->first_corners[loader->local_ids[i]]];
+            loader->indices[i] = vertex_index;
+            if (loader->is_first[i]) {
+                ms_write_vertex(loader->vertices, vertex_index, corner, loader->positions, loader->normals, loader->uvs, loader->attrs);
+            }
+        }
+    }
+}
+
+// loaders
+// the settings an obj loads with, zero ones pick the defaults
+static MS_LoadSettings ms_obj_resolve_settings(MS_LoadSettings settings) {
     if (settings.primitive == GEO_Primitive_ZERO) {
         settings.primitive = GEO_Primitive_TRI_LIST;
     }
     if (settings.attrs == GEO_VertexAttributes_ZERO) {
         settings.attrs = IntToEnum(GEO_VertexAttributes, GEO_VertexAttributes_P | GEO_VertexAttributes_T | GEO_VertexAttributes_N);
     }
+    return settings;
+}
+
+internal MS_LoadResult ms_load_obj(Arena* arena, NTString8 path, MS_LoadSettings settings) {
+    OS_FileMap file;
+    if (!os_map_file(path, &file)) {
+        return (MS_LoadResult) { .error = ntstr8_lit_init("Failed to open file") };
+    }
+    // @note chunks are parsed out of order, have the whole file read in the
+    // background while the settings are solved and the chunks split
+    os_read_ahead_map(file, 0, file.size);
+
+    // solve settings
+    int vertices_per_face;
+    settings = ms_obj_resolve_settings(settings);
     switch (settings.primitive) {
         case GEO_Primitive_LINE_LIST:  vertices_per_face = 2; break;
         case GEO_Primitive_LINE_STRIP: NotImplemented;        break;
@@ -99,121 +525,1138 @@ internal MS_LoadResult ms_load_obj(Arena* arena, NTString8 path, MS_LoadSettings
     mesh.primitive = settings.primitive;
 
     {DeferResource(Temp scratch = scratch_begin_a(arena), scratch_end(scratch)) { 
+        MS_ObjLoader loader = zero_struct;
+        loader.attrs = settings.attrs;
+        loader.vertices_per_face = vertices_per_face;
+        loader.partitions_count = job_worker_count() + 1;
+        loader.partitions = push_array(scratch.arena, MS_ObjPartition, loader.partitions_count);
 
-        NTString8 line;
-        line.cstr = push_array(scratch.arena, char, OS_DEFAULT_MAX_LINE_LENGTH);
+        // split at the first line break after every MS_OBJ_CHUNK_SIZE bytes
+        const char* file_begin = (const char*)file.data;
+        const char* file_end = file_begin + file.size;
+        loader.chunks = push_array(scratch.arena, MS_ObjChunk, file.size/MS_OBJ_CHUNK_SIZE + 1);
+        for (const char* cursor = file_begin; cursor < file_end;) {
+            MS_ObjChunk* chunk = &loader.chunks[loader.chunks_count++];
+            chunk->begin = cursor;
+            chunk->end = file_end;
+            if ((u64)(file_end - cursor) > MS_OBJ_CHUNK_SIZE) {
+                const char* line_end = (const char*)memchr(cursor + MS_OBJ_CHUNK_SIZE, '\n', file_end - (cursor + MS_OBJ_CHUNK_SIZE));
+                chunk->end = (line_end != NULL) ? line_end + 1 : file_end;
+            }
+            cursor = chunk->end;
+        }
+        job_parallel_for(loader.chunks_count, 1, ms_obj_parse_chunks, &loader);
 
-        // determine buffer sizes
-        u32 positions_count = 0, normals_count = 0, uvs_count = 0, indices_count = 0;
-        while (!os_is_eof(file)) {
-            os_read_line_to_buffer(file, &line);
-    
-            if (ntstr8_begins_with(line, "v ")) {
-                positions_count++;
-            } else if (ntstr8_begins_with(line, "vn ")) {
-                normals_count++;
-            } else if (ntstr8_begins_with(line, "vt ")) {
-                uvs_count++;
-            } else if (ntstr8_begins_with(line, "f ")) {
-                indices_count+=vertices_per_face;
+        // @note prefix sums place every chunk in the merged arrays and in the
+        // partitions, in file order
+        u64 positions_count = 0, normals_count = 0, uvs_count = 0;
+        for EachIndex(chunk_i, loader.chunks_count) {
+            MS_ObjChunk* chunk = &loader.chunks[chunk_i];
+            chunk->positions_base = positions_count;
+            chunk->normals_base = normals_count;
+            chunk->uvs_base = uvs_count;
+            chunk->corners_base = loader.corners_count;
+            positions_count += chunk->positions.count;
+            normals_count += chunk->normals.count;
+            uvs_count += chunk->uvs.count;
+            loader.corners_count += chunk->corners.count;
+            for EachIndexU32(partition_i, loader.partitions_count) {
+                chunk->partition_offsets[partition_i] = loader.partitions[partition_i].corners_count;
+                loader.partitions[partition_i].corners_count += chunk->partition_counts[partition_i];
             }
         }
-        
-        // map for deduplicating vertex data
-        MS_VertexMap vertex_map = ms_make_vertex_map(scratch.arena, Max(Max(positions_count, normals_count), uvs_count));
-        
-        // allocate buffers
-        mesh.indices_count = indices_count;
+
+        loader.positions = push_array_no_zero(scratch.arena, vec3_f32, positions_count);
+        loader.normals   = push_array_no_zero(scratch.arena, vec3_f32, normals_count);
+        loader.uvs       = push_array_no_zero(scratch.arena, vec2_f32, uvs_count);
+        loader.corners   = push_array_no_zero(scratch.arena, MS_VertexMapHash, loader.corners_count);
+        for EachIndexU32(partition_i, loader.partitions_count) {
+            MS_ObjPartition* partition = &loader.partitions[partition_i];
+            partition->arena = arena_alloc_ps(MB(1));
+            partition->corners = push_array_no_zero(partition->arena, u32, partition->corners_count);
+        }
+        job_parallel_for(loader.chunks_count, 1, ms_obj_merge_chunks, &loader);
+
+        // deduplicate indices so that vertex data is shared
+        u64 attributes_count = Max(Max(positions_count, normals_count), uvs_count);
+        loader.partition_vertices_estimate = (u32)(attributes_count/loader.partitions_count + 1);
+        loader.local_ids = push_array_no_zero(scratch.arena, u32, loader.corners_count);
+        loader.is_first  = push_array(scratch.arena, u8, loader.corners_count);
+        job_parallel_for(loader.partitions_count, 1, ms_obj_dedup_partitions, &loader);
+
+        // number vertices in the order of their first corner
+        u64 blocks_count = (loader.corners_count + MS_OBJ_BLOCK_SIZE - 1)/MS_OBJ_BLOCK_SIZE;
+        loader.block_offsets = push_array(scratch.arena, u64, blocks_count);
+        loader.first_ids = push_array_no_zero(scratch.arena, u32, loader.corners_count);
+        job_parallel_for(blocks_count, 1, ms_obj_count_blocks, &loader);
+        u64 vertices_count = 0;
+        for EachIndex(block_i, blocks_count) {
+            u64 count = loader.block_offsets[block_i];
+            loader.block_offsets[block_i] = vertices_count;
+            vertices_count += count;
+        }
+        job_parallel_for(blocks_count, 1, ms_obj_number_blocks, &loader);
+
+        // store indices and vertex data
+        mesh.indices_count = (u32)loader.corners_count;
         mesh.indices = push_array(arena, u32, mesh.indices_count);
+        mesh.vertices_count = (u32)vertices_count;
+        mesh.vertices = arena_push(arena, geo_vertex_size(settings.attrs)*mesh.vertices_count, geo_vertex_align(settings.attrs));
+        loader.indices = mesh.indices;
+        loader.vertices = (u8*)mesh.vertices;
+        job_parallel_for(blocks_count, 1, ms_obj_write_blocks, &loader);
 
-        vec3_f32* positions = push_array(scratch.arena, vec3_f32, positions_count);
-        vec3_f32* normals   = push_array(scratch.arena, vec3_f32, normals_count);
-        vec2_f32* uvs       = push_array(scratch.arena, vec2_f32, uvs_count);
+        for EachIndexU32(partition_i, loader.partitions_count) {
+            arena_release(loader.partitions[partition_i].arena);
+        }
+    }}
+    
+    os_unmap_file(file);
+    return (MS_LoadResult) { .v = mesh, .error = ntstr8_lit_init("") };;
+}
 
-        // @note 1-based index of each attribute
-        u32* p = push_array(scratch.arena, u32, vertices_per_face);
-        u32* t = push_array(scratch.arena, u32, vertices_per_face);
-        u32* n = push_array(scratch.arena, u32, vertices_per_face);
-        
-        u32 off_positions = 0, off_normals = 0, off_uvs = 0, off_indices = 0;
-        os_set_file_offset(file, 0);
-        while (!os_is_eof(file)) {
-            os_read_line_to_buffer(file, &line);
+// ply loading
+static const struct {
+    const char* name;
+    MS_PlyType type;
+} ms_ply_type_names[] = {
+    {"char",  MS_PlyType_S8},  {"int8",    MS_PlyType_S8},
+    {"uchar", MS_PlyType_U8},  {"uint8",   MS_PlyType_U8},
+    {"short", MS_PlyType_S16}, {"int16",   MS_PlyType_S16},
+    {"ushort",MS_PlyType_U16}, {"uint16",  MS_PlyType_U16},
+    {"int",   MS_PlyType_S32}, {"int32",   MS_PlyType_S32},
+    {"uint",  MS_PlyType_U32}, {"uint32",  MS_PlyType_U32},
+    {"float", MS_PlyType_F32}, {"float32", MS_PlyType_F32},
+    {"double",MS_PlyType_F64}, {"float64", MS_PlyType_F64},
+};
 
-            // @todo replace sscanf
-            if (ntstr8_begins_with(line, "f ")) {
-                for (int line_offset = 1, vertex_index = 0; vertex_index < vertices_per_face; vertex_index++) {
-                    int consumed = 0, success = 0;
+static u64 ms_ply_type_size(MS_PlyType type) {
+    switch (type) {
+        case MS_PlyType_S8:  case MS_PlyType_U8:  return 1;
+        case MS_PlyType_S16: case MS_PlyType_U16: return 2;
+        case MS_PlyType_S32: case MS_PlyType_U32: case MS_PlyType_F32: return 4;
+        case MS_PlyType_F64: return 8;
+        default: NotImplemented;
+    }
+    return 0;
+}
 
-                    p[vertex_index] = 0;
-                    t[vertex_index] = 0;
-                    n[vertex_index] = 0;
-                    switch (settings.attrs) {
-                        case GEO_VertexAttributes_P: {
-                            success = sscanf(&line.cstr[line_offset], " %u%n", 
-                                &p[vertex_index], &consumed
-                            ) == 1;
-                        }break;
-                        case GEO_VertexAttributes_PT: {
-                            success = sscanf(&line.cstr[line_offset], " %u/%u%n", 
-                                &p[vertex_index], &t[vertex_index], &consumed
-                            ) == 2;
-                        }break;
-                        case GEO_VertexAttributes_PN: {
-                            success = sscanf(&line.cstr[line_offset], " %u//%u%n", 
-                                &p[vertex_index], &n[vertex_index], &consumed
-                            ) == 2;
-                        }break;
-                        case GEO_VertexAttributes_PNT: {
-                            success = sscanf(&line.cstr[line_offset], " %u/%u/%u%n", 
-                                &p[vertex_index], &t[vertex_index], &n[vertex_index], &consumed
-                            ) == 3;
-                        }break;
-                        default: NotImplemented;
+static MS_PlyType ms_ply_type_from_name(const char* name) {
+    for EachElement(i, ms_ply_type_names) {
+        if (strcmp(ms_ply_type_names[i].name, name) == 0) {
+            return ms_ply_type_names[i].type;
+        }
+    }
+    return MS_PlyType_NONE;
+}
+
+// the next word of the line, false if there's none or it doesn't fit
+static b32 ms_ply_word(const char** cursor, const char* end, char* out, u64 capacity) {
+    const char* c = ms_skip_whitespace(*cursor, end);
+    u64 length = 0;
+    while (c + length < end && !ms_is_whitespace(c[length])) {
+        length++;
+    }
+    if (length == 0 || length >= capacity) {
+        return false;
+    }
+    memcpy(out, c, length);
+    out[length] = '\0';
+    *cursor = c + length;
+    return true;
+}
+
+// what the vertex property called name is decoded into
+static void ms_ply_resolve_vertex_property(MS_PlyProperty* property) {
+    static const struct {
+        const char* name;
+        GEO_VertexAttributes attr;
+        u32 component;
+    } targets[] = {
+        {"x",  GEO_VertexAttributes_P, 0}, {"y",  GEO_VertexAttributes_P, 1}, {"z",  GEO_VertexAttributes_P, 2},
+        {"nx", GEO_VertexAttributes_N, 0}, {"ny", GEO_VertexAttributes_N, 1}, {"nz", GEO_VertexAttributes_N, 2},
+        {"u",  GEO_VertexAttributes_T, 0}, {"v",  GEO_VertexAttributes_T, 1},
+        {"s",  GEO_VertexAttributes_T, 0}, {"t",  GEO_VertexAttributes_T, 1},
+        {"texture_u", GEO_VertexAttributes_T, 0}, {"texture_v", GEO_VertexAttributes_T, 1},
+    };
+    for EachElement(i, targets) {
+        if (property->count_type == MS_PlyType_NONE && strcmp(targets[i].name, property->name) == 0) {
+            property->attr = targets[i].attr;
+            property->component = targets[i].component;
+        }
+    }
+}
+
+static b32 ms_ply_parse_header(MS_PlyHeader* header, const char* data, const char* end) {
+    MemoryZeroStruct(header);
+    b32 has_format = false;
+    b32 first = true;
+    const char* cursor = data;
+    while (cursor < end) {
+        const char* line = cursor;
+        const char* line_end = (const char*)memchr(line, '\n', end - line);
+        if (line_end == NULL) {
+            return false;
+        }
+        cursor = line_end + 1;
+
+        char word[MS_PLY_MAX_NAME];
+        const char* c = line;
+        if (!ms_ply_word(&c, line_end, word, sizeof(word))) {
+            if (first) {
+                return false;
+            }
+            continue;
+        }
+        if (first) {
+            if (strcmp(word, "ply") != 0) {
+                return false;
+            }
+            first = false;
+        } else if (strcmp(word, "format") == 0) {
+            if (!ms_ply_word(&c, line_end, word, sizeof(word))) {
+                return false;
+            }
+            if (strcmp(word, "ascii") == 0) {
+                header->format = MS_PlyFormat_ASCII;
+            } else if (strcmp(word, "binary_little_endian") == 0) {
+                header->format = MS_PlyFormat_BINARY_LE;
+            } else if (strcmp(word, "binary_big_endian") == 0) {
+                header->format = MS_PlyFormat_BINARY_BE;
+            } else {
+                return false;
+            }
+            has_format = true;
+        } else if (strcmp(word, "element") == 0) {
+            if (header->elements_count == MS_PLY_MAX_ELEMENTS) {
+                return false;
+            }
+            MS_PlyElement* element = &header->elements[header->elements_count++];
+            u32 count;
+            if (!ms_ply_word(&c, line_end, element->name, sizeof(element->name)) || !ms_parse_u32(&c, line_end, &count)) {
+                return false;
+            }
+            element->count = count;
+        } else if (strcmp(word, "property") == 0) {
+            if (header->elements_count == 0) {
+                return false;
+            }
+            MS_PlyElement* element = &header->elements[header->elements_count - 1];
+            if (element->properties_count == MS_PLY_MAX_PROPERTIES) {
+                return false;
+            }
+            MS_PlyProperty* property = &element->properties[element->properties_count++];
+            if (!ms_ply_word(&c, line_end, word, sizeof(word))) {
+                return false;
+            }
+            if (strcmp(word, "list") == 0) {
+                if (!ms_ply_word(&c, line_end, word, sizeof(word))) {
+                    return false;
+                }
+                property->count_type = ms_ply_type_from_name(word);
+                if (property->count_type == MS_PlyType_NONE || !ms_ply_word(&c, line_end, word, sizeof(word))) {
+                    return false;
+                }
+            }
+            property->type = ms_ply_type_from_name(word);
+            if (property->type == MS_PlyType_NONE || !ms_ply_word(&c, line_end, property->name, sizeof(property->name))) {
+                return false;
+            }
+        } else if (strcmp(word, "end_header") == 0) {
+            header->size = (u64)(cursor - data);
+            return has_format;
+        }
+        // @note comment, obj_info and anything unknown is skipped
+    }
+    return false;
+}
+
+static f64 ms_ply_read(MS_PlyReader* reader, MS_PlyType type) {
+    if (reader->format == MS_PlyFormat_ASCII) {
+        if (type == MS_PlyType_F32 || type == MS_PlyType_F64) {
+            f32 value = 0.f;
+            reader->ok = reader->ok && ms_parse_f32(&reader->cursor, reader->end, &value);
+            return value;
+        }
+        u32 value = 0;
+        reader->ok = reader->ok && ms_parse_u32(&reader->cursor, reader->end, &value);
+        b32 is_signed = type == MS_PlyType_S8 || type == MS_PlyType_S16 || type == MS_PlyType_S32;
+        return is_signed ? (f64)(s32)value : (f64)value;
+    }
+
+    u64 size = ms_ply_type_size(type);
+    if ((u64)(reader->end - reader->cursor) < size) {
+        reader->ok = false;
+        return 0.0;
+    }
+    u8 bytes[8];
+    if (reader->format == MS_PlyFormat_BINARY_BE) {
+        for EachIndex(i, size) {
+            bytes[i] = (u8)reader->cursor[size - 1 - i];
+        }
+    } else {
+        memcpy(bytes, reader->cursor, size);
+    }
+    reader->cursor += size;
+
+    switch (type) {
+        case MS_PlyType_S8:  { s8  v; memcpy(&v, bytes, sizeof(v)); return v; }
+        case MS_PlyType_U8:  { u8  v; memcpy(&v, bytes, sizeof(v)); return v; }
+        case MS_PlyType_S16: { s16 v; memcpy(&v, bytes, sizeof(v)); return v; }
+        case MS_PlyType_U16: { u16 v; memcpy(&v, bytes, sizeof(v)); return v; }
+        case MS_PlyType_S32: { s32 v; memcpy(&v, bytes, sizeof(v)); return v; }
+        case MS_PlyType_U32: { u32 v; memcpy(&v, bytes, sizeof(v)); return v; }
+        case MS_PlyType_F32: { f32 v; memcpy(&v, bytes, sizeof(v)); return v; }
+        case MS_PlyType_F64: { f64 v; memcpy(&v, bytes, sizeof(v)); return v; }
+        default: NotImplemented;
+    }
+    return 0.0;
+}
+
+static b32 ms_ply_is_face_indices(const MS_PlyElement* element, const MS_PlyProperty* property) {
+    return strcmp(element->name, "face") == 0 && property->count_type != MS_PlyType_NONE &&
+        (strcmp(property->name, "vertex_indices") == 0 || strcmp(property->name, "vertex_index") == 0);
+}
+
+internal MS_LoadResult ms_load_ply(Arena* arena, NTString8 path, MS_LoadSettings settings) {
+    OS_FileMap file;
+    if (!os_map_file(path, &file)) {
+        return (MS_LoadResult) { .error = ntstr8_lit_init("Failed to open file") };
+    }
+
+    MS_PlyHeader header;
+    const char* data = (const char*)file.data;
+    if (!ms_ply_parse_header(&header, data, data + file.size)) {
+        os_unmap_file(file);
+        return (MS_LoadResult) { .error = ntstr8_lit_init("Not a ply file") };
+    }
+
+    // solve settings, without attributes asked for the file's are loaded
+    if (settings.primitive == GEO_Primitive_ZERO) {
+        settings.primitive = GEO_Primitive_TRI_LIST;
+    }
+    if (settings.primitive != GEO_Primitive_TRI_LIST) {
+        os_unmap_file(file);
+        return (MS_LoadResult) { .error = ntstr8_lit_init("Ply files only load as triangle lists") };
+    }
+    MS_PlyElement* vertex_element = NULL;
+    u32 file_attrs = 0;
+    for EachIndexU32(element_i, header.elements_count) {
+        MS_PlyElement* element = &header.elements[element_i];
+        if (strcmp(element->name, "vertex") == 0) {
+            vertex_element = element;
+            for EachIndexU32(property_i, element->properties_count) {
+                ms_ply_resolve_vertex_property(&element->properties[property_i]);
+                file_attrs |= element->properties[property_i].attr;
+            }
+        }
+    }
+    if (vertex_element == NULL || !(file_attrs & GEO_VertexAttributes_P)) {
+        os_unmap_file(file);
+        return (MS_LoadResult) { .error = ntstr8_lit_init("Ply file has no vertex positions") };
+    }
+    if (settings.attrs == GEO_VertexAttributes_ZERO) {
+        settings.attrs = IntToEnum(GEO_VertexAttributes, file_attrs);
+    }
+
+    MS_Mesh mesh;
+    mesh.attrs = settings.attrs;
+    mesh.primitive = settings.primitive;
+    mesh.vertices_count = (u32)vertex_element->count;
+    mesh.vertices = push_array_aligned(arena, u8, geo_vertex_size(settings.attrs)*mesh.vertices_count, geo_vertex_align(settings.attrs));
+
+    b32 valid = true;
+    {DeferResource(Temp scratch = scratch_begin_a(arena), scratch_end(scratch)) {
+        MS_ChunkList indices = ms_make_chunk_list(u32);
+        MS_PlyReader reader = {
+            .cursor = data + header.size,
+            .end = data + file.size,
+            .format = header.format,
+            .ok = true,
+        };
+
+        // @note values are decoded in the order they're stored
+        for (u32 element_i = 0; element_i < header.elements_count && reader.ok; element_i++) {
+            MS_PlyElement* element = &header.elements[element_i];
+            b32 is_vertex = element == vertex_element;
+            for (u64 item = 0; item < element->count && reader.ok; item++) {
+                for EachIndexU32(property_i, element->properties_count) {
+                    MS_PlyProperty* property = &element->properties[property_i];
+                    if (property->count_type == MS_PlyType_NONE) {
+                        f64 value = ms_ply_read(&reader, property->type);
+                        if (is_vertex && (settings.attrs & property->attr)) {
+                            u64 offset = geo_vertex_i_offset(settings.attrs, property->attr, item);
+                            ((f32*)((u8*)mesh.vertices + offset))[property->component] = (f32)value;
+                        }
+                        continue;
                     }
 
-                    line_offset += consumed;
-                    if (!success) {
-                        // @todo logging
-                        fprintf(stderr, "Failed to parse face in obj: %s", line.cstr);
-                        break;
+                    u64 count = (u64)ms_ply_read(&reader, property->count_type);
+                    if (!ms_ply_is_face_indices(element, property)) {
+                        for (u64 i = 0; i < count && reader.ok; i++) {
+                            ms_ply_read(&reader, property->type);
+                        }
+                        continue;
+                    }
+
+                    // fan out from the first corner
+                    u32 first = 0, previous = 0;
+                    for (u64 i = 0; i < count && reader.ok; i++) {
+                        f64 value = ms_ply_read(&reader, property->type);
+                        valid = valid && value >= 0.0 && value < (f64)mesh.vertices_count;
+                        u32 index = (u32)value;
+                        if (i >= 2) {
+                            *ms_chunk_list_push(scratch.arena, &indices, u32) = first;
+                            *ms_chunk_list_push(scratch.arena, &indices, u32) = previous;
+                            *ms_chunk_list_push(scratch.arena, &indices, u32) = index;
+                        } else if (i == 0) {
+                            first = index;
+                        }
+                        previous = index;
                     }
                 }
+            }
+        }
+        valid = valid && reader.ok;
 
-                // deduplicate indices so that vertex data is shared and store indice
-                for EachIndex(i, vertices_per_face) {
-                    // @note order has to match order of GEO_VertexAttributes
-                    MS_VertexMapHash hash = {.indices = {p[i], n[i], t[i]}};
-                    u32 indice = ms_add_to_vertex_map(scratch.arena, &vertex_map, hash);
-                    mesh.indices[off_indices] = indice;
-                    off_indices++;
+        mesh.indices_count = (u32)indices.count;
+        mesh.indices = (u32*)ms_chunk_list_flatten(arena, &indices);
+    }}
+
+    os_unmap_file(file);
+    if (!valid) {
+        return (MS_LoadResult) { .error = ntstr8_lit_init("Corrupt ply file") };
+    }
+    return (MS_LoadResult) { .v = mesh, .error = ntstr8_lit_init("") };
+}
+
+// json
+static MS_JsonValue* ms_json_parse_value(MS_JsonParser* parser);
+
+static b32 ms_json_expect(MS_JsonParser* parser, const char* literal) {
+    u64 length = strlen(literal);
+    if ((u64)(parser->end - parser->cursor) < length || memcmp(parser->cursor, literal, length) != 0) {
+        parser->ok = false;
+        return false;
+    }
+    parser->cursor += length;
+    return true;
+}
+
+// the contents of the string at the cursor, escapes are skipped over as they are
+static b32 ms_json_parse_string(MS_JsonParser* parser, const char** out_string, u64* out_length) {
+    if (!ms_parse_char(&parser->cursor, parser->end, '"')) {
+        parser->ok = false;
+        return false;
+    }
+    const char* begin = parser->cursor;
+    while (parser->cursor < parser->end && *parser->cursor != '"') {
+        parser->cursor += (*parser->cursor == '\\') ? 2 : 1;
+    }
+    if (parser->cursor >= parser->end) {
+        parser->ok = false;
+        return false;
+    }
+    *out_string = begin;
+    *out_length = (u64)(parser->cursor - begin);
+    parser->cursor++;
+    return true;
+}
+
+static void ms_json_push(MS_JsonParser* parser, MS_JsonValue* parent, MS_JsonValue* child) {
+    sllist_push(parent->first, parent->last, child);
+    parent->count++;
+}
+
+// parses the members or items up to close, the opening bracket is consumed
+static void ms_json_parse_children(MS_JsonParser* parser, MS_JsonValue* value, char close) {
+    parser->cursor = ms_skip_whitespace(parser->cursor, parser->end);
+    if (ms_parse_char(&parser->cursor, parser->end, close)) {
+        return;
+    }
+    while (parser->ok) {
+        const char* key = NULL;
+        u64 key_length = 0;
+        if (value->type == MS_JsonType_OBJECT) {
+            parser->cursor = ms_skip_whitespace(parser->cursor, parser->end);
+            if (!ms_json_parse_string(parser, &key, &key_length)) {
+                return;
+            }
+            parser->cursor = ms_skip_whitespace(parser->cursor, parser->end);
+            if (!ms_parse_char(&parser->cursor, parser->end, ':')) {
+                parser->ok = false;
+                return;
+            }
+        }
+
+        MS_JsonValue* child = ms_json_parse_value(parser);
+        if (child == NULL) {
+            return;
+        }
+        child->key = key;
+        child->key_length = key_length;
+        ms_json_push(parser, value, child);
+
+        parser->cursor = ms_skip_whitespace(parser->cursor, parser->end);
+        if (ms_parse_char(&parser->cursor, parser->end, close)) {
+            break;
+        }
+        if (!ms_parse_char(&parser->cursor, parser->end, ',')) {
+            parser->ok = false;
+            return;
+        }
+    }
+
+    value->items = push_array_no_zero(parser->arena, MS_JsonValue*, value->count);
+    u64 i = 0;
+    for EachList(child, MS_JsonValue, value->first) {
+        value->items[i++] = child;
+    }
+}
+
+static MS_JsonValue* ms_json_parse_value(MS_JsonParser* parser) {
+    parser->cursor = ms_skip_whitespace(parser->cursor, parser->end);
+    if (parser->cursor >= parser->end || parser->depth == MS_JSON_MAX_DEPTH) {
+        parser->ok = false;
+        return NULL;
+    }
+
+    MS_JsonValue* value = push_array(parser->arena, MS_JsonValue, 1);
+    switch (*parser->cursor) {
+        case '{':
+        case '[': {
+            char close = (*parser->cursor == '{') ? '}' : ']';
+            value->type = (close == '}') ? MS_JsonType_OBJECT : MS_JsonType_ARRAY;
+            parser->cursor++;
+            parser->depth++;
+            ms_json_parse_children(parser, value, close);
+            parser->depth--;
+        } break;
+        case '"': {
+            value->type = MS_JsonType_STRING;
+            ms_json_parse_string(parser, &value->string, &value->string_length);
+        } break;
+        case 't': {
+            value->type = MS_JsonType_BOOL;
+            value->number = 1.0;
+            ms_json_expect(parser, "true");
+        } break;
+        case 'f': {
+            value->type = MS_JsonType_BOOL;
+            ms_json_expect(parser, "false");
+        } break;
+        case 'n': {
+            value->type = MS_JsonType_NULL;
+            ms_json_expect(parser, "null");
+        } break;
+        default: {
+            char token[MS_MAX_FLOAT_TOKEN + 1];
+            u64 length = 0;
+            while (parser->cursor + length < parser->end && length < MS_MAX_FLOAT_TOKEN && parser->cursor[length] != '\0' && strchr("+-.0123456789eE", parser->cursor[length]) != NULL) {
+                token[length] = parser->cursor[length];
+                length++;
+            }
+            token[length] = '\0';
+
+            char* token_end;
+            value->type = MS_JsonType_NUMBER;
+            value->number = strtod(token, &token_end);
+            if (length == 0 || token_end != token + length) {
+                parser->ok = false;
+            }
+            parser->cursor += length;
+        } break;
+    }
+    return parser->ok ? value : NULL;
+}
+
+internal MS_JsonValue* ms_json_parse(Arena* arena, const char* text, u64 size) {
+    MS_JsonParser parser = {
+        .arena = arena,
+        .cursor = text,
+        .end = text + size,
+        .depth = 0,
+        .ok = true,
+    };
+    MS_JsonValue* value = ms_json_parse_value(&parser);
+    // @note glb pads the json chunk with spaces
+    parser.cursor = ms_skip_whitespace(parser.cursor, parser.end);
+    return (parser.ok && parser.cursor == parser.end) ? value : NULL;
+}
+
+internal MS_JsonValue* ms_json_get(const MS_JsonValue* object, const char* key) {
+    if (object == NULL || object->type != MS_JsonType_OBJECT) {
+        return NULL;
+    }
+    u64 length = strlen(key);
+    for EachList(member, MS_JsonValue, object->first) {
+        if (member->key_length == length && memcmp(member->key, key, length) == 0) {
+            return member;
+        }
+    }
+    return NULL;
+}
+
+internal MS_JsonValue* ms_json_at(const MS_JsonValue* array, u64 index) {
+    if (array == NULL || array->type != MS_JsonType_ARRAY || index >= array->count) {
+        return NULL;
+    }
+    return array->items[index];
+}
+
+internal f64 ms_json_number(const MS_JsonValue* value, f64 fallback) {
+    return (value != NULL && (value->type == MS_JsonType_NUMBER || value->type == MS_JsonType_BOOL)) ? value->number : fallback;
+}
+
+internal b32 ms_json_string_eq(const MS_JsonValue* value, const char* str) {
+    u64 length = strlen(str);
+    return value != NULL && value->type == MS_JsonType_STRING && value->string_length == length && memcmp(value->string, str, length) == 0;
+}
+
+// gltf loading
+// an index into one of the top level arrays, MAX_U64 when missing or invalid
+static u64 ms_gltf_index(const MS_JsonValue* value, const MS_JsonValue* array) {
+    f64 index = ms_json_number(value, -1.0);
+    if (index < 0.0 || array == NULL || index >= (f64)array->count || index != floor(index)) {
+        return MAX_U64;
+    }
+    return (u64)index;
+}
+
+// a byte count or offset, negative and absurd values are clamped
+static u64 ms_gltf_size(const MS_JsonValue* value, u64 fallback) {
+    f64 size = ms_json_number(value, (f64)fallback);
+    return (u64)Clamp(size, 0.0, (f64)(1ull << 52));
+}
+
+static u64 ms_gltf_component_size(u32 component_type) {
+    switch (component_type) {
+        case MS_GLTF_COMPONENT_S8:  case MS_GLTF_COMPONENT_U8:  return 1;
+        case MS_GLTF_COMPONENT_S16: case MS_GLTF_COMPONENT_U16: return 2;
+        case MS_GLTF_COMPONENT_U32: case MS_GLTF_COMPONENT_F32: return 4;
+    }
+    return 0;
+}
+
+// resolves an accessor to where its elements sit in the binary chunk
+static b32 ms_gltf_accessor(const MS_GltfFile* gltf, u64 accessor_i, MS_GltfAccessor* out) {
+    MS_JsonValue* accessors = ms_json_get(gltf->json, "accessors");
+    MS_JsonValue* views = ms_json_get(gltf->json, "bufferViews");
+    MS_JsonValue* accessor = ms_json_at(accessors, accessor_i);
+    if (accessor == NULL || ms_json_get(accessor, "sparse") != NULL) {
+        return false;
+    }
+    MS_JsonValue* view = ms_json_at(views, ms_gltf_index(ms_json_get(accessor, "bufferView"), views));
+    if (view == NULL || ms_json_number(ms_json_get(view, "buffer"), -1.0) != 0.0) {
+        return false;
+    }
+
+    MS_JsonValue* type = ms_json_get(accessor, "type");
+    out->components = ms_json_string_eq(type, "SCALAR") ? 1 : ms_json_string_eq(type, "VEC2") ? 2 :
+                      ms_json_string_eq(type, "VEC3")   ? 3 : ms_json_string_eq(type, "VEC4") ? 4 : 0;
+    out->component_type = (u32)ms_gltf_size(ms_json_get(accessor, "componentType"), 0);
+    out->normalized = ms_json_number(ms_json_get(accessor, "normalized"), 0.0) != 0.0;
+    out->count = ms_gltf_size(ms_json_get(accessor, "count"), 0);
+    u64 element_size = ms_gltf_component_size(out->component_type)*out->components;
+    if (element_size == 0) {
+        return false;
+    }
+    out->stride = ms_gltf_size(ms_json_get(view, "byteStride"), element_size);
+
+    // @note checked one by one so corrupt sizes can't overflow
+    u64 view_offset = ms_gltf_size(ms_json_get(view, "byteOffset"), 0);
+    u64 view_length = ms_gltf_size(ms_json_get(view, "byteLength"), 0);
+    u64 offset = ms_gltf_size(ms_json_get(accessor, "byteOffset"), 0);
+    if (view_offset > gltf->bin_size || view_length > gltf->bin_size - view_offset || offset > view_length || out->stride < element_size) {
+        return false;
+    }
+    u64 available = view_length - offset;
+    if (out->count > 0 && (element_size > available || out->count - 1 > (available - element_size)/out->stride)) {
+        return false;
+    }
+    out->data = gltf->bin + view_offset + offset;
+    return true;
+}
+
+// reads component c of element i as a float, normalized integers map to [0, 1] or [-1, 1]
+static f32 ms_gltf_read_f32(const MS_GltfAccessor* accessor, u64 i, u32 c) {
+    const u8* p = accessor->data + i*accessor->stride + c*ms_gltf_component_size(accessor->component_type);
+    switch (accessor->component_type) {
+        case MS_GLTF_COMPONENT_S8:  { s8  v; memcpy(&v, p, sizeof(v)); return accessor->normalized ? Max(v/127.f, -1.f) : v; }
+        case MS_GLTF_COMPONENT_U8:  { u8  v; memcpy(&v, p, sizeof(v)); return accessor->normalized ? v/255.f : v; }
+        case MS_GLTF_COMPONENT_S16: { s16 v; memcpy(&v, p, sizeof(v)); return accessor->normalized ? Max(v/32767.f, -1.f) : v; }
+        case MS_GLTF_COMPONENT_U16: { u16 v; memcpy(&v, p, sizeof(v)); return accessor->normalized ? v/65535.f : v; }
+        case MS_GLTF_COMPONENT_U32: { u32 v; memcpy(&v, p, sizeof(v)); return (f32)v; }
+        case MS_GLTF_COMPONENT_F32: { f32 v; memcpy(&v, p, sizeof(v)); return v; }
+    }
+    return 0.f;
+}
+
+static u32 ms_gltf_read_u32(const MS_GltfAccessor* accessor, u64 i) {
+    const u8* p = accessor->data + i*accessor->stride;
+    switch (accessor->component_type) {
+        case MS_GLTF_COMPONENT_U8:  { u8  v; memcpy(&v, p, sizeof(v)); return v; }
+        case MS_GLTF_COMPONENT_U16: { u16 v; memcpy(&v, p, sizeof(v)); return v; }
+        case MS_GLTF_COMPONENT_U32: { u32 v; memcpy(&v, p, sizeof(v)); return v; }
+    }
+    return MAX_U32;
+}
+
+static b32 ms_gltf_load_primitive(const MS_GltfFile* gltf, Arena* arena, const MS_JsonValue* primitive, GEO_VertexAttributes attrs, MS_Mesh* out_mesh) {
+    static const struct {
+        const char* name;
+        GEO_VertexAttributes attr;
+        u32 components;
+    } semantics[] = {
+        {"POSITION",   GEO_VertexAttributes_P, 3},
+        {"NORMAL",     GEO_VertexAttributes_N, 3},
+        {"TEXCOORD_0", GEO_VertexAttributes_T, 2},
+    };
+
+    if (ms_json_number(ms_json_get(primitive, "mode"), MS_GLTF_MODE_TRIANGLES) != MS_GLTF_MODE_TRIANGLES) {
+        return false;
+    }
+    MS_JsonValue* accessors = ms_json_get(gltf->json, "accessors");
+    MS_JsonValue* attributes = ms_json_get(primitive, "attributes");
+
+    // without attributes asked for the primitive's are loaded
+    MS_GltfAccessor sources[ArrayLength(semantics)] = {0};
+    u32 present = 0;
+    for EachElement(i, semantics) {
+        MS_JsonValue* index = ms_json_get(attributes, semantics[i].name);
+        if (index == NULL) {
+            continue;
+        }
+        if (!ms_gltf_accessor(gltf, ms_gltf_index(index, accessors), &sources[i]) || sources[i].components != semantics[i].components) {
+            return false;
+        }
+        present |= semantics[i].attr;
+    }
+    if (!(present & GEO_VertexAttributes_P)) {
+        return false;
+    }
+    if (attrs == GEO_VertexAttributes_ZERO) {
+        attrs = IntToEnum(GEO_VertexAttributes, present);
+    }
+
+    MS_Mesh mesh;
+    mesh.primitive = GEO_Primitive_TRI_LIST;
+    mesh.attrs = attrs;
+    mesh.vertices_count = (u32)sources[0].count;
+
+    // @note used in place when every attribute is a float at its offset in
+    // a shared vertex stride, what's rare from exporters but free to check
+    u64 vertex_size = geo_vertex_size(attrs);
+    const u8* base = sources[0].data - geo_vertex_offset(attrs, GEO_VertexAttributes_P);
+    b32 in_place = (u64)base % geo_vertex_align(attrs) == 0 && base >= gltf->bin &&
+        (u64)(gltf->bin + gltf->bin_size - base) >= vertex_size*mesh.vertices_count;
+    for EachElement(i, semantics) {
+        if (!(attrs & semantics[i].attr)) {
+            continue;
+        }
+        in_place = in_place && (present & semantics[i].attr) && sources[i].count == mesh.vertices_count &&
+            sources[i].component_type == MS_GLTF_COMPONENT_F32 && sources[i].stride == vertex_size &&
+            sources[i].data == base + geo_vertex_offset(attrs, semantics[i].attr);
+    }
+
+    if (in_place) {
+        mesh.vertices = (void*)base;
+    } else {
+        u8* vertices = push_array_aligned(arena, u8, vertex_size*mesh.vertices_count, geo_vertex_align(attrs));
+        for EachElement(i, semantics) {
+            if (!(attrs & semantics[i].attr) || !(present & semantics[i].attr)) {
+                continue;
+            }
+            u64 count = Min(sources[i].count, (u64)mesh.vertices_count);
+            for EachIndex(v, count) {
+                f32* out = (f32*)(vertices + geo_vertex_i_offset(attrs, semantics[i].attr, v));
+                for EachIndexU32(c, semantics[i].components) {
+                    out[c] = ms_gltf_read_f32(&sources[i], v, c);
                 }
-            } else if (ntstr8_begins_with(line, "v ")) {
-                sscanf(line.cstr, "v %f %f %f", 
-                    &positions[off_positions].x,
-                    &positions[off_positions].y,
-                    &positions[off_positions].z
-                );
-                off_positions++;
-            } else if (ntstr8_begins_with(line, "vn ")) {
-                sscanf(line.cstr, "vn %f %f %f", 
-                    &normals[off_normals].x,
-                    &normals[off_normals].y,
-                    &normals[off_normals].z
-                );
-                off_normals++;
-            } else if (ntstr8_begins_with(line, "vt ")) {
-                sscanf(line.cstr, "vt %f %f", 
-                    &uvs[off_uvs].x,
-                    &uvs[off_uvs].y
-                );
-                off_uvs++;
-            }
-        }
-        mesh.vertices_count = vertex_map.vertices_count;
-        mesh.vertices = ms_vertex_map_data(arena, &vertex_map, positions, normals, uvs, settings.attrs);
+            }
+        }
+        mesh.vertices = vertices;
+    }
+
+    // indices are used in place when they're tightly packed u32s
+    mesh.indices = NULL;
+    mesh.indices_count = 0;
+    MS_JsonValue* indices_index = ms_json_get(primitive, "indices");
+    if (indices_index != NULL) {
+        MS_GltfAccessor indices;
+        if (!ms_gltf_accessor(gltf, ms_gltf_index(indices_index, accessors), &indices) || indices.components != 1) {
+            return false;
+        }
+        mesh.indices_count = (u32)indices.count;
+        if (indices.component_type == MS_GLTF_COMPONENT_U32 && indices.stride == sizeof(u32) && (u64)indices.data % sizeof(u32) == 0) {
+            mesh.indices = (u32*)indices.data;
+        } else {
+            mesh.indices = push_array_no_zero(arena, u32, mesh.indices_count);
+            for EachIndex(i, indices.count) {
+                mesh.indices[i] = ms_gltf_read_u32(&indices, i);
+            }
+        }
+        for EachIndex(i, indices.count) {
+            if (mesh.indices[i] >= mesh.vertices_count) {
+                return false;
+            }
+        }
+    }
+    if ((mesh.indices_count ? mesh.indices_count : mesh.vertices_count) % 3 != 0) {
+        return false;
+    }
+
+    *out_mesh = mesh;
+    return true;
+}
+
+// the node's transform relative to its parent
+static MS_SceneInstance ms_gltf_node_transform(const MS_JsonValue* node) {
+    MS_SceneInstance result = {
+        .mesh = 0,
+        .translation = make_3f32(0.f, 0.f, 0.f),
+        .rotation = make_identity_quat(),
+        .scale = make_scale_3f32(1.f),
+    };
+
+    MS_JsonValue* matrix = ms_json_get(node, "matrix");
+    if (matrix != NULL && matrix->count == 16) {
+        // @note column major, decomposed into translation, rotation and scale
+        f32 m[4][4];
+        for EachIndex(i, 16) {
+            m[i/4][i%4] = (f32)ms_json_number(ms_json_at(matrix, i), 0.0);
+        }
+        vec3_f32 columns[3];
+        for EachIndex(c, 3) {
+            columns[c] = make_3f32(m[c][0], m[c][1], m[c][2]);
+        }
+        result.translation = make_3f32(m[3][0], m[3][1], m[3][2]);
+        result.scale = make_3f32(length_3f32(columns[0]), length_3f32(columns[1]), length_3f32(columns[2]));
+        if (dot_3f32(cross_3f32(columns[0], columns[1]), columns[2]) < 0.f) {
+            result.scale.x = -result.scale.x;
+        }
+        for EachIndex(c, 3) {
+            columns[c] = (result.scale.v[c] != 0.f) ? mul_3f32(columns[c], 1.f/result.scale.v[c]) : columns[c];
+        }
+
+        // r[row][column] of the rotation
+        #define R(row, column) columns[column].v[row]
+        f32 trace = R(0,0) + R(1,1) + R(2,2);
+        vec4_f32 q;
+        if (trace > 0.f) {
+            f32 s = sqrt_f32(trace + 1.f)*2.f;
+            q = make_4f32((R(2,1) - R(1,2))/s, (R(0,2) - R(2,0))/s, (R(1,0) - R(0,1))/s, 0.25f*s);
+        } else if (R(0,0) > R(1,1) && R(0,0) > R(2,2)) {
+            f32 s = sqrt_f32(1.f + R(0,0) - R(1,1) - R(2,2))*2.f;
+            q = make_4f32(0.25f*s, (R(0,1) + R(1,0))/s, (R(0,2) + R(2,0))/s, (R(2,1) - R(1,2))/s);
+        } else if (R(1,1) > R(2,2)) {
+            f32 s = sqrt_f32(1.f + R(1,1) - R(0,0) - R(2,2))*2.f;
+            q = make_4f32((R(0,1) + R(1,0))/s, 0.25f*s, (R(1,2) + R(2,1))/s, (R(0,2) - R(2,0))/s);
+        } else {
+            f32 s = sqrt_f32(1.f + R(2,2) - R(0,0) - R(1,1))*2.f;
+            q = make_4f32((R(0,2) + R(2,0))/s, (R(1,2) + R(2,1))/s, 0.25f*s, (R(1,0) - R(0,1))/s);
+        }
+        #undef R
+        result.rotation = normalize_4f32(q);
+        return result;
+    }
+
+    MS_JsonValue* translation = ms_json_get(node, "translation");
+    MS_JsonValue* rotation = ms_json_get(node, "rotation");
+    MS_JsonValue* scale = ms_json_get(node, "scale");
+    for EachIndex(i, 3) {
+        result.translation.v[i] = (f32)ms_json_number(ms_json_at(translation, i), 0.0);
+        result.scale.v[i] = (f32)ms_json_number(ms_json_at(scale, i), 1.0);
+    }
+    if (rotation != NULL) {
+        for EachIndex(i, 4) {
+            result.rotation.v[i] = (f32)ms_json_number(ms_json_at(rotation, i), (i == 3) ? 1.0 : 0.0);
+        }
+    }
+    return result;
+}
+
+// child placed under parent
+static MS_SceneInstance ms_gltf_compose(MS_SceneInstance parent, MS_SceneInstance child) {
+    MS_SceneInstance result = child;
+    result.translation = add_3f32(rot_quat(elmul_3f32(child.translation, parent.scale), parent.rotation), parent.translation);
+    result.rotation = mul_quat(parent.rotation, child.rotation);
+    result.scale = elmul_3f32(parent.scale, child.scale);
+    return result;
+}
+
+internal MS_SceneLoadResult ms_load_gltf(Arena* arena, NTString8 path, MS_LoadSettings settings, OS_FileMap* out_file) {
+    MS_SceneLoadResult result = zero_struct;
+    if (!os_map_file(path, out_file)) {
+        result.error = ntstr8_lit("Failed to open file");
+        return result;
+    }
+    if (settings.primitive != GEO_Primitive_ZERO && settings.primitive != GEO_Primitive_TRI_LIST) {
+        result.error = ntstr8_lit("Gltf files only load as triangle lists");
+    }
+
+    {DeferResource(Temp scratch = scratch_begin_a(arena), scratch_end(scratch)) {
+        // header, json chunk and the optional binary chunk
+        const u8* data = out_file->data;
+        u32 header[5] = {0};
+        if (result.error.length == 0 && out_file->size >= sizeof(header)) {
+            memcpy(header, data, sizeof(header));
+        }
+        u64 json_size = header[3];
+        if (result.error.length == 0 && (header[0] != MS_GLB_MAGIC || header[1] != 2 || header[4] != MS_GLB_CHUNK_JSON || json_size > out_file->size - sizeof(header))) {
+            result.error = ntstr8_lit("Not a glb file");
+        }
+
+        MS_GltfFile gltf = zero_struct;
+        if (result.error.length == 0) {
+            u64 bin_offset = sizeof(header) + AlignPow2(json_size, 4);
+            u32 bin_header[2] = {0};
+            if (bin_offset + sizeof(bin_header) <= out_file->size) {
+                memcpy(bin_header, data + bin_offset, sizeof(bin_header));
+            }
+            if (bin_header[1] == MS_GLB_CHUNK_BIN && bin_header[0] <= out_file->size - bin_offset - sizeof(bin_header)) {
+                gltf.bin = data + bin_offset + sizeof(bin_header);
+                gltf.bin_size = bin_header[0];
+            }
+
+            gltf.json = ms_json_parse(scratch.arena, (const char*)data + sizeof(header), json_size);
+            MS_JsonValue* buffers = ms_json_get(gltf.json, "buffers");
+            if (gltf.json == NULL) {
+                result.error = ntstr8_lit("Corrupt gltf json");
+            } else if (buffers != NULL && (buffers->count > 1 || ms_json_get(ms_json_at(buffers, 0), "uri") != NULL)) {
+                result.error = ntstr8_lit("Gltf buffers outside of the glb file are not supported");
+            }
+        }
+
+        // a mesh for every primitive
+        MS_JsonValue* meshes = ms_json_get(gltf.json, "meshes");
+        u32* first_primitive = NULL;
+        if (result.error.length == 0) {
+            first_primitive = push_array(scratch.arena, u32, meshes ? meshes->count + 1 : 1);
+            u32 primitives_count = 0;
+            for EachIndex(mesh_i, (meshes ? meshes->count : 0)) {
+                first_primitive[mesh_i] = primitives_count;
+                MS_JsonValue* primitives = ms_json_get(ms_json_at(meshes, mesh_i), "primitives");
+                primitives_count += primitives ? (u32)primitives->count : 0;
+            }
+            first_primitive[meshes ? meshes->count : 0] = primitives_count;
+
+            result.v.meshes = push_array(arena, MS_Mesh, primitives_count);
+            for EachIndex(mesh_i, (meshes ? meshes->count : 0)) {
+                MS_JsonValue* primitives = ms_json_get(ms_json_at(meshes, mesh_i), "primitives");
+                for (u64 i = 0; i < (primitives ? primitives->count : 0) && result.error.length == 0; i++) {
+                    MS_Mesh* mesh = &result.v.meshes[result.v.meshes_count++];
+                    if (!ms_gltf_load_primitive(&gltf, arena, ms_json_at(primitives, i), settings.attrs, mesh)) {
+                        result.error = ntstr8_lit("Unsupported or corrupt gltf primitive");
+                    }
+                }
+            }
+        }
+
+        // walk the nodes from the roots of the scene, or from every node no
+        // other node has as a child when there's no scene
+        MS_JsonValue* nodes = ms_json_get(gltf.json, "nodes");
+        u64 nodes_count = nodes ? nodes->count : 0;
+        if (result.error.length == 0 && nodes_count > 0) {
+            u64* stack = push_array_no_zero(scratch.arena, u64, nodes_count);
+            MS_SceneInstance* transforms = push_array_no_zero(scratch.arena, MS_SceneInstance, nodes_count);
+            b8* seen = push_array(scratch.arena, b8, nodes_count);
+            u64 stack_count = 0;
+
+            MS_JsonValue* scenes = ms_json_get(gltf.json, "scenes");
+            MS_JsonValue* scene = ms_json_at(scenes, ms_gltf_size(ms_json_get(gltf.json, "scene"), 0));
+            if (scene != NULL) {
+                MS_JsonValue* roots = ms_json_get(scene, "nodes");
+                for EachIndex(i, (roots ? roots->count : 0)) {
+                    u64 node_i = ms_gltf_index(ms_json_at(roots, i), nodes);
+                    if (node_i != MAX_U64 && !seen[node_i]) {
+                        seen[node_i] = true;
+                        stack[stack_count++] = node_i;
+                    }
+                }
+            } else {
+                b8* is_child = push_array(scratch.arena, b8, nodes_count);
+                for EachIndex(node_i, nodes_count) {
+                    MS_JsonValue* children = ms_json_get(ms_json_at(nodes, node_i), "children");
+                    for EachIndex(i, (children ? children->count : 0)) {
+                        u64 child_i = ms_gltf_index(ms_json_at(children, i), nodes);
+                        if (child_i != MAX_U64) {
+                            is_child[child_i] = true;
+                        }
+                    }
+                }
+                for EachIndex(node_i, nodes_count) {
+                    if (!is_child[node_i]) {
+                        seen[node_i] = true;
+                        stack[stack_count++] = node_i;
+                    }
+                }
+            }
+            for EachIndex(i, stack_count) {
+                transforms[stack[i]] = ms_gltf_node_transform(ms_json_at(nodes, stack[i]));
+            }
+
+            // @note a node is only ever pushed once, so the stack can't
+            // outgrow the nodes even when a broken file has cycles
+            MS_ChunkList instances = ms_make_chunk_list(MS_SceneInstance);
+            while (stack_count > 0) {
+                u64 node_i = stack[--stack_count];
+                MS_JsonValue* node = ms_json_at(nodes, node_i);
+                u64 mesh_i = ms_gltf_index(ms_json_get(node, "mesh"), meshes);
+                if (mesh_i != MAX_U64) {
+                    for (u32 primitive_i = first_primitive[mesh_i]; primitive_i < first_primitive[mesh_i + 1]; primitive_i++) {
+                        MS_SceneInstance* instance = ms_chunk_list_push(scratch.arena, &instances, MS_SceneInstance);
+                        *instance = transforms[node_i];
+                        instance->mesh = primitive_i;
+                    }
+                }
+
+                MS_JsonValue* children = ms_json_get(node, "children");
+                for EachIndex(i, (children ? children->count : 0)) {
+                    u64 child_i = ms_gltf_index(ms_json_at(children, i), nodes);
+                    if (child_i != MAX_U64 && !seen[child_i]) {
+                        seen[child_i] = true;
+                        transforms[child_i] = ms_gltf_compose(transforms[node_i], ms_gltf_node_transform(ms_json_at(nodes, child_i)));
+                        stack[stack_count++] = child_i;
+                    }
+                }
+            }
+            result.v.instances_count = (u32)instances.count;
+            result.v.instances = (MS_SceneInstance*)ms_chunk_list_flatten(arena, &instances);
+        }
     }}
-    
-    os_close_file(file);
-    return (MS_LoadResult) { .v = mesh, .error = ntstr8_lit_init("") };;
-}
\ No newline at end of file
+
+    if (result.error.length > 0) {
+        os_unmap_file(*out_file);
+        MemoryZeroStruct(out_file);
+        result.v = (MS_Scene)zero_struct;
+    } else {
+        result.error = ntstr8_lit("");
+    }
+    return result;
+}
+
+// ============================================================================
+// native mesh files
+// ============================================================================
+// @note written next to path and renamed over it, readers never map a partial file
+static b8 ms_write_binary(NTString8 path, const MS_Mesh* mesh, OS_FileInfo source) {
+    u64 vertices_size = geo_vertex_size(mesh->attrs)*mesh->vertices_count;
+    u64 indices_size = sizeof(u32)*mesh->indices_count;
+
+    MS_BinaryHeader header = zero_struct;
+    header.magic = MS_BINARY_MAGIC;
+    header.version = MS_BINARY_VERSION;
+    header.primitive = mesh->primitive;
+    header.attrs = mesh->attrs;
+    header.vertex_size = (u32)geo_vertex_size(mesh->attrs);
+    header.vertices_count = mesh->vertices_count;
+    header.indices_count = mesh->indices_count;
+    header.vertices_offset = AlignPow2(sizeof(header), MS_BINARY_ALIGN);
+    header.indices_offset = AlignPow2(header.vertices_offset + vertices_size, MS_BINARY_ALIGN);
+    header.source_size = source.size;
+    header.source_modified = source.modified;
+
+    b8 ok = false;
+    {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
+        NTString8 temp_path = ntstr8_concatenate(scratch.arena, path, ntstr8_lit(".tmp"));
+        OS_Handle file = os_open_writeonly_file(temp_path);
+        if (!os_is_handle_zero(file)) {
+            static const u8 padding[MS_BINARY_ALIGN] = {0};
+            u64 vertices_padding = header.vertices_offset - sizeof(header);
+            u64 indices_padding = header.indices_offset - (header.vertices_offset + vertices_size);
+
+            ok = os_write_file(file, &header, sizeof(header)) == sizeof(header);
+            ok = ok && os_write_file(file, padding, vertices_padding) == vertices_padding;
+            ok = ok && os_write_file(file, mesh->vertices, vertices_size) == vertices_size;
+            ok = ok && os_write_file(file, padding, indices_padding) == indices_padding;
+            ok = ok && os_write_file(file, mesh->indices, indices_size) == indices_size;
+            os_close_file(file);
+
+            ok = ok && os_rename_file(temp_path, path);
+            if (!ok) {
+                os_delete_file(temp_path);
+            }
+        }
+    }}
+    return ok;
+}
+
+internal b8 ms_save_binary(NTString8 path, const MS_Mesh* mesh) {
+    return ms_write_binary(path, mesh, (OS_FileInfo)zero_struct);
+}
+
+static MS_LoadResult ms_map_binary_error(OS_FileMap* file, NTString8 error) {
+    os_unmap_file(*file);
+    MemoryZeroStruct(file);
+    return (MS_LoadResult) { .error = error };
+}
+
+internal MS_LoadResult ms_map_binary(NTString8 path, OS_FileMap* out_file) {
+    if (!os_map_file(path, out_file)) {
+        return (MS_LoadResult) { .error = ntstr8_lit_init("Failed to open file") };
+    }
+
+    MS_BinaryHeader header;
+    if (out_file->size < sizeof(header)) {
+        return ms_map_binary_error(out_file, ntstr8_lit("Not a mesh file"));
+    }
+    memcpy(&header, out_file->data, sizeof(header));
+    if (header.magic != MS_BINARY_MAGIC) {
+        return ms_map_binary_error(out_file, ntstr8_lit("Not a mesh file"));
+    }
+    if (header.version != MS_BINARY_VERSION) {
+        return ms_map_binary_error(out_file, ntstr8_lit("Unsupported mesh file version"));
+    }
+
+    // @note sizes are checked one by one so a corrupt count can't overflow them
+    b32 valid = header.primitive > GEO_Primitive_ZERO && header.primitive < GEO_Primitive_COUNT &&
+        header.attrs > GEO_VertexAttributes_ZERO && header.attrs < GEO_VertexAttributes_COUNT;
+    if (valid) {
+        GEO_VertexAttributes attrs = IntToEnum(GEO_VertexAttributes, header.attrs);
+        u64 vertices_size = (u64)header.vertex_size*header.vertices_count;
+        u64 indices_size = sizeof(u32)*(u64)header.indices_count;
+        valid = header.vertex_size == geo_vertex_size(attrs) &&
+            header.vertices_offset % MS_BINARY_ALIGN == 0 && header.indices_offset % MS_BINARY_ALIGN == 0 &&
+            header.vertices_offset <= out_file->size && vertices_size <= out_file->size - header.vertices_offset &&
+            header.indices_offset <= out_file->size && indices_size <= out_file->size - header.indices_offset;
+    }
+    if (!valid) {
+        return ms_map_binary_error(out_file, ntstr8_lit("Corrupt mesh file"));
+    }
+
+    MS_Mesh mesh;
+    mesh.primitive = IntToEnum(GEO_Primitive, header.primitive);
+    mesh.attrs = IntToEnum(GEO_VertexAttributes, header.attrs);
+    mesh.vertices_count = header.vertices_count;
+    mesh.indices_count = header.indices_count;
+    mesh.vertices = (void*)(out_file->data + header.vertices_offset);
+    mesh.indices = (u32*)(out_file->data + header.indices_offset);
+    return (MS_LoadResult) { .v = mesh, .error = ntstr8_lit_init("") };
+}
+
+internal MS_LoadResult ms_convert_obj(Arena* arena, NTString8 obj_path, NTString8 path, MS_LoadSettings settings, OS_FileMap* out_file) {
+    OS_FileInfo source = zero_struct;
+    b8 has_source = os_file_info(obj_path, &source);
+    MS_LoadSettings resolved = ms_obj_resolve_settings(settings);
+
+    MemoryZeroStruct(out_file);
+    MS_LoadResult result = ms_map_binary(path, out_file);
+    if (result.error.length == 0) {
+        MS_BinaryHeader header;
+        memcpy(&header, out_file->data, sizeof(header));
+        b8 current = !has_source || (header.source_size == source.size && header.source_modified == source.modified);
+        if (current && result.v.primitive == resolved.primitive && result.v.attrs == resolved.attrs) {
+            return result;
+        }
+        os_unmap_file(*out_file);
+        MemoryZeroStruct(out_file);
+    }
+
+    // @note a mesh that can't be saved is converted again next time
+    result = ms_load_obj(arena, obj_path, settings);
+    if (result.error.length == 0) {
+        ms_write_binary(path, &result.v, source);
+    }
+    return result;
+}
@@ -27,19 +27,349 @@ struct MS_VertexMapHash {
     u32 indices[3];
 };
 
-typedef struct MS_VertexMapNode MS_VertexMapNode;
-struct MS_VertexMapNode {
-    MS_VertexMapNode* next;
+// open addressing map from a corner to its vertex, the vertices are numbered
+// in the order they're added and their keys kept in that order
+typedef struct MS_VertexMapSlot MS_VertexMapSlot;
+struct MS_VertexMapSlot {
     MS_VertexMapHash hash;
     u32 index;
 };
 
+#define MS_VERTEX_MAP_EMPTY MAX_U32
+// grows past this many vertices per 8 slots
+#define MS_VERTEX_MAP_MAX_LOAD 6
+
 typedef struct MS_VertexMap MS_VertexMap;
 struct MS_VertexMap {
-    MS_VertexMapNode** slots;
+    MS_VertexMapSlot* slots;
     u32 slots_count;
     u32 vertices_count;
+    u32 vertices_capacity;
+    MS_VertexMapHash* vertices;
+};
+
+// items appended in chunks pushed onto an arena, so a buffer can grow without
+// knowing its size up front or moving what's in it
+typedef struct MS_Chunk MS_Chunk;
+struct MS_Chunk {
+    MS_Chunk* next;
+    u64 count;
+    u8* data;
+};
+
+typedef struct MS_ChunkList MS_ChunkList;
+struct MS_ChunkList {
+    MS_Chunk* first;
+    MS_Chunk* last;
+    u64 count;
+    u64 item_size;
+};
+
+#define MS_CHUNK_ITEMS 4096
+
+#define ms_make_chunk_list(T) ((MS_ChunkList){.item_size = sizeof(T)})
+#define ms_chunk_list_push(arena, list, T) ((T*)ms_chunk_list_push_((arena), (list)))
+
+internal void* ms_chunk_list_push_(Arena* arena, MS_ChunkList* list);
+internal void* ms_chunk_list_flatten(Arena* arena, const MS_ChunkList* list);
+
+// obj tokenizing, cursor moves past what was parsed. they take what sscanf's
+// %u and %f take and give the same results
+internal const char* ms_skip_whitespace(const char* cursor, const char* end);
+internal b32 ms_parse_char(const char** cursor, const char* end, char c);
+internal b32 ms_parse_u32(const char** cursor, const char* end, u32* out);
+internal b32 ms_parse_f32(const char** cursor, const char* end, f32* out);
+
+// tokens longer than this go to strtof cut off
+#define MS_MAX_FLOAT_TOKEN 64
+
+// parallel obj loading. the mapped file is split at line boundaries and the
+// chunks are parsed at the same time, each into its own arena. the corners are
+// then bucketed into partitions by position index so every partition
+// deduplicates its vertices on its own, and vertices are numbered in the order
+// a serial load would have found them
+#define MS_OBJ_CHUNK_SIZE MB(4)
+#define MS_OBJ_BLOCK_SIZE 65536
+
+typedef struct MS_ObjChunk MS_ObjChunk;
+struct MS_ObjChunk {
+    const char* begin;
+    const char* end;
+    Arena* arena;
+
+    MS_ChunkList positions;
+    MS_ChunkList normals;
+    MS_ChunkList uvs;
+    MS_ChunkList corners;
+    // corners that fall into each partition, then where they go in it
+    u64* partition_counts;
+    u64* partition_offsets;
+
+    // where the chunk goes in the merged arrays
+    u64 positions_base;
+    u64 normals_base;
+    u64 uvs_base;
+    u64 corners_base;
+};
+
+typedef struct MS_ObjPartition MS_ObjPartition;
+struct MS_ObjPartition {
+    Arena* arena;
+    // indices of the corners in the partition, ascending
+    u32* corners;
+    u64 corners_count;
+
+    MS_VertexMap map;
+    // the corner each vertex of map was first seen at
+    u32* first_corners;
+};
+
+typedef struct MS_ObjLoader MS_ObjLoader;
+struct MS_ObjLoader {
+    GEO_VertexAttributes attrs;
+    int vertices_per_face;
+
+    MS_ObjChunk* chunks;
+    u64 chunks_count;
+    MS_ObjPartition* partitions;
+    u32 partitions_count;
+    u32 partition_vertices_estimate;
+
+    // merged attributes and corners
+    vec3_f32* positions;
+    vec3_f32* normals;
+    vec2_f32* uvs;
+    MS_VertexMapHash* corners;
+    u64 corners_count;
+
+    // per corner, its vertex in the partition map and whether it's the first
+    // use of it. first corners get the vertex index of the mesh
+    u32* local_ids;
+    u8* is_first;
+    u32* first_ids;
+    // first corners before each block of MS_OBJ_BLOCK_SIZE corners
+    u64* block_offsets;
+
+    u8* vertices;
+    u32* indices;
+};
+
+// ply files, the header describes elements made of scalar and list
+// properties which follow as ascii or binary values in either byte order.
+// vertex and face elements are decoded as they're read, other elements skipped
+typedef enum MS_PlyFormat {
+    MS_PlyFormat_ASCII,
+    MS_PlyFormat_BINARY_LE,
+    MS_PlyFormat_BINARY_BE,
+    MS_PlyFormat_Count ENUM_CASE_UNUSED,
+} MS_PlyFormat;
+
+typedef enum MS_PlyType {
+    MS_PlyType_NONE,
+    MS_PlyType_S8,
+    MS_PlyType_U8,
+    MS_PlyType_S16,
+    MS_PlyType_U16,
+    MS_PlyType_S32,
+    MS_PlyType_U32,
+    MS_PlyType_F32,
+    MS_PlyType_F64,
+    MS_PlyType_Count ENUM_CASE_UNUSED,
+} MS_PlyType;
+
+#define MS_PLY_MAX_NAME 32
+#define MS_PLY_MAX_PROPERTIES 32
+#define MS_PLY_MAX_ELEMENTS 16
+
+typedef struct MS_PlyProperty MS_PlyProperty;
+struct MS_PlyProperty {
+    char name[MS_PLY_MAX_NAME];
+    MS_PlyType type;
+    // type of the length of lists, NONE for scalars
+    MS_PlyType count_type;
+
+    // what a vertex property is decoded into, ZERO for nothing
+    GEO_VertexAttributes attr;
+    u32 component;
+};
+
+typedef struct MS_PlyElement MS_PlyElement;
+struct MS_PlyElement {
+    char name[MS_PLY_MAX_NAME];
+    u64 count;
+    MS_PlyProperty properties[MS_PLY_MAX_PROPERTIES];
+    u32 properties_count;
+};
+
+typedef struct MS_PlyHeader MS_PlyHeader;
+struct MS_PlyHeader {
+    MS_PlyFormat format;
+    MS_PlyElement elements[MS_PLY_MAX_ELEMENTS];
+    u32 elements_count;
+    // size of the header, where the data starts
+    u64 size;
+};
+
+typedef struct MS_PlyReader MS_PlyReader;
+struct MS_PlyReader {
+    const char* cursor;
+    const char* end;
+    MS_PlyFormat format;
+    b32 ok;
+};
+
+// json, just enough to read gltf. values point into the text, strings keep
+// their escapes
+typedef enum MS_JsonType {
+    MS_JsonType_NULL,
+    MS_JsonType_BOOL,
+    MS_JsonType_NUMBER,
+    MS_JsonType_STRING,
+    MS_JsonType_ARRAY,
+    MS_JsonType_OBJECT,
+    MS_JsonType_Count ENUM_CASE_UNUSED,
+} MS_JsonType;
+
+#define MS_JSON_MAX_DEPTH 64
+
+typedef struct MS_JsonValue MS_JsonValue;
+struct MS_JsonValue {
+    MS_JsonType type;
+    // name of the member when in an object
+    const char* key;
+    u64 key_length;
+
+    // numbers and bools
+    f64 number;
+    const char* string;
+    u64 string_length;
+
+    // members and items, indexable once the value is parsed
+    MS_JsonValue* first;
+    MS_JsonValue* last;
+    MS_JsonValue** items;
+    u64 count;
+    MS_JsonValue* next;
+};
+
+typedef struct MS_JsonParser MS_JsonParser;
+struct MS_JsonParser {
+    Arena* arena;
+    const char* cursor;
+    const char* end;
+    u32 depth;
+    b32 ok;
+};
+
+// NULL if the text isn't valid json
+internal MS_JsonValue* ms_json_parse(Arena* arena, const char* text, u64 size);
+// NULL when missing or of another type
+internal MS_JsonValue* ms_json_get(const MS_JsonValue* object, const char* key);
+internal MS_JsonValue* ms_json_at(const MS_JsonValue* array, u64 index);
+// bools are 1 or 0
+internal f64           ms_json_number(const MS_JsonValue* value, f64 fallback);
+internal b32           ms_json_string_eq(const MS_JsonValue* value, const char* str);
+
+// scenes, meshes and where instances of them are placed
+typedef struct MS_SceneInstance MS_SceneInstance;
+struct MS_SceneInstance {
+    u32 mesh;
+    vec3_f32 translation;
+    vec4_f32 rotation;
+    vec3_f32 scale;
+};
+
+typedef struct MS_Scene MS_Scene;
+struct MS_Scene {
+    MS_Mesh* meshes;
+    u32 meshes_count;
+    MS_SceneInstance* instances;
+    u32 instances_count;
+};
+
+typedef struct MS_SceneLoadResult MS_SceneLoadResult;
+struct MS_SceneLoadResult {
+    MS_Scene v;
+    NTString8 error;
+};
+
+// glb files, a json chunk describing the scene and a binary chunk holding the
+// buffers. accessors laid out like MS_Mesh has them are used in place
+#define MS_GLB_MAGIC      0x46546C67 // "glTF"
+#define MS_GLB_CHUNK_JSON 0x4E4F534A // "JSON"
+#define MS_GLB_CHUNK_BIN  0x004E4942 // "BIN\0"
+
+#define MS_GLTF_COMPONENT_S8  5120
+#define MS_GLTF_COMPONENT_U8  5121
+#define MS_GLTF_COMPONENT_S16 5122
+#define MS_GLTF_COMPONENT_U16 5123
+#define MS_GLTF_COMPONENT_U32 5125
+#define MS_GLTF_COMPONENT_F32 5126
+#define MS_GLTF_MODE_TRIANGLES 4
+
+typedef struct MS_GltfAccessor MS_GltfAccessor;
+struct MS_GltfAccessor {
+    const u8* data;
+    u64 count;
+    u64 stride;
+    u32 component_type;
+    u32 components;
+    b32 normalized;
+};
+
+typedef struct MS_GltfFile MS_GltfFile;
+struct MS_GltfFile {
+    MS_JsonValue* json;
+    const u8* bin;
+    u64 bin_size;
 };
 
 // loaders
-internal MS_LoadResult ms_load_obj(Arena* arena, NTString8 path, MS_LoadSettings settings);
\ No newline at end of file
+internal MS_LoadResult ms_load_obj(Arena* arena, NTString8 path, MS_LoadSettings settings);
+// @note polygons are triangulated as fans, only triangle lists are supported
+internal MS_LoadResult ms_load_ply(Arena* arena, NTString8 path, MS_LoadSettings settings);
+// every triangle primitive becomes a mesh and every node using it an instance
+// with its transform from the root. meshes may point into *out_file, unmap it
+// when done with them.
+// @note instances carry translation, rotation and scale, a parent's scale is
+// only exact when it's uniform
+internal MS_SceneLoadResult ms_load_gltf(Arena* arena, NTString8 path, MS_LoadSettings settings, OS_FileMap* out_file);
+// ============================================================================
+// native mesh files
+// ============================================================================
+// a header and the vertex and index buffers laid out like MS_Mesh has them in
+// memory, each starting on an MS_BINARY_ALIGN byte boundary. mapped meshes
+// point straight into the file, so loading is free and processes mapping the
+// same file share its pages
+#define MS_BINARY_MAGIC   0x4853454d // "MESH" little endian
+#define MS_BINARY_VERSION 2
+#define MS_BINARY_ALIGN   16
+
+typedef struct MS_BinaryHeader MS_BinaryHeader;
+struct MS_BinaryHeader {
+    u32 magic;
+    u32 version;
+    u32 primitive;
+    u32 attrs;
+    // @note checked against geo_vertex_size, a changed layout needs a new version
+    u32 vertex_size;
+    u32 vertices_count;
+    u32 indices_count;
+    u32 reserved;
+    u64 vertices_offset;
+    u64 indices_offset;
+    // size and modification time of the file the mesh was converted from, 0
+    // when there was none
+    u64 source_size;
+    u64 source_modified;
+};
+StaticAssert(sizeof(MS_BinaryHeader) == 64, ms_binary_header_size_check);
+
+internal b8 ms_save_binary(NTString8 path, const MS_Mesh* mesh);
+// @note the mesh is read only and lives until os_unmap_file(*out_file)
+internal MS_LoadResult ms_map_binary(NTString8 path, OS_FileMap* out_file);
+// maps the mesh converted from the obj at obj_path to path before. the obj is
+// loaded into arena and converted again when path has none or the obj's size
+// or modification time changed since, without the obj any mesh at path is used
+// @note saving is best effort, out_file stays zero when the mesh lives in arena
+internal MS_LoadResult ms_convert_obj(Arena* arena, NTString8 obj_path, NTString8 path, MS_LoadSettings settings, OS_FileMap* out_file);
@@ -6,6 +6,37 @@ internal force_inline FILE* os_handle_to_FILE(OS_Handle file) {
     return (FILE*)file.v64[0];
 }
 
+// sockets
+// @note offset by one so descriptor 0 isn't the zero handle
+internal force_inline int os_handle_to_fd(OS_Handle socket) {
+    return (int)socket.v64[0] - 1;
+}
+
+internal force_inline OS_Handle os_fd_to_handle(int fd) {
+    OS_Handle handle = zero_struct;
+    if (fd >= 0) {
+        handle.v64[0] = (u64)fd + 1;
+    }
+    return handle;
+}
+
+static bool os_linux_socket_address(NTString8 path, struct sockaddr_un* out_address) {
+    MemoryZeroStruct(out_address);
+    out_address->sun_family = AF_UNIX;
+    if (path.length >= sizeof(out_address->sun_path)) {
+        return false;
+    }
+    memcpy(out_address->sun_path, path.cstr, path.length);
+    return true;
+}
+
+// threads
+static void* os_linux_thread_entry(void* ptr) {
+    OS_LinuxThread* thread = (OS_LinuxThread*)ptr;
+    thread->func(thread->data);
+    return NULL;
+}
+
 // 
 // hooks
 // 
@@ -40,6 +71,187 @@ internal void os_read_line_to_buffer_ml(OS_Handle file, NTString8* str, u64 buff
     str->length = strlen(str->cstr);
 }
 
+internal OS_Handle os_open_writeonly_file(NTString8 path) {
+    OS_Handle handle = zero_struct;
+    handle.v64[0] = (u64)fopen(path.cstr, "wb");
+    return handle;
+}
+
+internal u64 os_read_file(OS_Handle file, void* data, u64 size) {
+    return fread(data, 1, size, os_handle_to_FILE(file));
+}
+
+internal u64 os_write_file(OS_Handle file, const void* data, u64 size) {
+    return fwrite(data, 1, size, os_handle_to_FILE(file));
+}
+
+internal b8 os_rename_file(NTString8 from, NTString8 to) {
+    return rename(from.cstr, to.cstr) == 0;
+}
+
+internal b8 os_delete_file(NTString8 path) {
+    return unlink(path.cstr) == 0;
+}
+
+internal b8 os_map_file(NTString8 path, OS_FileMap* out_map) {
+    MemoryZeroStruct(out_map);
+    int fd = open(path.cstr, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    b8 ok = fstat(fd, &info) == 0;
+    if (ok && info.st_size > 0) {
+        void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = data != MAP_FAILED;
+        if (ok) {
+            // @note read front to back
+            madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+            out_map->data = (const u8*)data;
+            out_map->size = (u64)info.st_size;
+        }
+    }
+    // @note the mapping keeps the file alive
+    close(fd);
+    return ok;
+}
+
+internal void os_unmap_file(OS_FileMap map) {
+    if (map.data != NULL) {
+        munmap((void*)map.data, map.size);
+    }
+}
+
+internal u64 os_file_size(OS_Handle file) {
+    struct stat info;
+    if (fstat(fileno(os_handle_to_FILE(file)), &info) != 0 || info.st_size < 0) {
+        return 0;
+    }
+    return (u64)info.st_size;
+}
+
+internal b8 os_file_info(NTString8 path, OS_FileInfo* out_info) {
+    struct stat info;
+    if (stat(path.cstr, &info) != 0) {
+        return false;
+    }
+    out_info->size = (u64)info.st_size;
+    out_info->modified = (u64)info.st_mtim.tv_sec*Billion(1) + (u64)info.st_mtim.tv_nsec;
+    return true;
+}
+
+internal void os_read_ahead(OS_Handle file, u64 offset, u64 size) {
+    posix_fadvise(fileno(os_handle_to_FILE(file)), (off_t)offset, (off_t)size, POSIX_FADV_WILLNEED);
+}
+
+internal void os_read_ahead_map(OS_FileMap map, u64 offset, u64 size) {
+    if (offset >= map.size) {
+        return;
+    }
+    // @note madvise wants the range to start on a page
+    u64 page_size = (u64)sysconf(_SC_PAGESIZE);
+    u64 begin = offset/page_size*page_size;
+    u64 end = offset + Min(size, map.size - offset);
+    madvise((void*)(map.data + begin), end - begin, MADV_WILLNEED);
+}
+
+// local sockets
+internal OS_Handle os_socket_listen(NTString8 path) {
+    struct sockaddr_un address;
+    if (!os_linux_socket_address(path, &address)) {
+        return os_zero_handle();
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return os_zero_handle();
+    }
+    unlink(path.cstr);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return os_zero_handle();
+    }
+    return os_fd_to_handle(fd);
+}
+
+internal OS_Handle os_socket_connect(NTString8 path) {
+    struct sockaddr_un address;
+    if (!os_linux_socket_address(path, &address)) {
+        return os_zero_handle();
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return os_zero_handle();
+    }
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        return os_zero_handle();
+    }
+    return os_fd_to_handle(fd);
+}
+
+internal OS_Handle os_socket_accept(OS_Handle socket) {
+    return os_fd_to_handle(accept(os_handle_to_fd(socket), NULL, NULL));
+}
+
+internal bool os_socket_wait(OS_Handle socket, f64 seconds) {
+    struct pollfd fd = {.fd = os_handle_to_fd(socket), .events = POLLIN};
+    return poll(&fd, 1, (int)(seconds*1000.0)) > 0;
+}
+
+internal u64 os_socket_read(OS_Handle socket, void* data, u64 size) {
+    ssize_t read = recv(os_handle_to_fd(socket), data, size, 0);
+    return (read > 0) ? (u64)read : 0;
+}
+
+internal u64 os_socket_write(OS_Handle socket, const void* data, u64 size) {
+    u64 written = 0;
+    while (written < size) {
+        // @note no SIGPIPE when the other end is gone
+        ssize_t sent = send(os_handle_to_fd(socket), (const u8*)data + written, size - written, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            break;
+        }
+        written += (u64)sent;
+    }
+    return written;
+}
+
+internal void os_socket_shutdown(OS_Handle socket) {
+    shutdown(os_handle_to_fd(socket), SHUT_RDWR);
+}
+
+internal void os_socket_close(OS_Handle socket) {
+    close(os_handle_to_fd(socket));
+}
+
+// processes
+internal OS_Handle os_process_launch(char** argv) {
+    pid_t pid;
+    if (posix_spawnp(&pid, argv[0], NULL, NULL, argv, environ) != 0) {
+        return os_zero_handle();
+    }
+
+    OS_Handle handle = zero_struct;
+    handle.v64[0] = (u64)pid;
+    return handle;
+}
+
+internal int os_process_wait(OS_Handle process) {
+    int status;
+    if (waitpid((pid_t)process.v64[0], &status, 0) < 0 || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+internal bool os_process_poll(OS_Handle process) {
+    int status;
+    return waitpid((pid_t)process.v64[0], &status, WNOHANG) != 0;
+}
+
 // time
 internal f64 os_now_seconds() {
     struct timeval tval;
@@ -47,6 +259,81 @@ internal f64 os_now_seconds() {
     return (f64)tval.tv_sec + (f64)tval.tv_usec / Million(1.f);
 }
 
+// threads
+internal OS_Handle os_thread_launch(OS_ThreadFunction* func, void* data) {
+    OS_LinuxThread* thread = (OS_LinuxThread*)os_allocate(sizeof(OS_LinuxThread));
+    thread->func = func;
+    thread->data = data;
+    if (pthread_create(&thread->handle, NULL, os_linux_thread_entry, thread) != 0) {
+        os_deallocate(thread);
+        return os_zero_handle();
+    }
+
+    OS_Handle handle = zero_struct;
+    handle.v64[0] = (u64)thread;
+    return handle;
+}
+
+internal void os_thread_join(OS_Handle thread) {
+    OS_LinuxThread* ptr = (OS_LinuxThread*)thread.v64[0];
+    pthread_join(ptr->handle, NULL);
+    os_deallocate(ptr);
+}
+
+internal u32 os_logical_core_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (u32)count : 1;
+}
+
+// synchronization
+internal OS_Handle os_mutex_alloc() {
+    pthread_mutex_t* mutex = (pthread_mutex_t*)os_allocate(sizeof(pthread_mutex_t));
+    pthread_mutex_init(mutex, NULL);
+
+    OS_Handle handle = zero_struct;
+    handle.v64[0] = (u64)mutex;
+    return handle;
+}
+
+internal void os_mutex_release(OS_Handle mutex) {
+    pthread_mutex_destroy((pthread_mutex_t*)mutex.v64[0]);
+    os_deallocate((void*)mutex.v64[0]);
+}
+
+internal void os_mutex_lock(OS_Handle mutex) {
+    pthread_mutex_lock((pthread_mutex_t*)mutex.v64[0]);
+}
+
+internal void os_mutex_unlock(OS_Handle mutex) {
+    pthread_mutex_unlock((pthread_mutex_t*)mutex.v64[0]);
+}
+
+internal OS_Handle os_condition_variable_alloc() {
+    pthread_cond_t* cv = (pthread_cond_t*)os_allocate(sizeof(pthread_cond_t));
+    pthread_cond_init(cv, NULL);
+
+    OS_Handle handle = zero_struct;
+    handle.v64[0] = (u64)cv;
+    return handle;
+}
+
+internal void os_condition_variable_release(OS_Handle cv) {
+    pthread_cond_destroy((pthread_cond_t*)cv.v64[0]);
+    os_deallocate((void*)cv.v64[0]);
+}
+
+internal void os_condition_variable_wait(OS_Handle cv, OS_Handle mutex) {
+    pthread_cond_wait((pthread_cond_t*)cv.v64[0], (pthread_mutex_t*)mutex.v64[0]);
+}
+
+internal void os_condition_variable_signal(OS_Handle cv) {
+    pthread_cond_signal((pthread_cond_t*)cv.v64[0]);
+}
+
+internal void os_condition_variable_broadcast(OS_Handle cv) {
+    pthread_cond_broadcast((pthread_cond_t*)cv.v64[0]);
+}
+
 // memory management
 internal void* os_allocate(u64 size) {
     void* ptr = malloc(size);
@@ -57,4 +344,55 @@ internal void* os_allocate(u64 size) {
 internal void os_deallocate(void* ptr) {
     TracyFree(ptr);
     free(ptr);
+}
+
+// virtual memory
+internal u64 os_page_size() {
+    return (u64)sysconf(_SC_PAGESIZE);
+}
+
+// @note the default huge page size on x86-64 and on arm64 with 4KB pages
+internal u64 os_large_page_size() {
+    return MB(2);
+}
+
+internal void* os_reserve(u64 size) {
+    void* ptr = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return (ptr != MAP_FAILED) ? ptr : NULL;
+}
+
+internal void* os_reserve_large(u64 size) {
+    // @note no hugetlb, its pages are either pinned for all of size up front
+    // or, with MAP_NORESERVE, fault once the pool runs dry. transparent huge
+    // pages are taken as the range is touched and fall back to small ones.
+    // they want the range aligned to them, the ends that stick out are given
+    // back
+    u64 large_page_size = os_large_page_size();
+    u8* base = (u8*)os_reserve(size + large_page_size);
+    if (base == NULL) {
+        return NULL;
+    }
+    u8* aligned = (u8*)AlignPow2((u64)base, large_page_size);
+    if (aligned > base) {
+        munmap(base, (size_t)(aligned - base));
+    }
+    u64 tail = (u64)(base + large_page_size - aligned);
+    if (tail > 0) {
+        munmap(aligned + size, tail);
+    }
+    madvise(aligned, size, MADV_HUGEPAGE);
+    return aligned;
+}
+
+internal b8 os_commit(void* ptr, u64 size) {
+    return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+internal void os_decommit(void* ptr, u64 size) {
+    madvise(ptr, size, MADV_DONTNEED);
+    mprotect(ptr, size, PROT_NONE);
+}
+
+internal void os_release(void* ptr, u64 size) {
+    munmap(ptr, size);
 }
\ No newline at end of file
@@ -2,5 +2,26 @@
 
 #include <stdlib.h>
 #include <sys/time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <spawn.h>
 
-internal force_inline FILE* os_handle_to_FILE(OS_Handle file);
\ No newline at end of file
+extern char** environ;
+
+internal force_inline FILE* os_handle_to_FILE(OS_Handle file);
+internal force_inline int   os_handle_to_fd(OS_Handle socket);
+internal force_inline OS_Handle os_fd_to_handle(int fd);
+
+typedef struct OS_LinuxThread OS_LinuxThread;
+struct OS_LinuxThread {
+    pthread_t handle;
+    OS_ThreadFunction* func;
+    void* data;
+};
\ No newline at end of file
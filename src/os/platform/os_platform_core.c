@@ -6,4 +6,109 @@ internal OS_Handle os_zero_handle() {
 
 internal b8 os_is_handle_zero(OS_Handle handle) {
     return handle.v64[0] == 0 && handle.v64[1] == 0;
+}
+
+// files
+// moves what is left to the front of the block and reads behind it
+static void os_file_reader_refill(OS_FileReader* reader) {
+    u64 left = reader->end - reader->begin;
+    memmove(reader->block, reader->block + reader->begin, left);
+    reader->begin = 0;
+    reader->end = left;
+    if (reader->eof) {
+        return;
+    }
+
+    u64 size = reader->block_size - left;
+    u64 read = os_read_file(reader->file, reader->block + left, size);
+    reader->end += read;
+    reader->offset += read;
+    reader->eof = read < size;
+    if (!reader->eof) {
+        os_read_ahead(reader->file, reader->offset, reader->block_size);
+    }
+}
+
+internal OS_FileReader os_file_reader_begin(Arena* arena, OS_Handle file, u64 block_size) {
+    OS_FileReader reader = zero_struct;
+    reader.file = file;
+    reader.block_size = Max(block_size, 1);
+    reader.block = push_array_no_zero(arena, u8, reader.block_size + 1);
+    os_set_file_offset(file, 0);
+    os_read_ahead(file, 0, reader.block_size);
+    return reader;
+}
+
+internal u64 os_file_reader_read(OS_FileReader* reader, void* data, u64 size) {
+    u8* out = (u8*)data;
+    u64 done = 0;
+    while (done < size) {
+        if (reader->begin == reader->end) {
+            if (reader->eof) {
+                break;
+            }
+            // @perf large reads skip the block
+            if (size - done >= reader->block_size) {
+                u64 direct = (size - done)/reader->block_size*reader->block_size;
+                u64 read = os_read_file(reader->file, out + done, direct);
+                done += read;
+                reader->offset += read;
+                reader->eof = read < direct;
+                if (!reader->eof) {
+                    os_read_ahead(reader->file, reader->offset, reader->block_size);
+                }
+                continue;
+            }
+            os_file_reader_refill(reader);
+            continue;
+        }
+
+        u64 count = Min(size - done, reader->end - reader->begin);
+        memcpy(out + done, reader->block + reader->begin, count);
+        reader->begin += count;
+        done += count;
+    }
+    return done;
+}
+
+internal void os_file_reader_skip(OS_FileReader* reader, u64 size) {
+    u64 buffered = Min(size, reader->end - reader->begin);
+    reader->begin += buffered;
+    if (size == buffered || reader->eof) {
+        return;
+    }
+
+    // @note the block is empty now, reading goes on from the new offset
+    reader->offset += size - buffered;
+    os_set_file_offset(reader->file, reader->offset);
+    os_read_ahead(reader->file, reader->offset, reader->block_size);
+}
+
+internal b8 os_file_reader_line(OS_FileReader* reader, NTString8* out_line) {
+    u8* line_break = NULL;
+    for (;;) {
+        u8* begin = reader->block + reader->begin;
+        u64 left = reader->end - reader->begin;
+        line_break = (u8*)memchr(begin, '\n', left);
+        if (line_break != NULL || reader->eof || left == reader->block_size) {
+            break;
+        }
+        os_file_reader_refill(reader);
+    }
+
+    u64 left = reader->end - reader->begin;
+    if (left == 0) {
+        MemoryZeroStruct(out_line);
+        return false;
+    }
+
+    u8* begin = reader->block + reader->begin;
+    u8* end = line_break != NULL ? line_break : begin + left;
+    reader->begin += (u64)(end - begin) + (line_break != NULL ? 1 : 0);
+    if (end > begin && end[-1] == '\r') {
+        end--;
+    }
+    *end = '\0';
+    *out_line = make_ntstr8((char*)begin, (u64)(end - begin));
+    return true;
 }
\ No newline at end of file
@@ -14,6 +14,19 @@ internal b8          os_is_handle_zero(OS_Handle handle);
 internal void* os_allocate(u64 size);
 internal void  os_deallocate(void* ptr);
 
+// virtual memory
+// @note reserved address space has to be committed before it's used, ranges
+// are multiples of os_page_size (os_large_page_size for large reservations)
+internal u64   os_page_size();
+internal u64   os_large_page_size();
+internal void* os_reserve(u64 size);
+// aligned to and advised for transparent huge pages, the kernel backs it with
+// them where it can
+internal void* os_reserve_large(u64 size);
+internal b8    os_commit(void* ptr, u64 size);
+internal void  os_decommit(void* ptr, u64 size);
+internal void  os_release(void* ptr, u64 size);
+
 // files
 internal OS_Handle os_open_readonly_file(NTString8 path);
 internal void      os_close_file(OS_Handle file);
@@ -21,14 +34,122 @@ internal void      os_set_file_offset(OS_Handle file, u64 offset);
 internal b8        os_is_eof(OS_Handle file);
 internal NTString8 os_read_line_ml(OS_Handle file, Arena* arena, u64 max_line_length);
 internal void      os_read_line_to_buffer_ml(OS_Handle file, NTString8* str, u64 buffer_size);
+// @note creates the file or truncates it
+internal OS_Handle os_open_writeonly_file(NTString8 path);
+// return how many bytes made it, less than size on error or eof
+internal u64       os_read_file(OS_Handle file, void* data, u64 size);
+internal u64       os_write_file(OS_Handle file, const void* data, u64 size);
+// @note replaces to atomically when both are on the same file system
+internal b8        os_rename_file(NTString8 from, NTString8 to);
+internal b8        os_delete_file(NTString8 path);
+
+// the whole of a file mapped read only, empty files map to no data
+typedef struct OS_FileMap OS_FileMap;
+struct OS_FileMap {
+    const u8* data;
+    u64 size;
+};
+
+internal b8        os_map_file(NTString8 path, OS_FileMap* out_map);
+internal void      os_unmap_file(OS_FileMap map);
+// 0 when it can't be told
+internal u64       os_file_size(OS_Handle file);
+
+typedef struct OS_FileInfo OS_FileInfo;
+struct OS_FileInfo {
+    u64 size;
+    // nanoseconds since the epoch
+    u64 modified;
+};
+// false when there is no file at path
+internal b8        os_file_info(NTString8 path, OS_FileInfo* out_info);
+// @note hints only, the kernel starts reading the range in the background and
+// the call returns right away
+internal void      os_read_ahead(OS_Handle file, u64 offset, u64 size);
+internal void      os_read_ahead_map(OS_FileMap map, u64 offset, u64 size);
+
+// reads a file front to back in large blocks, while one block is used the
+// next one is read ahead
+#define OS_FILE_READER_DEFAULT_BLOCK_SIZE MB(1)
+
+typedef struct OS_FileReader OS_FileReader;
+struct OS_FileReader {
+    OS_Handle file;
+    // @note one byte more than block_size to terminate lines
+    u8* block;
+    u64 block_size;
+    // the unread bytes are block[begin, end)
+    u64 begin;
+    u64 end;
+    // where block[end] is in the file
+    u64 offset;
+    b8 eof;
+};
+
+// @note starts at the beginning of file, which stays owned by the caller
+internal OS_FileReader os_file_reader_begin(Arena* arena, OS_Handle file, u64 block_size);
+// return how many bytes made it, less than size on error or eof
+internal u64           os_file_reader_read(OS_FileReader* reader, void* data, u64 size);
+// @note skipping past the end shows as eof on the next read
+internal void          os_file_reader_skip(OS_FileReader* reader, u64 size);
+// the next line without the line break, lines longer than the block are
+// split. false at eof
+// @note points into the block and stays valid until the next call
+internal b8            os_file_reader_line(OS_FileReader* reader, NTString8* out_line);
 
 #define OS_DEFAULT_MAX_LINE_LENGTH 256
 #define os_read_line(file, arena) os_read_line_ml(file, arena, OS_DEFAULT_MAX_LINE_LENGTH)
 #define os_read_line_to_buffer(file, str) os_read_line_to_buffer_ml(file, str, OS_DEFAULT_MAX_LINE_LENGTH)
 
+// local sockets
+// @note path names a unix domain socket, one left behind at path is replaced
+internal OS_Handle os_socket_listen(NTString8 path);
+internal OS_Handle os_socket_connect(NTString8 path);
+// blocks until a client connects, zero once the socket is shut down
+internal OS_Handle os_socket_accept(OS_Handle socket);
+// waits up to seconds for something to read or, on a listening socket, a
+// client to accept
+internal bool      os_socket_wait(OS_Handle socket, f64 seconds);
+// return how many bytes made it, 0 once the other end is gone
+internal u64       os_socket_read(OS_Handle socket, void* data, u64 size);
+internal u64       os_socket_write(OS_Handle socket, const void* data, u64 size);
+// wakes up threads blocked on the socket, close it once they are done
+internal void      os_socket_shutdown(OS_Handle socket);
+internal void      os_socket_close(OS_Handle socket);
+
+// processes
+// @note argv ends with NULL, argv[0] is looked up like a shell would. the
+// child shares stdout and stderr
+internal OS_Handle os_process_launch(char** argv);
+// the exit code, -1 if it didn't exit on its own
+internal int       os_process_wait(OS_Handle process);
+// true once the process has exited, without waiting for it. the process is
+// gone after that and mustn't be waited on again
+internal bool      os_process_poll(OS_Handle process);
+
 // time
 internal f64 os_now_seconds();
 
+// threads
+typedef void OS_ThreadFunction(void* data);
+
+internal OS_Handle os_thread_launch(OS_ThreadFunction* func, void* data);
+internal void      os_thread_join(OS_Handle thread);
+internal u32       os_logical_core_count();
+
+// synchronization
+internal OS_Handle os_mutex_alloc();
+internal void      os_mutex_release(OS_Handle mutex);
+internal void      os_mutex_lock(OS_Handle mutex);
+internal void      os_mutex_unlock(OS_Handle mutex);
+
+internal OS_Handle os_condition_variable_alloc();
+internal void      os_condition_variable_release(OS_Handle cv);
+// @note atomically unlocks mutex while waiting, wakeups may be spurious
+internal void      os_condition_variable_wait(OS_Handle cv, OS_Handle mutex);
+internal void      os_condition_variable_signal(OS_Handle cv);
+internal void      os_condition_variable_broadcast(OS_Handle cv);
+
 // random
 internal void rand_seed(u64 seed);
 internal u64  rand_u64();
\ No newline at end of file
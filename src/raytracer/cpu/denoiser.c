@@ -0,0 +1,289 @@
+// ============================================================================
+// denoiser
+// ============================================================================
+read_only global f32 rt_cpu_denoise_kernel[5] = {1.f/16.f, 1.f/4.f, 3.f/8.f, 1.f/4.f, 1.f/16.f};
+
+rt_hook void rt_denoise(RT_DenoiseSettings settings, const vec3_f32* radiance, RT_CastAOVs aovs, vec3_f32* out_radiance, int width, int height) {
+    Assert(aovs.albedo != NULL && aovs.normal != NULL && aovs.depth != NULL);
+    Assert(settings.iterations <= RT_DENOISE_MAX_ITERATIONS);
+
+    {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
+        RT_CPU_DenoiseImage image = zero_struct;
+        image.width = width;
+        image.height = height;
+        // @note the last iteration reaches 2 taps of 2^(iterations-1) pixels out
+        image.pad = 2 << (Max(settings.iterations, 1) - 1);
+        image.stride = width + 2*image.pad;
+
+        u64 plane_size = (u64)image.stride*(height + 2*image.pad);
+        for EachIndex(i, 2) {
+            for EachIndex(c, 3) {
+                image.color[i][c] = push_array(scratch.arena, f32, plane_size);
+            }
+            image.variance[i] = push_array(scratch.arena, f32, plane_size);
+        }
+        for EachIndex(c, 3) {
+            image.albedo[c] = push_array(scratch.arena, f32, plane_size);
+            image.normal[c] = push_array(scratch.arena, f32, plane_size);
+        }
+        image.depth = push_array(scratch.arena, f32, plane_size);
+        image.depth_gradient = push_array(scratch.arena, f32, plane_size);
+        image.mask = push_array(scratch.arena, f32, plane_size);
+
+        RT_CPU_DenoisePass pass = {
+            .image = &image,
+            .settings = &settings,
+            .src = 0,
+            .step = 1,
+            .radiance = radiance,
+            .aovs = aovs,
+            .out_radiance = out_radiance,
+        };
+        job_parallel_for(height, RT_CPU_DENOISE_ROW_GRAIN, rt_cpu_denoise_setup_rows, &pass);
+
+        for EachIndex(i, settings.iterations) {
+            pass.src = i & 1;
+            pass.step = 1 << i;
+            job_parallel_for(height, RT_CPU_DENOISE_ROW_GRAIN, rt_cpu_denoise_filter_rows, &pass);
+        }
+
+        pass.src = settings.iterations & 1;
+        job_parallel_for(height, RT_CPU_DENOISE_ROW_GRAIN, rt_cpu_denoise_output_rows, &pass);
+    }}
+}
+
+// e^-x for x >= 0 within ~1e-4 relative error, branchless so loops over it
+// vectorize, 2^-x*log2(e) split into a power of two built in the exponent bits
+// and a polynomial for the fraction
+internal f32 rt_cpu_exp_neg_approx_f32(f32 x) {
+    // @note positive floats order like their bits, a float compare would keep
+    // gcc from vectorizing since it may trap
+    union { f32 f; s32 s; } clamped;
+    clamped.f = x;
+    clamped.s = Min(clamped.s, 0x42ae0000); // 87.f
+
+    f32 t = -clamped.f*1.44269504f;
+    s32 i = (s32)t; // truncates towards 0 so the fraction is in (-1, 0]
+    f32 f = (t - (f32)i)*0.69314718f;
+    f32 p = 1.f + f*(1.f + f*(1.f/2.f + f*(1.f/6.f + f*(1.f/24.f + f*(1.f/120.f)))));
+
+    union { u32 u; f32 f; } scale;
+    scale.u = (u32)(i + 127) << 23;
+    return p*scale.f;
+}
+
+static vec3_f32 rt_cpu_denoise_demodulate(const RT_CPU_DenoisePass* pass, u64 idx) {
+    vec3_f32 albedo = add_3f32(pass->aovs.albedo[idx], make_scale_3f32(RT_CPU_DENOISE_ALBEDO_EPSILON));
+    return make_3f32(
+        pass->radiance[idx].x/albedo.x,
+        pass->radiance[idx].y/albedo.y,
+        pass->radiance[idx].z/albedo.z
+    );
+}
+
+static f32 rt_cpu_denoise_luminance(f32 r, f32 g, f32 b) {
+    return 0.2126f*r + 0.7152f*g + 0.0722f*b;
+}
+
+// smaller of the forward and backward differences so a depth edge next to the
+// pixel doesn't make its surface look slanted
+static f32 rt_cpu_denoise_depth_gradient(const f32* depth, int x, int y, int width, int height) {
+    f32 d = depth[y*width + x];
+    f32 gx = MAX_F32, gy = MAX_F32;
+    if (x > 0)          gx = Min(gx, abs_f32(d - depth[y*width + x - 1]));
+    if (x < width - 1)  gx = Min(gx, abs_f32(depth[y*width + x + 1] - d));
+    if (y > 0)          gy = Min(gy, abs_f32(d - depth[(y - 1)*width + x]));
+    if (y < height - 1) gy = Min(gy, abs_f32(depth[(y + 1)*width + x] - d));
+    return ((gx < MAX_F32) ? gx : 0.f) + ((gy < MAX_F32) ? gy : 0.f);
+}
+
+// @note the variance aov is noisy itself at low sample counts and is averaged
+// over the 3x3 neighbourhood, without it the variance is that of the
+// neighbourhood's luminance
+static f32 rt_cpu_denoise_variance(const RT_CPU_DenoisePass* pass, int x, int y) {
+    int width = pass->image->width, height = pass->image->height;
+
+    f32 sum = 0.f, sum2 = 0.f;
+    int count = 0;
+    for (int ny = Max(y - 1, 0); ny <= Min(y + 1, height - 1); ny++) {
+        for (int nx = Max(x - 1, 0); nx <= Min(x + 1, width - 1); nx++) {
+            u64 idx = (u64)ny*width + nx;
+            if (pass->aovs.variance) {
+                // in terms of the demodulated color
+                vec3_f32 albedo = add_3f32(pass->aovs.albedo[idx], make_scale_3f32(RT_CPU_DENOISE_ALBEDO_EPSILON));
+                f32 l = rt_cpu_denoise_luminance(albedo.x, albedo.y, albedo.z);
+                sum += pass->aovs.variance[idx]/(l*l);
+            } else {
+                vec3_f32 c = rt_cpu_denoise_demodulate(pass, idx);
+                f32 l = rt_cpu_denoise_luminance(c.x, c.y, c.z);
+                sum += l;
+                sum2 += l*l;
+            }
+            count++;
+        }
+    }
+
+    f32 mean = sum/(f32)count;
+    if (pass->aovs.variance) {
+        return mean;
+    }
+    return Max(sum2/(f32)count - mean*mean, 0.f);
+}
+
+internal void rt_cpu_denoise_setup_rows(void* data, u64 begin, u64 end) {
+    RT_CPU_DenoisePass* pass = (RT_CPU_DenoisePass*)data;
+    RT_CPU_DenoiseImage* image = pass->image;
+    int width = image->width, height = image->height;
+
+    for (int y = (int)begin; y < (int)end; y++) {
+        for (int x = 0; x < width; x++) {
+            u64 idx = (u64)y*width + x;
+            int p = (y + image->pad)*image->stride + x + image->pad;
+
+            vec3_f32 c = rt_cpu_denoise_demodulate(pass, idx);
+            image->color[0][0][p] = c.x;
+            image->color[0][1][p] = c.y;
+            image->color[0][2][p] = c.z;
+            image->albedo[0][p] = pass->aovs.albedo[idx].x;
+            image->albedo[1][p] = pass->aovs.albedo[idx].y;
+            image->albedo[2][p] = pass->aovs.albedo[idx].z;
+            image->normal[0][p] = pass->aovs.normal[idx].x;
+            image->normal[1][p] = pass->aovs.normal[idx].y;
+            image->normal[2][p] = pass->aovs.normal[idx].z;
+            image->depth[p] = pass->aovs.depth[idx];
+            image->depth_gradient[p] = rt_cpu_denoise_depth_gradient(pass->aovs.depth, x, y, width, height);
+            image->mask[p] = 1.f;
+
+            image->variance[0][p] = rt_cpu_denoise_variance(pass, x, y);
+        }
+    }
+}
+
+// adds one kernel tap to the sums of a row
+// @note the sums are only written through these pointers, which lets the loop
+// vectorize without runtime overlap checks against the planes
+static void rt_cpu_denoise_accumulate_tap(const RT_CPU_DenoiseTap* tap, int width, f32* restrict_ptr sum_r, f32* restrict_ptr sum_g, f32* restrict_ptr sum_b, f32* restrict_ptr sum_w, f32* restrict_ptr sum_v) {
+    const RT_CPU_DenoiseRow* p = &tap->p;
+    const RT_CPU_DenoiseRow* q = &tap->q;
+
+    // @perf straight loop over contiguous planes, vectorizes
+    for (int x = 0; x < width; x++) {
+        f32 lum_q = rt_cpu_denoise_luminance(q->color[0][x], q->color[1][x], q->color[2][x]);
+        f32 dar = p->albedo[0][x] - q->albedo[0][x];
+        f32 dag = p->albedo[1][x] - q->albedo[1][x];
+        f32 dab = p->albedo[2][x] - q->albedo[2][x];
+        f32 dnx = p->normal[0][x] - q->normal[0][x];
+        f32 dny = p->normal[1][x] - q->normal[1][x];
+        f32 dnz = p->normal[2][x] - q->normal[2][x];
+
+        f32 e = abs_f32(tap->luminance[x] - lum_q)*tap->inv_sigma_luminance[x]
+              + (dar*dar + dag*dag + dab*dab)*tap->inv_sigma_albedo2
+              + (dnx*dnx + dny*dny + dnz*dnz)*tap->inv_sigma_normal2
+              + abs_f32(p->depth[x] - q->depth[x])*tap->inv_sigma_depth[x];
+        f32 w = tap->k*q->mask[x]*rt_cpu_exp_neg_approx_f32(e);
+
+        sum_r[x] += w*q->color[0][x];
+        sum_g[x] += w*q->color[1][x];
+        sum_b[x] += w*q->color[2][x];
+        sum_w[x] += w;
+        sum_v[x] += w*w*q->variance[x];
+    }
+}
+
+static RT_CPU_DenoiseRow rt_cpu_denoise_row(const RT_CPU_DenoiseImage* image, int src, int offset) {
+    return (RT_CPU_DenoiseRow){
+        .color = {image->color[src][0] + offset, image->color[src][1] + offset, image->color[src][2] + offset},
+        .variance = image->variance[src] + offset,
+        .albedo = {image->albedo[0] + offset, image->albedo[1] + offset, image->albedo[2] + offset},
+        .normal = {image->normal[0] + offset, image->normal[1] + offset, image->normal[2] + offset},
+        .depth = image->depth + offset,
+        .depth_gradient = image->depth_gradient + offset,
+        .mask = image->mask + offset,
+    };
+}
+
+internal void rt_cpu_denoise_filter_rows(void* data, u64 begin, u64 end) {
+    RT_CPU_DenoisePass* pass = (RT_CPU_DenoisePass*)data;
+    RT_CPU_DenoiseImage* image = pass->image;
+    const RT_DenoiseSettings* settings = pass->settings;
+    int width = image->width;
+    int src = pass->src, dst = 1 - pass->src;
+
+    {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
+        f32* sum_r = push_array_no_zero(scratch.arena, f32, width);
+        f32* sum_g = push_array_no_zero(scratch.arena, f32, width);
+        f32* sum_b = push_array_no_zero(scratch.arena, f32, width);
+        f32* sum_w = push_array_no_zero(scratch.arena, f32, width);
+        f32* sum_v = push_array_no_zero(scratch.arena, f32, width);
+
+        RT_CPU_DenoiseTap tap = zero_struct;
+        tap.luminance = push_array_no_zero(scratch.arena, f32, width);
+        tap.inv_sigma_luminance = push_array_no_zero(scratch.arena, f32, width);
+        tap.inv_sigma_albedo2 = 1.f/Max(settings->sigma_albedo*settings->sigma_albedo, 1e-8f);
+        tap.inv_sigma_normal2 = 1.f/Max(settings->sigma_normal*settings->sigma_normal, 1e-8f);
+        f32* inv_sigma_depth[2];
+        for EachIndex(ring, 2) {
+            inv_sigma_depth[ring] = push_array_no_zero(scratch.arena, f32, width);
+        }
+
+        for (int y = (int)begin; y < (int)end; y++) {
+            int row = (y + image->pad)*image->stride + image->pad;
+            tap.p = rt_cpu_denoise_row(image, src, row);
+
+            for (int x = 0; x < width; x++) {
+                sum_r[x] = 0.f;
+                sum_g[x] = 0.f;
+                sum_b[x] = 0.f;
+                sum_w[x] = 0.f;
+                sum_v[x] = 0.f;
+                tap.luminance[x] = rt_cpu_denoise_luminance(tap.p.color[0][x], tap.p.color[1][x], tap.p.color[2][x]);
+                tap.inv_sigma_luminance[x] = 1.f/(settings->sigma_color*sqrt_f32(tap.p.variance[x]) + RT_CPU_DENOISE_LUMINANCE_EPSILON);
+
+                // depth falloff of the taps 1 and 2 steps out
+                for EachIndex(ring, 2) {
+                    f32 distance = (f32)(pass->step*(ring + 1));
+                    f32 sigma = settings->sigma_depth*(tap.p.depth_gradient[x]*distance + RT_CPU_DENOISE_DEPTH_EPSILON*tap.p.depth[x]);
+                    inv_sigma_depth[ring][x] = 1.f/(sigma + 1e-20f);
+                }
+            }
+
+            for (int ky = -2; ky <= 2; ky++) {
+                for (int kx = -2; kx <= 2; kx++) {
+                    // @note the center tap has no depth difference, any ring works
+                    tap.k = rt_cpu_denoise_kernel[ky + 2]*rt_cpu_denoise_kernel[kx + 2];
+                    tap.inv_sigma_depth = inv_sigma_depth[Max(Max(abs(kx), abs(ky)), 1) - 1];
+                    tap.q = rt_cpu_denoise_row(image, src, row + (ky*image->stride + kx)*pass->step);
+                    rt_cpu_denoise_accumulate_tap(&tap, width, sum_r, sum_g, sum_b, sum_w, sum_v);
+                }
+            }
+
+            // @note the center tap always has weight, sum_w > 0
+            for (int x = 0; x < width; x++) {
+                f32 inv_w = 1.f/sum_w[x];
+                image->color[dst][0][row + x] = sum_r[x]*inv_w;
+                image->color[dst][1][row + x] = sum_g[x]*inv_w;
+                image->color[dst][2][row + x] = sum_b[x]*inv_w;
+                image->variance[dst][row + x] = sum_v[x]*inv_w*inv_w;
+            }
+        }
+    }}
+}
+
+internal void rt_cpu_denoise_output_rows(void* data, u64 begin, u64 end) {
+    RT_CPU_DenoisePass* pass = (RT_CPU_DenoisePass*)data;
+    RT_CPU_DenoiseImage* image = pass->image;
+    int width = image->width;
+
+    for (int y = (int)begin; y < (int)end; y++) {
+        int row = (y + image->pad)*image->stride + image->pad;
+        for (int x = 0; x < width; x++) {
+            u64 idx = (u64)y*width + x;
+            vec3_f32 albedo = add_3f32(pass->aovs.albedo[idx], make_scale_3f32(RT_CPU_DENOISE_ALBEDO_EPSILON));
+            pass->out_radiance[idx] = make_3f32(
+                image->color[pass->src][0][row + x]*albedo.x,
+                image->color[pass->src][1][row + x]*albedo.y,
+                image->color[pass->src][2][row + x]*albedo.z
+            );
+        }
+    }
+}
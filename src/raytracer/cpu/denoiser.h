@@ -0,0 +1,82 @@
+#pragma once
+
+// ============================================================================
+// denoiser
+// ============================================================================
+// the image is kept as padded planes (structure of arrays) so a row of one
+// kernel tap is a straight loop over contiguous floats, the padding reaches as
+// far as the widest kernel and has zero weight so taps need no bounds checks
+typedef struct RT_CPU_DenoiseImage RT_CPU_DenoiseImage;
+struct RT_CPU_DenoiseImage {
+    int width;
+    int height;
+    int pad;
+    int stride;
+
+    // radiance divided by albedo and the variance of its luminance, ping-ponged
+    // between iterations
+    f32* color[2][3];
+    f32* variance[2];
+
+    f32* albedo[3];
+    f32* normal[3];
+    f32* depth;
+    // depth change to the next pixel, to tell slanted surfaces from edges
+    f32* depth_gradient;
+    f32* mask;
+};
+
+// the planes of a row, offset so [x] is the pixel x of the row
+typedef struct RT_CPU_DenoiseRow RT_CPU_DenoiseRow;
+struct RT_CPU_DenoiseRow {
+    const f32* color[3];
+    const f32* variance;
+    const f32* albedo[3];
+    const f32* normal[3];
+    const f32* depth;
+    const f32* depth_gradient;
+    const f32* mask;
+};
+
+// a row of pixels p and their neighbours q under one kernel tap
+typedef struct RT_CPU_DenoiseTap RT_CPU_DenoiseTap;
+struct RT_CPU_DenoiseTap {
+    RT_CPU_DenoiseRow p;
+    RT_CPU_DenoiseRow q;
+    f32 k;
+
+    // per pixel of p
+    f32* luminance;
+    f32* inv_sigma_luminance;
+    f32* inv_sigma_depth;
+
+    f32 inv_sigma_albedo2;
+    f32 inv_sigma_normal2;
+};
+
+typedef struct RT_CPU_DenoisePass RT_CPU_DenoisePass;
+struct RT_CPU_DenoisePass {
+    RT_CPU_DenoiseImage* image;
+    const RT_DenoiseSettings* settings;
+    int src;
+    int step;
+
+    // set for the setup and output passes
+    const vec3_f32* radiance;
+    RT_CastAOVs aovs;
+    vec3_f32* out_radiance;
+};
+
+// keeps black surfaces from blowing up when dividing by albedo
+#define RT_CPU_DENOISE_ALBEDO_EPSILON 0.001f
+// depth differences are allowed to grow this much relative to the depth
+#define RT_CPU_DENOISE_DEPTH_EPSILON 0.002f
+#define RT_CPU_DENOISE_LUMINANCE_EPSILON 0.0001f
+
+// rows are handed out in chunks of this many to the job system
+#define RT_CPU_DENOISE_ROW_GRAIN 4
+
+internal f32  rt_cpu_exp_neg_approx_f32(f32 x);
+internal void rt_cpu_denoise_setup_rows(void* data, u64 begin, u64 end);
+internal void rt_cpu_denoise_filter_rows(void* data, u64 begin, u64 end);
+internal void rt_cpu_denoise_output_rows(void* data, u64 begin, u64 end);
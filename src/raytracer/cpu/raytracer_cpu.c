@@ -10,6 +10,14 @@ internal RT_Handle rt_cpu_tracer_to_handle(RT_CPU_Tracer* tracer) {
     handle.v64[0] = (u64)tracer;
     return handle;
 }
+internal RT_CPU_CastJob* rt_cpu_handle_to_cast_job(RT_Handle handle) {
+    return (RT_CPU_CastJob*)handle.v64[0];
+}
+internal RT_Handle rt_cpu_cast_job_to_handle(RT_CPU_CastJob* job) {
+    RT_Handle handle = zero_struct;
+    handle.v64[0] = (u64)job;
+    return handle;
+}
 
 rt_hook RT_Handle rt_make_tracer(RT_TracerSettings settings) {
     Assert(settings.max_bounces < RT_MAX_MAX_BOUNCES);
@@ -19,14 +27,30 @@ rt_hook RT_Handle rt_make_tracer(RT_TracerSettings settings) {
     tracer->arena = arena;
     tracer->max_bounces = settings.max_bounces;
     tracer->sky = settings.sky;
-    tracer->blas_arena = arena_alloc();
-    tracer->tlas_arena = arena_alloc();
+    tracer->traversal = settings.traversal;
+    tracer->russian_roulette = settings.russian_roulette;
+    tracer->next_event_estimation = settings.next_event_estimation;
+    tracer->light_sampling = settings.light_sampling;
+    tracer->bvh_arena_flags = settings.large_pages ? ArenaFlags_LargePages : ArenaFlags_ZERO;
+    tracer->blas_arena = arena_alloc_reserve(RT_CPU_BVH_ARENA_RESERVE, tracer->bvh_arena_flags);
+    tracer->tlas_arena = arena_alloc_reserve(RT_CPU_BVH_ARENA_RESERVE, tracer->bvh_arena_flags);
+    tracer->blas_lanes = arena_concurrent_alloc(RT_CPU_BLAS_LANES_RESERVE, RT_CPU_BLAS_LANE_CHUNK_SIZE, tracer->bvh_arena_flags);
+    tracer->accumulation_arena = arena_alloc();
+    tracer->checkpoint_arena = arena_alloc();
     return rt_cpu_tracer_to_handle(tracer);
 }
+static void rt_cpu_clear_blas(RT_CPU_Tracer* tracer) {
+    arena_clear(tracer->blas_arena);
+    arena_concurrent_clear(tracer->blas_lanes);
+    tracer->blas = (RT_CPU_BLAS)zero_struct;
+    tracer->build_graph = NULL;
+    tracer->build_world = NULL;
+    tracer->blas_builds = NULL;
+}
 rt_hook void rt_tracer_build_blas(RT_Handle handle, RT_World* world) {
     RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
     
-    arena_clear(tracer->blas_arena);
+    rt_cpu_clear_blas(tracer);
     rt_cpu_build_blas(&tracer->blas, tracer->blas_arena, world);
 }
 rt_hook void rt_tracer_build_tlas(RT_Handle handle, RT_World* world) {
@@ -35,19 +59,348 @@ rt_hook void rt_tracer_build_tlas(RT_Handle handle, RT_World* world) {
     arena_clear(tracer->tlas_arena);
     rt_cpu_build_tlas(&tracer->tlas, tracer->tlas_arena, &tracer->blas, world);
 }
+
+static void rt_cpu_blas_node_from_mesh(RT_CPU_BLASNode* out_node, Arena* arena, const RT_Mesh* mesh);
+static void rt_cpu_blas_task(void* data) {
+    RT_CPU_BLASBuild* build = (RT_CPU_BLASBuild*)data;
+    RT_CPU_BLASNode* node = &build->tracer->blas.nodes[build->mesh->blas_id];
+    rt_cpu_blas_node_from_mesh(node, build->lane, build->mesh);
+}
+static void rt_cpu_tlas_task(void* data) {
+    RT_CPU_Tracer* tracer = (RT_CPU_Tracer*)data;
+
+    arena_clear(tracer->tlas_arena);
+    rt_cpu_build_tlas(&tracer->tlas, tracer->tlas_arena, &tracer->blas, tracer->build_world);
+}
+rt_hook void rt_tracer_begin_build(RT_Handle handle, RT_World* world, JOB_Graph* graph) {
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+
+    rt_cpu_clear_blas(tracer);
+    tracer->build_graph = graph;
+    tracer->build_world = world;
+    tracer->blas.node_count = world->meshes.length;
+    tracer->blas.nodes = push_array(tracer->blas_arena, RT_CPU_BLASNode, tracer->blas.node_count);
+    tracer->blas_builds = push_array(tracer->blas_arena, RT_CPU_BLASBuild, tracer->blas.node_count);
+
+    // @note lanes are made here in mesh order, sized for the 2n - 1 nodes of
+    // the lbvh so it stays in their first chunk. meshes a task fills in later
+    // have no size yet and spill into chunks in the order their builds run
+    u64 idx = 0;
+    for EachList(node, RT_MeshNode, world->meshes.first) {
+        const RT_Mesh* mesh = &node->v;
+        u64 tris_count = (mesh->indices_count == 0) ? mesh->vertices_count/3 : mesh->indices_count/3;
+        node->v.blas_id = idx;
+        tracer->blas_builds[idx].tracer = tracer;
+        tracer->blas_builds[idx].mesh = mesh;
+        tracer->blas_builds[idx].lane = arena_concurrent_lane(tracer->blas_lanes, sizeof(LBVH_Node)*2*tris_count);
+        idx++;
+    }
+}
+rt_hook JOB_Task* rt_tracer_schedule_blas(RT_Handle handle, RT_Handle mesh, JOB_Task* loaded) {
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+    Assert(tracer->build_graph != NULL);
+
+    RT_CPU_BLASBuild* build = &tracer->blas_builds[rt_world_resolve_mesh(tracer->build_world, mesh)->blas_id];
+    Assert(build->task == NULL);
+    build->task = job_task_make(tracer->build_graph, rt_cpu_blas_task, build);
+    if (loaded != NULL) {
+        job_task_depend(build->task, loaded);
+    }
+    job_task_submit(build->task);
+    return build->task;
+}
+rt_hook JOB_Task* rt_tracer_schedule_tlas(RT_Handle handle) {
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+    Assert(tracer->build_graph != NULL);
+
+    JOB_Task* task = job_task_make(tracer->build_graph, rt_cpu_tlas_task, tracer);
+    for EachIndex(i, tracer->blas.node_count) {
+        RT_CPU_BLASBuild* build = &tracer->blas_builds[i];
+        if (build->task == NULL) {
+            build->task = job_task_make(tracer->build_graph, rt_cpu_blas_task, build);
+            job_task_submit(build->task);
+        }
+        job_task_depend(task, build->task);
+    }
+    job_task_submit(task);
+    return task;
+}
 rt_hook void rt_tracer_cleanup(RT_Handle handle) {
     RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+    rt_cpu_checkpoint_wait(tracer);
     arena_release(tracer->blas_arena);
+    arena_concurrent_release(tracer->blas_lanes);
     arena_release(tracer->tlas_arena);
+    arena_release(tracer->accumulation_arena);
+    arena_release(tracer->checkpoint_arena);
     arena_release(tracer->arena);
 }
 
 rt_hook void rt_tracer_cast(RT_Handle handle, RT_CastSettings settings, vec3_f32* out_radiance, int width, int height) {
     RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
 
+#if BUILD_DEBUG
+    rt_cpu_dump_begin_ray_hit_record("out.rays");
+#endif
+
     rt_cpu_raygen(tracer, &settings, out_radiance, width, height);
 }
 
+rt_hook void rt_tracer_cast_packed(RT_Handle handle, RT_CastSettings settings, PixelFormat format, void* out_pixels, int width, int height) {
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+
+#if BUILD_DEBUG
+    rt_cpu_dump_begin_ray_hit_record("out.rays");
+#endif
+
+    rt_cpu_raygen_packed(tracer, &settings, format, out_pixels, width, height);
+}
+
+rt_hook void rt_tracer_cast_streamed(RT_Handle handle, RT_CastSettings settings, int width, int height, RT_StreamSettings stream_settings) {
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+
+#if BUILD_DEBUG
+    rt_cpu_dump_begin_ray_hit_record("out.rays");
+#endif
+
+    RT_CPU_Target target = rt_cpu_make_target(&settings, width, height);
+    int band_width = target.rect.x1 - target.rect.x0;
+    int band_height = (stream_settings.band_height > 0) ? stream_settings.band_height : RT_CPU_STREAM_BAND_HEIGHT;
+    int rows = target.rect.y1 - target.rect.y0;
+
+    RT_CPU_Stream stream = zero_struct;
+    stream.settings = stream_settings;
+    stream.band_count = (stream_settings.band_count > 0) ? (u32)stream_settings.band_count : RT_CPU_STREAM_BAND_COUNT;
+    stream.bands_total = (u32)((rows + band_height - 1)/band_height);
+
+    {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
+        stream.bands = push_array(scratch.arena, RT_CPU_Band, stream.band_count);
+        for EachIndexU32(i, stream.band_count) {
+            stream.bands[i].pixels = push_array_no_zero(scratch.arena, u8, pixel_format_size(stream_settings.format)*band_width*band_height);
+        }
+        stream.mutex = os_mutex_alloc();
+        stream.cv = os_condition_variable_alloc();
+
+        // @note without a thread of its own every band is written right away
+        OS_Handle writer = os_thread_launch(rt_cpu_stream_writer_main, &stream);
+        bool threaded = !os_is_handle_zero(writer);
+
+        // @note bands are crops of the image, the aovs would need bands of their own
+        RT_CastSettings band_settings = settings;
+        band_settings.aovs = (RT_CastAOVs)zero_struct;
+        band_settings.crop = true;
+        band_settings.crop_buffer = true;
+        for EachIndexU32(idx, stream.bands_total) {
+            RT_CPU_Band* band = &stream.bands[idx % stream.band_count];
+
+            os_mutex_lock(stream.mutex);
+            while (band->full) {
+                os_condition_variable_wait(stream.cv, stream.mutex);
+            }
+            os_mutex_unlock(stream.mutex);
+
+            band->y = (int)idx*band_height;
+            band->rows = Min(band_height, rows - band->y);
+            band_settings.crop_window = (RT_PixelRect){
+                .x0 = target.rect.x0,
+                .y0 = target.rect.y0 + band->y,
+                .x1 = target.rect.x1,
+                .y1 = target.rect.y0 + band->y + band->rows,
+            };
+            rt_cpu_raygen_packed(tracer, &band_settings, stream_settings.format, band->pixels, width, height);
+            if (!threaded) {
+                stream_settings.write_band(stream_settings.user_data, band->y, band->rows, band->pixels);
+                continue;
+            }
+
+            os_mutex_lock(stream.mutex);
+            band->full = true;
+            os_condition_variable_broadcast(stream.cv);
+            os_mutex_unlock(stream.mutex);
+        }
+
+        if (threaded) {
+            os_thread_join(writer);
+        }
+        os_condition_variable_release(stream.cv);
+        os_mutex_release(stream.mutex);
+    }}
+}
+
+rt_hook RT_Handle rt_tracer_cast_async(RT_Handle handle, RT_CastSettings settings, vec3_f32* out_radiance, int width, int height, RT_CastProgressFunction* progress, void* user_data) {
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+
+    RT_CPU_CastJob* job = (RT_CPU_CastJob*)os_allocate(sizeof(RT_CPU_CastJob));
+    MemoryZeroStruct(job);
+    settings.adaptive = false;
+    rt_cpu_cast_job_init(job, tracer, &settings, out_radiance, width, height);
+    job->progress = progress;
+    job->user_data = user_data;
+    job->mutex = os_mutex_alloc();
+    job->status = RT_CastStatus_Running;
+
+    job->thread = os_thread_launch(rt_cpu_cast_job_main, job);
+    if (os_is_handle_zero(job->thread)) {
+        rt_cpu_cast_job_main(job);
+    }
+    return rt_cpu_cast_job_to_handle(job);
+}
+
+rt_hook RT_CastStatus rt_cast_poll(RT_Handle handle) {
+    RT_CPU_CastJob* job = rt_cpu_handle_to_cast_job(handle);
+
+    os_mutex_lock(job->mutex);
+    RT_CastStatus status = job->status;
+    os_mutex_unlock(job->mutex);
+    return status;
+}
+
+rt_hook RT_CastStatus rt_cast_wait(RT_Handle handle) {
+    RT_CPU_CastJob* job = rt_cpu_handle_to_cast_job(handle);
+
+    if (!os_is_handle_zero(job->thread)) {
+        os_thread_join(job->thread);
+    }
+    RT_CastStatus status = job->status;
+    os_mutex_release(job->mutex);
+    os_deallocate(job);
+    return status;
+}
+
+rt_hook void rt_cast_cancel(RT_Handle handle) {
+    RT_CPU_CastJob* job = rt_cpu_handle_to_cast_job(handle);
+
+    os_mutex_lock(job->mutex);
+    job->cancelled = true;
+    os_mutex_unlock(job->mutex);
+}
+
+rt_hook void rt_tracer_begin_accumulation(RT_Handle handle, RT_CastSettings settings, int width, int height) {
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+
+#if BUILD_DEBUG
+    rt_cpu_dump_begin_ray_hit_record("out.rays");
+#endif
+
+    rt_cpu_accumulation_reset(tracer, &settings, width, height);
+}
+
+rt_hook u32 rt_tracer_accumulate(RT_Handle handle, u32 samples) {
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+    RT_CPU_Accumulation* acc = &tracer->accumulation;
+    Assert(acc->estimates != NULL);
+
+    RT_CPU_AccumulatePass pass = {.tracer = tracer, .samples = samples};
+    job_parallel_for((u64)(acc->target.rect.y1 - acc->target.rect.y0), RT_CPU_ACCUMULATE_ROW_GRAIN, rt_cpu_accumulate_rows, &pass);
+    acc->sample_count += samples;
+
+    if (tracer->checkpoint_interval > 0.0 && os_now_seconds() - acc->last_checkpoint >= tracer->checkpoint_interval) {
+        rt_cpu_checkpoint_begin(tracer);
+    }
+    return acc->sample_count;
+}
+
+rt_hook u32 rt_tracer_accumulate_for(RT_Handle handle, f64 seconds) {
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+    RT_CPU_Accumulation* acc = &tracer->accumulation;
+    Assert(acc->estimates != NULL);
+
+    // @note the first call measures how long a sample takes, later calls take
+    // as many as fit in the time left so there are few synchronization points
+    f64 deadline = os_now_seconds() + seconds;
+    u32 samples = 1;
+    for (;;) {
+        f64 start = os_now_seconds();
+        rt_tracer_accumulate(handle, samples);
+        f64 end = os_now_seconds();
+
+        f64 seconds_per_sample = Max(end - start, 1e-9)/samples;
+        f64 affordable = (deadline - end)/seconds_per_sample;
+        if (affordable < 1.0) {
+            break;
+        }
+        if (tracer->checkpoint_interval > 0.0) {
+            affordable = Min(affordable, Max(tracer->checkpoint_interval/seconds_per_sample, 1.0));
+        }
+        samples = (u32)Min(affordable, (f64)MAX_U32);
+    }
+    return acc->sample_count;
+}
+
+rt_hook void rt_tracer_resolve_accumulation(RT_Handle handle, vec3_f32* out_radiance) {
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+    RT_CPU_Accumulation* acc = &tracer->accumulation;
+    Assert(acc->estimates != NULL);
+
+    const RT_CastAOVs* aovs = &acc->settings.aovs;
+    RT_CPU_Target out_target = rt_cpu_make_target(&acc->settings, acc->target.width, acc->target.height);
+    const RT_PixelRect* rect = &acc->target.rect;
+    for (int y = rect->y0; y < rect->y1; y++) {
+        for (int x = rect->x0; x < rect->x1; x++) {
+            u64 idx = rt_cpu_target_index(&acc->target, x, y);
+            u64 out = rt_cpu_target_index(&out_target, x, y);
+            const RT_CPU_PixelEstimate* estimate = &acc->estimates[idx];
+            f32 inv_count = 1.f/(f32)Max(estimate->count, 1u);
+
+            out_radiance[out] = estimate->mean;
+            if (aovs->sample_count) {
+                aovs->sample_count[out] = estimate->count;
+            }
+            if (aovs->albedo) {
+                aovs->albedo[out] = mul_3f32(acc->aov_sums.albedo[idx], inv_count);
+            }
+            if (aovs->normal) {
+                aovs->normal[out] = mul_3f32(acc->aov_sums.normal[idx], inv_count);
+            }
+            if (aovs->depth) {
+                aovs->depth[out] = acc->aov_sums.depth[idx]*inv_count;
+            }
+            if (aovs->variance) {
+                // variance of the mean, as rt_cpu_aovs_resolve
+                aovs->variance[out] = (estimate->count > 1) ? estimate->luminance_m2/((f32)(estimate->count - 1)*estimate->count) : 0.f;
+            }
+        }
+    }
+}
+
+rt_hook void rt_tracer_end_accumulation(RT_Handle handle) {
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+    rt_cpu_checkpoint_wait(tracer);
+    arena_clear(tracer->accumulation_arena);
+    MemoryZeroStruct(&tracer->accumulation);
+}
+
+rt_hook void rt_tracer_set_checkpoint(RT_Handle handle, NTString8 path, f64 interval) {
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+
+    // @note a write in flight still uses the paths
+    rt_cpu_checkpoint_wait(tracer);
+    arena_clear(tracer->checkpoint_arena);
+    tracer->checkpoint_path = ntstr8_concatenate(tracer->checkpoint_arena, path, ntstr8_lit(""));
+    tracer->checkpoint_temp_path = ntstr8_concatenate(tracer->checkpoint_arena, path, ntstr8_lit(".tmp"));
+    tracer->checkpoint_interval = (path.length > 0) ? interval : 0.0;
+}
+
+rt_hook void rt_tracer_checkpoint(RT_Handle handle) {
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+    Assert(tracer->accumulation.estimates != NULL);
+
+    if (tracer->checkpoint_path.length > 0) {
+        rt_cpu_checkpoint_begin(tracer);
+    }
+}
+
+rt_hook bool rt_tracer_resume_accumulation(RT_Handle handle, RT_CastSettings settings, int width, int height, NTString8 path) {
+    rt_tracer_begin_accumulation(handle, settings, width, height);
+
+    RT_CPU_Tracer* tracer = rt_cpu_handle_to_tracer(handle);
+    if (!rt_cpu_checkpoint_read(tracer, path)) {
+        rt_tracer_end_accumulation(handle);
+        return false;
+    }
+    return true;
+}
+
 // ============================================================================
 // acceleration structures
 // ============================================================================
@@ -117,6 +470,8 @@ internal void rt_cpu_build_blas(RT_CPU_BLAS* out_blas, Arena* arena, RT_World* w
 
 static void rt_cpu_tlas_node_from_instance(RT_CPU_TLASNode* out_node, const RT_Instance* instance, const RT_CPU_BLAS* in_blas, RT_World* world) {
     out_node->instance = instance;
+    out_node->blas_node = NULL;
+    out_node->light_offset = RT_CPU_NO_LIGHT;
 
     switch (instance->type) {
         case RT_InstanceType_Mesh:{
@@ -168,200 +523,1197 @@ internal void rt_cpu_build_tlas(RT_CPU_TLAS* out_tlas, Arena* arena, const RT_CP
         out_tlas->lbvh = lbvh_make(arena, world_aabbs, instances->length);
     }}
 
+    rt_cpu_build_light_table(&out_tlas->lights, arena, out_tlas, world);
+    rt_cpu_build_light_tree(&out_tlas->light_tree, arena, &out_tlas->lights);
+
     #ifdef BUILD_DEBUG
         lbvh_dump_tree(&out_tlas->lbvh, "out.bvh");
     #endif
 }
 
-// ============================================================================
-// cpu kernels
-// ============================================================================
-internal void rt_cpu_raygen(RT_CPU_Tracer* tracer, const RT_CastSettings* s, vec3_f32* out_radiance, int width, int height) {
-#if BUILD_DEBUG
-    rt_cpu_dump_begin_ray_hit_record("out.rays");
-#endif
+static void rt_cpu_get_tri(const RT_CPU_BLASNode* blas_node, GEO_VertexAttributes attr, u32 idx, vec3_f32* out_0, vec3_f32* out_1, vec3_f32* out_2);
 
-    f32 x_norm_sample_size = 1.f/(f32)(width *s->samples);
-    f32 y_norm_sample_size = 1.f/(f32)(height*s->samples);
-    f32 inv_sample_count = 1.f/((f32)s->samples*s->samples);
+static bool rt_cpu_material_is_emissive(const RT_Material* mat) {
+    switch (mat->type) {
+        case RT_MaterialType_Lambertian:
+        case RT_MaterialType_Dieletric:
+        case RT_MaterialType_Light:{
+            return mat->emissive.r > 0.f || mat->emissive.g > 0.f || mat->emissive.b > 0.f;
+        }break;
+        default: return false;
+    }
+}
 
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            vec3_f32* c = &out_radiance[y*width + x];
-            
-            *c = zero_struct;
-            for (int y_sample = 0; y_sample < s->samples; y_sample++) {
-                for (int x_sample = 0; x_sample < s->samples; x_sample++) {
-                    f32 x_norm = ((f32)x/width ) + ((f32)x_sample/s->samples)*x_norm_sample_size;
-                    f32 y_norm = ((f32)y/height) + ((f32)y_sample/s->samples)*y_norm_sample_size;
-
-                    if (s->samples > 1) {
-                        // jitter @todo blue noise
-                        x_norm += rand_unit_f32()*x_norm_sample_size;
-                        y_norm += rand_unit_f32()*y_norm_sample_size;
-                    } else {
-                        x_norm += 0.5f*x_norm_sample_size;
-                        y_norm += 0.5f*y_norm_sample_size;
-                    }
-                    
-                    // @note (0,0) -> TL, (w,h) -> BR
-                    vec3_f32 ndc = make_3f32(2.f*x_norm - 1.f, 1.f - 2.f*y_norm, 1.f);
-                    vec3_f32 view = elmul_3f32(ndc, s->viewport);
-                    
-                    // map to world space and defocus
-                    vec3_f32 sample = add_3f32(add_3f32(add_3f32(
-                        s->eye,
-                        mul_3f32(s->right,   view.x)),
-                        mul_3f32(s->up,      view.y)),
-                        mul_3f32(s->forward, view.z)
-                    );
-
-                    vec3_f32 origin = (!s->orthographic) ? s->eye : sub_3f32(sample, s->forward);
-                    if (s->defocus) {
-                        vec2_f32 disk_sample = elmul_2f32(rand_unit_sphere_2f32(), s->defocus_disk);
-                        origin = add_3f32(add_3f32(origin,
-                            mul_3f32(s->right, disk_sample.x)),
-                            mul_3f32(s->up,    disk_sample.y)
-                        );
-                    }
+static f32 rt_cpu_luminance(vec3_f32 c) {
+    return 0.2126f*c.r + 0.7152f*c.g + 0.0722f*c.b;
+}
 
-                    rng3_f32 ray = {
-                        .origin = origin,
-                        .direction = normalize_3f32(sub_3f32(sample, origin)),
-                    };
-        
-                    RT_CPU_TraceContext ctx = zero_struct;
-                    ctx.ior[0] = s->ior;
-                    RT_CPU_HitRecord record;
-                    *c = add_3f32(*c, rt_cpu_trace_ray(tracer, &ctx, &ray, tracer->max_bounces, geo_make_pos_interval(), &record));
-                }
-            }
-            *c = mul_3f32(*c, inv_sample_count);
+internal void rt_cpu_build_light_table(RT_CPU_LightTable* out_lights, Arena* arena, RT_CPU_TLAS* inout_tlas, RT_World* world) {
+    *out_lights = zero_struct;
+
+    // count lights so the table is a single allocation
+    for EachIndex(idx, inout_tlas->node_count) {
+        RT_CPU_TLASNode* tlas_node = &inout_tlas->nodes[idx];
+        const RT_Instance* instance = tlas_node->instance;
+        if (rt_is_zero_handle(instance->material) || !rt_cpu_material_is_emissive(rt_world_resolve_material(world, instance->material))) {
+            continue;
+        }
+
+        tlas_node->light_offset = out_lights->count;
+        switch (instance->type) {
+            case RT_InstanceType_Sphere:{
+                out_lights->count += 1;
+            }break;
+            case RT_InstanceType_Mesh:{
+                const RT_CPU_BLASNode* blas_node = tlas_node->blas_node;
+                const RT_Mesh* mesh = blas_node->mesh;
+                Assert(mesh->primitive == GEO_Primitive_TRI_LIST); // @todo
+                out_lights->count += blas_node->auto_index ? mesh->vertices_count/3 : mesh->indices_count/3;
+            }break;
         }
     }
-}
+    if (out_lights->count == 0) {
+        return;
+    }
 
-internal vec3_f32 rt_cpu_trace_ray(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const rng3_f32* in_ray, u8 depth, rng_f32 interval, RT_CPU_HitRecord* out_record) {
-    Assert(abs_f32(length2_3f32(in_ray->direction) - 1) < 0.001f);
+    out_lights->lights = push_array_no_zero(arena, RT_CPU_Light, out_lights->count);
+    out_lights->power_cdf = push_array_no_zero(arena, f32, out_lights->count);
 
-    if (depth == 0) {
-        return make_scale_3f32(0.f);
+    for EachIndex(idx, inout_tlas->node_count) {
+        const RT_CPU_TLASNode* tlas_node = &inout_tlas->nodes[idx];
+        const RT_Instance* instance = tlas_node->instance;
+        if (tlas_node->light_offset == RT_CPU_NO_LIGHT) {
+            continue;
+        }
+        vec3_f32 emissive = rt_world_resolve_material(world, instance->material)->emissive;
+
+        switch (instance->type) {
+            case RT_InstanceType_Sphere:{
+                RT_CPU_Light* light = &out_lights->lights[tlas_node->light_offset];
+                light->type = RT_CPU_LightType_Sphere;
+                light->sphere.center = instance->sphere.center;
+                light->sphere.radius = instance->sphere.radius;
+                light->area = 4.f*PI_F32*instance->sphere.radius*instance->sphere.radius;
+                light->emissive = emissive;
+            }break;
+            case RT_InstanceType_Mesh:{
+                const RT_MeshInstance* mesh_inst = &instance->mesh;
+                const RT_CPU_BLASNode* blas_node = tlas_node->blas_node;
+                const RT_Mesh* mesh = blas_node->mesh;
+                u64 tris_count = blas_node->auto_index ? mesh->vertices_count/3 : mesh->indices_count/3;
+
+                for EachIndex(tri, tris_count) {
+                    vec3_f32 v0,v1,v2;
+                    rt_cpu_get_tri(blas_node, GEO_VertexAttributes_P, tri*3, &v0, &v1, &v2);
+
+                    RT_CPU_Light* light = &out_lights->lights[tlas_node->light_offset + tri];
+                    light->type = RT_CPU_LightType_Tri;
+                    light->tri.v0 = rt_cpu_transform_point(v0, mesh_inst->translation, mesh_inst->rotation, mesh_inst->scale);
+                    light->tri.v1 = rt_cpu_transform_point(v1, mesh_inst->translation, mesh_inst->rotation, mesh_inst->scale);
+                    light->tri.v2 = rt_cpu_transform_point(v2, mesh_inst->translation, mesh_inst->rotation, mesh_inst->scale);
+
+                    vec3_f32 c = cross_3f32(sub_3f32(light->tri.v1, light->tri.v0), sub_3f32(light->tri.v2, light->tri.v0));
+                    f32 c_length = length_3f32(c);
+                    light->tri.n = (c_length > 0.f) ? mul_3f32(c, 1.f/c_length) : make_up_3f32();
+                    light->area = 0.5f*c_length;
+                    light->emissive = emissive;
+                }
+            }break;
+        }
     }
 
-    if (rt_cpu_intersect(tracer, in_ray, interval, out_record)) {
-        return rt_cpu_closest_hit(tracer, ctx, in_ray, depth, out_record);
+    // @note two-sided lambertian emitters
+    f32 total_power = 0.f;
+    for EachIndex(idx, out_lights->count) {
+        RT_CPU_Light* light = &out_lights->lights[idx];
+        light->power = 2.f*PI_F32*light->area*rt_cpu_luminance(light->emissive);
+        total_power += light->power;
+        out_lights->power_cdf[idx] = total_power;
     }
-    return rt_cpu_miss(tracer, ctx, in_ray, depth);
+    out_lights->total_power = total_power;
 }
 
-#define RT_CPU_SURFACE_OFFSET 0.001f
-
-internal vec3_f32 rt_cpu_closest_hit(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const rng3_f32* in_ray, u8 depth, RT_CPU_HitRecord* in_record) {
-#if BUILD_DEBUG
-    rt_cpu_dump_add_ray_hit_record(in_ray, in_record, "out.rays");
-#endif
-
-    if (rt_is_zero_handle(in_record->material)) {
-        return make_scale_3f32(1.f);
+// smallest cone containing both, see pbrt-v4 DirectionCone Union
+static void rt_cpu_merge_cones(vec3_f32 a_axis, f32 a_cos, vec3_f32 b_axis, f32 b_cos, vec3_f32* out_axis, f32* out_cos) {
+    *out_axis = a_axis;
+    *out_cos = -1.f;
+    if (a_cos <= -1.f || b_cos <= -1.f) {
+        return;
     }
 
-    RT_Material* mat = &((RT_MaterialNode*)in_record->material.v64[0])->v;
+    f32 theta_a = acos_f32(Clamp(a_cos, -1.f, 1.f));
+    f32 theta_b = acos_f32(Clamp(b_cos, -1.f, 1.f));
+    f32 theta_d = acos_f32(Clamp(dot_3f32(a_axis, b_axis), -1.f, 1.f));
 
-    if (mat->billboard && dot_3f32(in_record->n, in_ray->direction) > 0.f) {
-        in_record->n = mul_3f32(in_record->n, -1.f);
+    if (Min(theta_d + theta_b, PI_F32) <= theta_a) {
+        *out_cos = a_cos;
+        return;
+    }
+    if (Min(theta_d + theta_a, PI_F32) <= theta_b) {
+        *out_axis = b_axis;
+        *out_cos = b_cos;
+        return;
     }
 
-    switch (mat->type) {
-        case RT_MaterialType_Lambertian:{
-            rng3_f32 s_ray = {
-                .origin = add_3f32(in_record->p, mul_3f32(in_record->n, RT_CPU_SURFACE_OFFSET)),
-                .direction = rt_cpu_cosine_sample_hemisphere(in_record->n),
-            };
-            
-            RT_CPU_HitRecord r_record;
-            vec3_f32 i_radiance = rt_cpu_trace_ray(tracer, ctx, &s_ray, depth-1, geo_make_pos_interval(), &r_record);
-            vec3_f32 brdf_times_pi = mat->albedo;
+    f32 theta_o = (theta_a + theta_d + theta_b)*0.5f;
+    vec3_f32 w_r = cross_3f32(a_axis, b_axis);
+    if (theta_o >= PI_F32 || length2_3f32(w_r) == 0.f) {
+        return;
+    }
 
-            // drop extra terms since pdf = cos_theta / PI
-            vec3_f32 s_radiance = elmul_3f32(brdf_times_pi, i_radiance); // * (cos_theta / PI) / pdf
-            vec3_f32 e_radiance = mat->emissive;
+    // rotate a's axis towards b's so the new cone touches both edges
+    *out_axis = normalize_3f32(rot_quat(a_axis, make_angle_axis_quat(theta_o - theta_a, normalize_3f32(w_r))));
+    *out_cos = cos_f32(theta_o);
+}
 
-            return add_3f32(s_radiance, e_radiance);
-        }break;
-        case RT_MaterialType_Dieletric:{
-            Assert(!mat->billboard);
+static u32 rt_cpu_light_tree_node_from_lbvh(RT_CPU_LightTree* tree, const LBVH_Node* lbvh_node, const RT_CPU_LightTable* in_lights, u32 parent) {
+    u32 idx = (u32)tree->node_count++;
+    RT_CPU_LightTreeNode* node = &tree->nodes[idx];
+    node->parent = parent;
+
+    if (lbvh_node->id > 0) {
+        u32 light_idx = (u32)(lbvh_node->id - 1);
+        const RT_CPU_Light* light = &in_lights->lights[light_idx];
+
+        node->leaf = true;
+        node->children[0] = light_idx;
+        node->aabb = lbvh_node->aabb;
+        node->power = light->power;
+        switch (light->type) {
+            case RT_CPU_LightType_Tri:{
+                node->axis = light->tri.n;
+                node->cos_theta_o = 1.f;
+            }break;
+            case RT_CPU_LightType_Sphere:{
+                node->axis = make_up_3f32();
+                node->cos_theta_o = -1.f;
+            }break;
+        }
+        tree->light_nodes[light_idx] = idx;
+        return idx;
+    }
 
-            f32 idotn = -dot_3f32(in_record->n, in_ray->direction);
-            bool backface = idotn < 0.f;
-            vec3_f32 n_corr = mul_3f32(in_record->n, backface ? -1.f : 1.f);
+    // @note children are pushed after the parent so node may move, index instead
+    u32 left = rt_cpu_light_tree_node_from_lbvh(tree, lbvh_node->left, in_lights, idx);
+    u32 right = rt_cpu_light_tree_node_from_lbvh(tree, lbvh_node->right, in_lights, idx);
+
+    node = &tree->nodes[idx];
+    const RT_CPU_LightTreeNode* l = &tree->nodes[left];
+    const RT_CPU_LightTreeNode* r = &tree->nodes[right];
+    node->leaf = false;
+    node->children[0] = left;
+    node->children[1] = right;
+    node->aabb = merge_rng3_f32(l->aabb, r->aabb);
+    node->power = l->power + r->power;
+    rt_cpu_merge_cones(l->axis, l->cos_theta_o, r->axis, r->cos_theta_o, &node->axis, &node->cos_theta_o);
+    return idx;
+}
 
-            f32 eta_i = ctx->ior[ctx->ior_count];
-            f32 eta_t = backface ? mat->ior : ctx->ior[Max(ctx->ior_count-1, 0)];
-            f32 eta = eta_i / eta_t;
-            bool tir = sqrt_f32(1-idotn*idotn)*eta > 1.f;
-            bool reflect = tir || rt_cpu_fresnel_schlick(eta_i, eta_t, abs_f32(idotn)) > rand_unit_f32();
+internal void rt_cpu_build_light_tree(RT_CPU_LightTree* out_tree, Arena* arena, const RT_CPU_LightTable* in_lights) {
+    *out_tree = zero_struct;
+    if (in_lights->count == 0) {
+        return;
+    }
 
-            rng3_f32 s_ray = *in_ray;
-            if (reflect) {
-                s_ray = {
-                    .origin=add_3f32(in_record->p, mul_3f32(n_corr, RT_CPU_SURFACE_OFFSET)),
-                    .direction = reflect_3f32(in_ray->direction, n_corr),
-                };
-            } else {
-                s_ray = {
-                    .origin=add_3f32(in_record->p, mul_3f32(n_corr, -RT_CPU_SURFACE_OFFSET)),
-                    .direction = refract_3f32(in_ray->direction, n_corr, eta),
-                };
-                ctx->ior_count++;
-                ctx->ior[ctx->ior_count] = eta_t;
+    {DeferResource(Temp scratch = scratch_begin_a(arena), scratch_end(scratch)) {
+        rng3_f32* light_aabbs = push_array_no_zero(scratch.arena, rng3_f32, in_lights->count);
+        for EachIndex(idx, in_lights->count) {
+            const RT_CPU_Light* light = &in_lights->lights[idx];
+            switch (light->type) {
+                case RT_CPU_LightType_Tri:{
+                    light_aabbs[idx] = rt_cpu_aabb_from_tri(light->tri.v0, light->tri.v1, light->tri.v2);
+                }break;
+                case RT_CPU_LightType_Sphere:{
+                    vec3_f32 r = make_scale_3f32(light->sphere.radius);
+                    light_aabbs[idx] = make_rng3_f32(sub_3f32(light->sphere.center, r), add_3f32(light->sphere.center, r));
+                }break;
             }
+        }
 
-            RT_CPU_HitRecord s_record;
-            vec3_f32 s_radiance = rt_cpu_trace_ray(tracer, ctx, &s_ray, depth-1, geo_make_pos_interval(), &s_record);
-            vec3_f32 e_radiance = mat->emissive;
+        // morton ordered binary tree, flattened so power and cones sit next to the bounds
+        LBVH_Tree lbvh = lbvh_make(scratch.arena, light_aabbs, in_lights->count);
 
-            if (!reflect) {
-                ctx->ior_count--;
-            }
+        out_tree->nodes = push_array_no_zero(arena, RT_CPU_LightTreeNode, 2*in_lights->count - 1);
+        out_tree->light_nodes = push_array_no_zero(arena, u32, in_lights->count);
+        rt_cpu_light_tree_node_from_lbvh(out_tree, lbvh.root, in_lights, RT_CPU_LIGHT_TREE_ROOT);
+        Assert(out_tree->node_count == 2*in_lights->count - 1);
+    }}
+}
 
-            return add_3f32(s_radiance, e_radiance);
-        }break;
-        case RT_MaterialType_Metal:{
-            vec3_f32 i = reflect_3f32(in_ray->direction, in_record->n);
-            // approximation of specular lobe
-            i = add_3f32(i, mul_3f32(rand_unit_sphere_3f32(), mat->roughness));
+// ============================================================================
+// cpu kernels
+// ============================================================================
+internal rng3_f32 rt_cpu_primary_ray(const RT_CastSettings* s, RT_CPU_Sampler* sampler, int x, int y, int width, int height) {
+    vec2_f32 subpixel = rt_cpu_sampler_pixel(sampler);
+    f32 x_norm = ((f32)x + subpixel.x)/width;
+    f32 y_norm = ((f32)y + subpixel.y)/height;
+
+    // @note (0,0) -> TL, (w,h) -> BR
+    vec3_f32 ndc = make_3f32(2.f*x_norm - 1.f, 1.f - 2.f*y_norm, 1.f);
+    vec3_f32 view = elmul_3f32(ndc, s->viewport);
+    
+    // map to world space and defocus
+    vec3_f32 sample = add_3f32(add_3f32(add_3f32(
+        s->eye,
+        mul_3f32(s->right,   view.x)),
+        mul_3f32(s->up,      view.y)),
+        mul_3f32(s->forward, view.z)
+    );
 
-            rng3_f32 s_ray = {
-                .origin=add_3f32(in_record->p, mul_3f32(in_record->n, RT_CPU_SURFACE_OFFSET)),
-                .direction=normalize_3f32(i),
-            };
-            RT_CPU_HitRecord i_record;
-            
-            return rt_cpu_trace_ray(tracer, ctx, &s_ray, depth-1, geo_make_pos_interval(), &i_record);
-        }break;
-        case RT_MaterialType_Normal:{
-            return rt_cpu_normal_to_radiance(in_record->n);
-        }break;
-        case RT_MaterialType_Light:{
-            return mat->emissive;
-        }break;
+    vec3_f32 origin = (!s->orthographic) ? s->eye : sub_3f32(sample, s->forward);
+    if (s->defocus) {
+        vec2_f32 disk_sample = elmul_2f32(rt_cpu_square_to_disk(rt_cpu_sampler_2d(sampler, RT_CPU_SampleDimension_Lens)), s->defocus_disk);
+        origin = add_3f32(add_3f32(origin,
+            mul_3f32(s->right, disk_sample.x)),
+            mul_3f32(s->up,    disk_sample.y)
+        );
     }
 
-    NotImplemented;
-    return make_3f32(0,0,0);
+    return (rng3_f32){
+        .origin = origin,
+        .direction = normalize_3f32(sub_3f32(sample, origin)),
+    };
 }
 
-internal vec3_f32 rt_cpu_miss(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const rng3_f32* in_ray, u8 depth) {
-#if BUILD_DEBUG
-    rt_cpu_dump_add_ray_miss_record(in_ray, "out.rays");
-#endif
-
-    if (!tracer->sky) {
-        return make_scale_3f32(0.f);
+internal RT_CPU_Target rt_cpu_make_target(const RT_CastSettings* s, int width, int height) {
+    RT_PixelRect image = {.x0 = 0, .y0 = 0, .x1 = width, .y1 = height};
+    RT_CPU_Target target = {.width = width, .height = height, .rect = image};
+    if (s->crop) {
+        target.rect.x0 = Clamp(s->crop_window.x0, 0, width);
+        target.rect.y0 = Clamp(s->crop_window.y0, 0, height);
+        target.rect.x1 = Clamp(s->crop_window.x1, target.rect.x0, width);
+        target.rect.y1 = Clamp(s->crop_window.y1, target.rect.y0, height);
     }
+    target.buffer = (s->crop && s->crop_buffer) ? target.rect : image;
+    target.stride = target.buffer.x1 - target.buffer.x0;
+    return target;
+}
 
-    f32 y = Clamp(in_ray->direction.y, 0.f, 1.f);
-    f32 t = pow_f32(y, 0.5f);
+internal u64 rt_cpu_target_index(const RT_CPU_Target* target, int x, int y) {
+    return (u64)(y - target->buffer.y0)*target->stride + (x - target->buffer.x0);
+}
+
+#define RT_CPU_RAYGEN_BATCH_SIZE 64
+
+static u64 rt_cpu_raygen_tile_interleaved(RT_CPU_Tracer* tracer, const RT_CastSettings* s, vec3_f32* out_radiance, const RT_CPU_Target* target, RT_PixelRect tile) {
+    f32 inv_sample_count = 1.f/((f32)s->samples*s->samples);
+    int row_sample_count = (tile.x1 - tile.x0)*s->samples*s->samples;
+    bool aovs = rt_cpu_wants_aovs(&s->aovs);
+    u64 ray_count = 0;
+
+    rng3_f32 rays[RT_CPU_RAYGEN_BATCH_SIZE];
+    rng_f32 intervals[RT_CPU_RAYGEN_BATCH_SIZE];
+    RT_CPU_HitRecord records[RT_CPU_RAYGEN_BATCH_SIZE];
+    bool hits[RT_CPU_RAYGEN_BATCH_SIZE];
+    int pixels[RT_CPU_RAYGEN_BATCH_SIZE];
+    RT_CPU_Sampler samplers[RT_CPU_RAYGEN_BATCH_SIZE];
+
+    for (int y = tile.y0; y < tile.y1; y++) {
+        // @note indexed from the tile's x0, the buffer may start there
+        u64 row_start = rt_cpu_target_index(target, tile.x0, y);
+        vec3_f32* row = &out_radiance[row_start];
+        for (int x = tile.x0; x < tile.x1; x++) {
+            row[x - tile.x0] = zero_struct;
+        }
+
+        // @note samples of a row are flattened so batches span pixels
+        for (int batch_start = 0; batch_start < row_sample_count; batch_start += RT_CPU_RAYGEN_BATCH_SIZE) {
+            int batch_count = Min(RT_CPU_RAYGEN_BATCH_SIZE, row_sample_count - batch_start);
+
+            for (int i = 0; i < batch_count; i++) {
+                int row_sample = batch_start + i;
+                int pixel_sample = row_sample % (s->samples*s->samples);
+                int x = tile.x0 + row_sample / (s->samples*s->samples);
+
+                pixels[i] = x - tile.x0;
+                samplers[i] = rt_cpu_make_sampler(s->sampler, s->seed, s->samples, x, y, pixel_sample);
+                rays[i] = rt_cpu_primary_ray(s, &samplers[i], x, y, target->width, target->height);
+                intervals[i] = geo_make_pos_interval();
+            }
+
+            rt_cpu_intersect_interleaved(tracer, rays, intervals, records, hits, batch_count);
+
+            for (int i = 0; i < batch_count; i++) {
+                RT_CPU_TraceContext ctx = zero_struct;
+                ctx.sampler = samplers[i];
+                ctx.ior[0] = s->ior;
+                RT_CPU_PrimaryHit primary = {.hit = hits[i], .record = records[i]};
+                vec3_f32 radiance = rt_cpu_trace_path(tracer, &ctx, &rays[i], &primary);
+                row[pixels[i]] = add_3f32(row[pixels[i]], radiance);
+                if (aovs) {
+                    rt_cpu_aovs_add(&s->aovs, row_start + pixels[i], &ctx.first_hit, radiance);
+                }
+                ray_count += ctx.ray_count;
+            }
+        }
+
+        for (int x = tile.x0; x < tile.x1; x++) {
+            vec3_f32* pixel = &row[x - tile.x0];
+            *pixel = mul_3f32(*pixel, inv_sample_count);
+            if (aovs) {
+                rt_cpu_aovs_resolve(&s->aovs, row_start + (x - tile.x0), (u32)s->samples*s->samples, *pixel);
+            }
+        }
+    }
+    return ray_count;
+}
+
+internal u64 rt_cpu_raygen_tile(RT_CPU_Tracer* tracer, const RT_CastSettings* s, vec3_f32* out_radiance, const RT_CPU_Target* target, RT_PixelRect tile) {
+    if (tracer->traversal == RT_TraversalMode_Interleaved) {
+        return rt_cpu_raygen_tile_interleaved(tracer, s, out_radiance, target, tile);
+    }
+
+    f32 inv_sample_count = 1.f/((f32)s->samples*s->samples);
+    bool aovs = rt_cpu_wants_aovs(&s->aovs);
+    u64 ray_count = 0;
+
+    for (int y = tile.y0; y < tile.y1; y++) {
+        for (int x = tile.x0; x < tile.x1; x++) {
+            u64 idx = rt_cpu_target_index(target, x, y);
+            vec3_f32* c = &out_radiance[idx];
+            
+            *c = zero_struct;
+            for (int y_sample = 0; y_sample < s->samples; y_sample++) {
+                for (int x_sample = 0; x_sample < s->samples; x_sample++) {
+                    RT_CPU_TraceContext ctx = zero_struct;
+                    ctx.sampler = rt_cpu_make_sampler(s->sampler, s->seed, s->samples, x, y, y_sample*s->samples + x_sample);
+                    ctx.ior[0] = s->ior;
+                    rng3_f32 ray = rt_cpu_primary_ray(s, &ctx.sampler, x, y, target->width, target->height);
+                    vec3_f32 radiance = rt_cpu_trace_path(tracer, &ctx, &ray, NULL);
+                    *c = add_3f32(*c, radiance);
+                    if (aovs) {
+                        rt_cpu_aovs_add(&s->aovs, idx, &ctx.first_hit, radiance);
+                    }
+                    ray_count += ctx.ray_count;
+                }
+            }
+            *c = mul_3f32(*c, inv_sample_count);
+            if (aovs) {
+                rt_cpu_aovs_resolve(&s->aovs, idx, (u32)s->samples*s->samples, *c);
+            }
+        }
+    }
+    return ray_count;
+}
+
+// traces tile into f32 of its own and packs it into the framebuffer of job
+static u64 rt_cpu_raygen_tile_packed(RT_CPU_CastJob* job, RT_PixelRect tile) {
+    vec3_f32 radiance[RT_CPU_TILE_SIZE*RT_CPU_TILE_SIZE];
+    int tile_width = tile.x1 - tile.x0;
+
+    RT_CPU_Target tile_target = job->target;
+    tile_target.buffer = tile;
+    tile_target.stride = tile_width;
+    u64 ray_count = rt_cpu_raygen_tile(job->tracer, &job->settings, radiance, &tile_target, tile);
+
+    u64 pixel_size = pixel_format_size(job->format);
+    for (int y = tile.y0; y < tile.y1; y++) {
+        u8* out = (u8*)job->out_pixels + rt_cpu_target_index(&job->target, tile.x0, y)*pixel_size;
+        pack_pixels(job->format, out, &radiance[(u64)(y - tile.y0)*tile_width], tile_width);
+    }
+    return ray_count;
+}
+
+internal void rt_cpu_raygen_tiles(void* data, u64 begin, u64 end) {
+    RT_CPU_CastJob* job = (RT_CPU_CastJob*)data;
+    bool async = !os_is_handle_zero(job->mutex);
+
+    for (u64 idx = begin; idx < end; idx++) {
+        if (async) {
+            os_mutex_lock(job->mutex);
+            bool cancelled = job->cancelled;
+            os_mutex_unlock(job->mutex);
+            if (cancelled) {
+                return;
+            }
+        }
+
+        const RT_PixelRect* rect = &job->target.rect;
+        int tile_x = rect->x0 + (int)(idx % job->tiles_x)*RT_CPU_TILE_SIZE;
+        int tile_y = rect->y0 + (int)(idx / job->tiles_x)*RT_CPU_TILE_SIZE;
+        RT_PixelRect tile = {
+            .x0 = tile_x,
+            .y0 = tile_y,
+            .x1 = Min(tile_x + RT_CPU_TILE_SIZE, rect->x1),
+            .y1 = Min(tile_y + RT_CPU_TILE_SIZE, rect->y1),
+        };
+        u64 ray_count = (job->out_pixels != NULL)
+            ? rt_cpu_raygen_tile_packed(job, tile)
+            : rt_cpu_raygen_tile(job->tracer, &job->settings, job->out_radiance, &job->target, tile);
+
+        if (async) {
+            os_mutex_lock(job->mutex);
+            job->tiles_done++;
+            job->ray_count += ray_count;
+            if (job->progress) {
+                // @note under the lock so calls never overlap
+                f64 elapsed = Max(os_now_seconds() - job->start, 1e-9);
+                RT_CastProgress progress = {
+                    .tiles_done = job->tiles_done,
+                    .tile_count = job->tile_count,
+                    .rays_per_second = (f64)job->ray_count/elapsed,
+                };
+                job->progress(job->user_data, progress);
+            }
+            os_mutex_unlock(job->mutex);
+        }
+    }
+}
+
+// clears the aovs that are summed into, only the rows of the traced rect
+static void rt_cpu_raygen_clear_aovs(const RT_CastSettings* s, const RT_CPU_Target* target) {
+    u64 count = (u64)(target->rect.x1 - target->rect.x0);
+    for (int y = target->rect.y0; y < target->rect.y1; y++) {
+        u64 start = rt_cpu_target_index(target, target->rect.x0, y);
+        if (s->aovs.albedo) {
+            memset(&s->aovs.albedo[start], 0, sizeof(vec3_f32)*count);
+        }
+        if (s->aovs.normal) {
+            memset(&s->aovs.normal[start], 0, sizeof(vec3_f32)*count);
+        }
+        if (s->aovs.depth) {
+            memset(&s->aovs.depth[start], 0, sizeof(f32)*count);
+        }
+        if (s->aovs.variance) {
+            memset(&s->aovs.variance[start], 0, sizeof(f32)*count);
+        }
+        if (s->aovs.sample_count) {
+            for EachIndex(idx, count) {
+                s->aovs.sample_count[start + idx] = (u32)s->samples*s->samples;
+            }
+        }
+    }
+}
+
+internal void rt_cpu_cast_job_main(void* data) {
+    RT_CPU_CastJob* job = (RT_CPU_CastJob*)data;
+    ThreadCtx ctx;
+    bool equip = thread_get_context() == NULL;
+    if (equip) {
+        thread_equip(&ctx);
+    }
+
+#if BUILD_DEBUG
+    rt_cpu_dump_begin_ray_hit_record("out.rays");
+#endif
+
+    job->start = os_now_seconds();
+    rt_cpu_raygen_clear_aovs(&job->settings, &job->target);
+    job_parallel_for(job->tile_count, 1, rt_cpu_raygen_tiles, job);
+
+    os_mutex_lock(job->mutex);
+    job->status = (job->tiles_done == job->tile_count) ? RT_CastStatus_Done : RT_CastStatus_Cancelled;
+    os_mutex_unlock(job->mutex);
+
+    if (equip) {
+        thread_release();
+    }
+}
+
+// hands the bands of a stream to its writer in order
+internal void rt_cpu_stream_writer_main(void* data) {
+    RT_CPU_Stream* stream = (RT_CPU_Stream*)data;
+    ThreadCtx ctx;
+    thread_equip(&ctx);
+
+    for EachIndexU32(idx, stream->bands_total) {
+        RT_CPU_Band* band = &stream->bands[idx % stream->band_count];
+
+        os_mutex_lock(stream->mutex);
+        while (!band->full) {
+            os_condition_variable_wait(stream->cv, stream->mutex);
+        }
+        os_mutex_unlock(stream->mutex);
+
+        stream->settings.write_band(stream->settings.user_data, band->y, band->rows, band->pixels);
+
+        os_mutex_lock(stream->mutex);
+        band->full = false;
+        os_condition_variable_broadcast(stream->cv);
+        os_mutex_unlock(stream->mutex);
+    }
+
+    thread_release();
+}
+
+// splits the image into tiles for job, the caller fills in the rest
+internal void rt_cpu_cast_job_init(RT_CPU_CastJob* job, RT_CPU_Tracer* tracer, const RT_CastSettings* s, vec3_f32* out_radiance, int width, int height) {
+    job->tracer = tracer;
+    job->settings = *s;
+    job->out_radiance = out_radiance;
+    job->target = rt_cpu_make_target(s, width, height);
+
+    const RT_PixelRect* rect = &job->target.rect;
+    job->tiles_x = (u32)(rect->x1 - rect->x0 + RT_CPU_TILE_SIZE - 1)/RT_CPU_TILE_SIZE;
+    job->tile_count = job->tiles_x*((u32)(rect->y1 - rect->y0 + RT_CPU_TILE_SIZE - 1)/RT_CPU_TILE_SIZE);
+}
+
+internal void rt_cpu_raygen(RT_CPU_Tracer* tracer, const RT_CastSettings* s, vec3_f32* out_radiance, int width, int height) {
+    RT_CPU_Target target = rt_cpu_make_target(s, width, height);
+    rt_cpu_raygen_clear_aovs(s, &target);
+    if (s->adaptive) {
+        rt_cpu_raygen_adaptive(tracer, s, out_radiance, &target);
+        return;
+    }
+
+    RT_CPU_CastJob job = zero_struct;
+    rt_cpu_cast_job_init(&job, tracer, s, out_radiance, width, height);
+    job_parallel_for(job.tile_count, 1, rt_cpu_raygen_tiles, &job);
+}
+
+internal void rt_cpu_raygen_packed(RT_CPU_Tracer* tracer, const RT_CastSettings* s, PixelFormat format, void* out_pixels, int width, int height) {
+    if (format == PixelFormat_RGB32F) {
+        rt_cpu_raygen(tracer, s, (vec3_f32*)out_pixels, width, height);
+        return;
+    }
+
+    // @note the aovs would be indexed by the tile buffers
+    RT_CastSettings tile_settings = *s;
+    tile_settings.aovs = (RT_CastAOVs)zero_struct;
+    tile_settings.adaptive = false;
+
+    RT_CPU_CastJob job = zero_struct;
+    rt_cpu_cast_job_init(&job, tracer, &tile_settings, NULL, width, height);
+    job.format = format;
+    job.out_pixels = out_pixels;
+    job_parallel_for(job.tile_count, 1, rt_cpu_raygen_tiles, &job);
+}
+
+internal bool rt_cpu_wants_aovs(const RT_CastAOVs* aovs) {
+    return aovs->albedo != NULL || aovs->normal != NULL || aovs->depth != NULL || aovs->variance != NULL;
+}
+
+// @note sums into the aovs, rt_cpu_raygen clears them beforehand
+internal void rt_cpu_aovs_add(const RT_CastAOVs* aovs, u64 pixel, const RT_CPU_FirstHit* first_hit, vec3_f32 radiance) {
+    if (aovs->albedo) {
+        aovs->albedo[pixel] = add_3f32(aovs->albedo[pixel], first_hit->albedo);
+    }
+    if (aovs->normal) {
+        aovs->normal[pixel] = add_3f32(aovs->normal[pixel], first_hit->normal);
+    }
+    if (aovs->depth) {
+        aovs->depth[pixel] += first_hit->depth;
+    }
+    if (aovs->variance) {
+        f32 luminance = rt_cpu_luminance(radiance);
+        aovs->variance[pixel] += luminance*luminance;
+    }
+}
+
+internal void rt_cpu_aovs_resolve(const RT_CastAOVs* aovs, u64 pixel, u32 sample_count, vec3_f32 mean) {
+    f32 inv_sample_count = 1.f/(f32)Max(sample_count, 1u);
+    if (aovs->albedo) {
+        aovs->albedo[pixel] = mul_3f32(aovs->albedo[pixel], inv_sample_count);
+    }
+    if (aovs->normal) {
+        aovs->normal[pixel] = mul_3f32(aovs->normal[pixel], inv_sample_count);
+    }
+    if (aovs->depth) {
+        aovs->depth[pixel] *= inv_sample_count;
+    }
+    if (aovs->variance) {
+        // sample variance over the count, the variance of the mean
+        f32 luminance = rt_cpu_luminance(mean);
+        f32 m2 = Max(aovs->variance[pixel] - (f32)sample_count*luminance*luminance, 0.f);
+        aovs->variance[pixel] = (sample_count > 1) ? m2/((f32)(sample_count - 1)*sample_count) : 0.f;
+    }
+}
+
+internal void rt_cpu_pixel_estimate_add(RT_CPU_PixelEstimate* inout_estimate, vec3_f32 radiance) {
+    inout_estimate->count++;
+    f32 inv_count = 1.f/(f32)inout_estimate->count;
+
+    inout_estimate->mean = add_3f32(inout_estimate->mean, mul_3f32(sub_3f32(radiance, inout_estimate->mean), inv_count));
+
+    f32 luminance = rt_cpu_luminance(radiance);
+    f32 delta = luminance - inout_estimate->luminance_mean;
+    inout_estimate->luminance_mean += delta*inv_count;
+    inout_estimate->luminance_m2 += delta*(luminance - inout_estimate->luminance_mean);
+}
+
+// standard error of the mean relative to the pixel's brightness
+internal f32 rt_cpu_pixel_estimate_error(const RT_CPU_PixelEstimate* estimate) {
+    if (estimate->count < 2) {
+        return MAX_F32;
+    }
+
+    f32 variance = estimate->luminance_m2/(f32)(estimate->count - 1);
+    f32 standard_error = sqrt_f32(variance/(f32)estimate->count);
+    return standard_error/Max(estimate->luminance_mean, RT_CPU_ADAPTIVE_MIN_LUMINANCE);
+}
+
+// adds samples to a pixel, continuing its sequence where the last call left off
+internal void rt_cpu_sample_pixel(RT_CPU_Tracer* tracer, const RT_CastSettings* s, const RT_CPU_Target* target, const RT_CastAOVs* aovs, int x, int y, u32 samples, RT_CPU_PixelEstimate* inout_estimate) {
+    for EachIndexU32(sample, samples) {
+        RT_CPU_TraceContext ctx = zero_struct;
+        ctx.sampler = rt_cpu_make_sampler(s->sampler, s->seed, s->samples, x, y, inout_estimate->count);
+        ctx.ior[0] = s->ior;
+        rng3_f32 ray = rt_cpu_primary_ray(s, &ctx.sampler, x, y, target->width, target->height);
+        vec3_f32 radiance = rt_cpu_trace_path(tracer, &ctx, &ray, NULL);
+        rt_cpu_pixel_estimate_add(inout_estimate, radiance);
+        rt_cpu_aovs_add(aovs, rt_cpu_target_index(target, x, y), &ctx.first_hit, radiance);
+    }
+}
+
+// @note the arena keeps its pages, sessions of the same size don't allocate
+internal void rt_cpu_accumulation_reset(RT_CPU_Tracer* tracer, const RT_CastSettings* settings, int width, int height) {
+    RT_CPU_Accumulation* acc = &tracer->accumulation;
+
+    rt_cpu_checkpoint_wait(tracer);
+    arena_clear(tracer->accumulation_arena);
+    MemoryZeroStruct(acc);
+    acc->settings = *settings;
+    acc->last_checkpoint = os_now_seconds();
+
+    // @note the session's own buffers only cover what is traced
+    RT_CastSettings crop = *settings;
+    crop.crop_buffer = true;
+    acc->target = rt_cpu_make_target(&crop, width, height);
+
+    RT_PixelRect rect = acc->target.rect;
+    u64 pixel_count = (u64)(rect.x1 - rect.x0)*(rect.y1 - rect.y0);
+    acc->estimates = push_array(tracer->accumulation_arena, RT_CPU_PixelEstimate, pixel_count);
+    if (settings->aovs.albedo) {
+        acc->aov_sums.albedo = push_array(tracer->accumulation_arena, vec3_f32, pixel_count);
+    }
+    if (settings->aovs.normal) {
+        acc->aov_sums.normal = push_array(tracer->accumulation_arena, vec3_f32, pixel_count);
+    }
+    if (settings->aovs.depth) {
+        acc->aov_sums.depth = push_array(tracer->accumulation_arena, f32, pixel_count);
+    }
+}
+
+internal void rt_cpu_accumulate_rows(void* data, u64 begin, u64 end) {
+    RT_CPU_AccumulatePass* pass = (RT_CPU_AccumulatePass*)data;
+    RT_CPU_Accumulation* acc = &pass->tracer->accumulation;
+
+    const RT_PixelRect* rect = &acc->target.rect;
+    for (int y = rect->y0 + (int)begin; y < rect->y0 + (int)end; y++) {
+        for (int x = rect->x0; x < rect->x1; x++) {
+            u64 idx = rt_cpu_target_index(&acc->target, x, y);
+            rt_cpu_sample_pixel(pass->tracer, &acc->settings, &acc->target, &acc->aov_sums, x, y, pass->samples, &acc->estimates[idx]);
+        }
+    }
+}
+
+typedef struct RT_CPU_PixelError RT_CPU_PixelError;
+struct RT_CPU_PixelError {
+    f32 error;
+    u32 pixel;
+};
+
+RSFORCEINLINE int rt_cpu_pixel_error_is_before(void* elementa, void* elementb) {
+    return ((RT_CPU_PixelError*)elementa)->error > ((RT_CPU_PixelError*)elementb)->error;
+}
+
+typedef struct RT_CPU_AdaptivePass RT_CPU_AdaptivePass;
+struct RT_CPU_AdaptivePass {
+    RT_CPU_Tracer* tracer;
+    const RT_CastSettings* settings;
+    const RT_CPU_Target* target;
+    RT_CPU_PixelEstimate* estimates;
+    const RT_CPU_PixelError* active;
+    u32 samples;
+};
+
+// @note every pixel owns its estimate, so rows and pixels need no locking
+static void rt_cpu_adaptive_base_rows(void* data, u64 begin, u64 end) {
+    RT_CPU_AdaptivePass* pass = (RT_CPU_AdaptivePass*)data;
+    const RT_PixelRect* rect = &pass->target->rect;
+    int width = rect->x1 - rect->x0;
+    for (int y = (int)begin; y < (int)end; y++) {
+        for (int x = 0; x < width; x++) {
+            rt_cpu_sample_pixel(pass->tracer, pass->settings, pass->target, &pass->settings->aovs, rect->x0 + x, rect->y0 + y, pass->samples, &pass->estimates[y*width + x]);
+        }
+    }
+}
+
+static void rt_cpu_adaptive_round(void* data, u64 begin, u64 end) {
+    RT_CPU_AdaptivePass* pass = (RT_CPU_AdaptivePass*)data;
+    const RT_PixelRect* rect = &pass->target->rect;
+    int width = rect->x1 - rect->x0;
+    for (u64 idx = begin; idx < end; idx++) {
+        u32 pixel = pass->active[idx].pixel;
+        rt_cpu_sample_pixel(pass->tracer, pass->settings, pass->target, &pass->settings->aovs, rect->x0 + (int)(pixel % width), rect->y0 + (int)(pixel / width), pass->samples, &pass->estimates[pixel]);
+    }
+}
+
+internal void rt_cpu_raygen_adaptive(RT_CPU_Tracer* tracer, const RT_CastSettings* settings, vec3_f32* out_radiance, const RT_CPU_Target* target) {
+    // @note passes need jitter for the variance to mean anything
+    RT_CastSettings s = *settings;
+    s.samples = Max(s.samples, RT_CPU_ADAPTIVE_MIN_SAMPLES);
+
+    // @note estimates are kept for the traced rect only, x and y are relative to it
+    int x0 = target->rect.x0, y0 = target->rect.y0;
+    int width = target->rect.x1 - x0;
+    int height = target->rect.y1 - y0;
+
+    u64 pixel_count = (u64)width*height;
+    u64 pass_samples = (u64)s.samples*s.samples;
+    u64 budget = Max((u64)s.adaptive_budget*pixel_count, pass_samples*pixel_count);
+    u64 spent = 0;
+
+    {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
+        RT_CPU_PixelEstimate* estimates = push_array(scratch.arena, RT_CPU_PixelEstimate, pixel_count);
+        RT_CPU_PixelError* active = push_array_no_zero(scratch.arena, RT_CPU_PixelError, pixel_count);
+        f32* errors = push_array_no_zero(scratch.arena, f32, pixel_count);
+
+        // base pass, then rounds over the pixels that haven't converged yet.
+        // the error and neighbour gathering between them is cheap and serial
+        RT_CPU_AdaptivePass pass = {
+            .tracer = tracer,
+            .settings = &s,
+            .target = target,
+            .estimates = estimates,
+            .active = active,
+            .samples = (u32)pass_samples,
+        };
+        job_parallel_for((u64)height, RT_CPU_ACCUMULATE_ROW_GRAIN, rt_cpu_adaptive_base_rows, &pass);
+        spent += pass_samples*pixel_count;
+
+        for (;;) {
+            for EachIndex(idx, pixel_count) {
+                errors[idx] = rt_cpu_pixel_estimate_error(&estimates[idx]);
+            }
+
+            // @note a few samples easily miss rare bright paths, a pixel is only
+            // done once its neighbours agree
+            u64 active_count = 0;
+            for (int y = 0; y < height; y++) {
+                for (int x = 0; x < width; x++) {
+                    f32 error = 0.f;
+                    for (int ny = Max(y - 1, 0); ny <= Min(y + 1, height - 1); ny++) {
+                        for (int nx = Max(x - 1, 0); nx <= Min(x + 1, width - 1); nx++) {
+                            error = Max(error, errors[ny*width + nx]);
+                        }
+                    }
+                    if (error > s.adaptive_error) {
+                        active[active_count++] = (RT_CPU_PixelError){.error = errors[y*width + x], .pixel = (u32)(y*width + x)};
+                    }
+                }
+            }
+
+            u64 affordable = (budget - spent)/pass_samples;
+            if (active_count == 0 || affordable == 0) {
+                break;
+            }
+
+            // out of budget, the noisiest pixels go first
+            if (affordable < active_count) {
+                radsort(active, active_count, rt_cpu_pixel_error_is_before);
+                active_count = affordable;
+            }
+
+            job_parallel_for(active_count, RT_CPU_ADAPTIVE_PIXEL_GRAIN, rt_cpu_adaptive_round, &pass);
+            spent += active_count*pass_samples;
+        }
+
+        for EachIndex(idx, pixel_count) {
+            u64 out = rt_cpu_target_index(target, x0 + (int)(idx % width), y0 + (int)(idx / width));
+            out_radiance[out] = estimates[idx].mean;
+            if (s.aovs.sample_count) {
+                s.aovs.sample_count[out] = estimates[idx].count;
+            }
+            rt_cpu_aovs_resolve(&s.aovs, out, estimates[idx].count, estimates[idx].mean);
+        }
+    }}
+}
+
+// ============================================================================
+// checkpoints
+// ============================================================================
+static u32 rt_cpu_checkpoint_hash_f32(u32 hash, f32 v) {
+    union { f32 f; u32 u; } bits;
+    bits.f = v;
+    return rt_cpu_hash_combine_u32(hash, bits.u);
+}
+static u32 rt_cpu_checkpoint_hash_3f32(u32 hash, vec3_f32 v) {
+    for EachElement(i, v.v) {
+        hash = rt_cpu_checkpoint_hash_f32(hash, v.v[i]);
+    }
+    return hash;
+}
+
+internal u32 rt_cpu_checkpoint_hash(const RT_CPU_Tracer* tracer, const RT_CastSettings* s) {
+    u32 hash = rt_cpu_hash_u32(RT_CPU_CHECKPOINT_VERSION);
+    hash = rt_cpu_checkpoint_hash_3f32(hash, s->eye);
+    hash = rt_cpu_checkpoint_hash_3f32(hash, s->up);
+    hash = rt_cpu_checkpoint_hash_3f32(hash, s->forward);
+    hash = rt_cpu_checkpoint_hash_3f32(hash, s->right);
+    hash = rt_cpu_checkpoint_hash_3f32(hash, s->viewport);
+    hash = rt_cpu_hash_combine_u32(hash, s->samples);
+    hash = rt_cpu_hash_combine_u32(hash, (u32)s->sampler);
+    hash = rt_cpu_hash_combine_u32(hash, s->seed);
+    hash = rt_cpu_checkpoint_hash_f32(hash, s->ior);
+    hash = rt_cpu_hash_combine_u32(hash, s->defocus);
+    hash = rt_cpu_checkpoint_hash_f32(hash, s->defocus_disk.x);
+    hash = rt_cpu_checkpoint_hash_f32(hash, s->defocus_disk.y);
+    hash = rt_cpu_hash_combine_u32(hash, s->orthographic);
+    hash = rt_cpu_hash_combine_u32(hash, s->crop);
+    hash = rt_cpu_hash_combine_u32(hash, (u32)s->crop_window.x0);
+    hash = rt_cpu_hash_combine_u32(hash, (u32)s->crop_window.y0);
+    hash = rt_cpu_hash_combine_u32(hash, (u32)s->crop_window.x1);
+    hash = rt_cpu_hash_combine_u32(hash, (u32)s->crop_window.y1);
+
+    hash = rt_cpu_hash_combine_u32(hash, tracer->max_bounces);
+    hash = rt_cpu_hash_combine_u32(hash, (u32)tracer->winding_order);
+    hash = rt_cpu_hash_combine_u32(hash, tracer->sky);
+    hash = rt_cpu_hash_combine_u32(hash, tracer->russian_roulette);
+    hash = rt_cpu_hash_combine_u32(hash, tracer->next_event_estimation);
+    hash = rt_cpu_hash_combine_u32(hash, (u32)tracer->light_sampling);
+    return hash;
+}
+
+internal u32 rt_cpu_checkpoint_aovs(const RT_CastAOVs* aov_sums) {
+    u32 aovs = RT_CPU_CheckpointAOVs_ZERO;
+    if (aov_sums->albedo) {
+        aovs |= RT_CPU_CheckpointAOVs_Albedo;
+    }
+    if (aov_sums->normal) {
+        aovs |= RT_CPU_CheckpointAOVs_Normal;
+    }
+    if (aov_sums->depth) {
+        aovs |= RT_CPU_CheckpointAOVs_Depth;
+    }
+    return aovs;
+}
+
+// copies the session and hands the copy to a writer thread, only waits when
+// the last write is still going
+internal void rt_cpu_checkpoint_begin(RT_CPU_Tracer* tracer) {
+    RT_CPU_Accumulation* acc = &tracer->accumulation;
+    rt_cpu_checkpoint_wait(tracer);
+
+    RT_PixelRect rect = acc->target.rect;
+    u64 pixel_count = (u64)(rect.x1 - rect.x0)*(rect.y1 - rect.y0);
+    RT_CPU_Checkpoint* checkpoint = acc->checkpoint;
+    if (checkpoint == NULL) {
+        checkpoint = push_array(tracer->accumulation_arena, RT_CPU_Checkpoint, 1);
+        checkpoint->estimates = push_array_no_zero(tracer->accumulation_arena, RT_CPU_PixelEstimate, pixel_count);
+        if (acc->aov_sums.albedo) {
+            checkpoint->aov_sums.albedo = push_array_no_zero(tracer->accumulation_arena, vec3_f32, pixel_count);
+        }
+        if (acc->aov_sums.normal) {
+            checkpoint->aov_sums.normal = push_array_no_zero(tracer->accumulation_arena, vec3_f32, pixel_count);
+        }
+        if (acc->aov_sums.depth) {
+            checkpoint->aov_sums.depth = push_array_no_zero(tracer->accumulation_arena, f32, pixel_count);
+        }
+        acc->checkpoint = checkpoint;
+    }
+
+    checkpoint->header = (RT_CPU_CheckpointHeader){
+        .magic = RT_CPU_CHECKPOINT_MAGIC,
+        .version = RT_CPU_CHECKPOINT_VERSION,
+        .settings_hash = rt_cpu_checkpoint_hash(tracer, &acc->settings),
+        .width = (u32)acc->target.width,
+        .height = (u32)acc->target.height,
+        .sample_count = acc->sample_count,
+        .aovs = rt_cpu_checkpoint_aovs(&acc->aov_sums),
+    };
+    memcpy(checkpoint->estimates, acc->estimates, sizeof(RT_CPU_PixelEstimate)*pixel_count);
+    if (acc->aov_sums.albedo) {
+        memcpy(checkpoint->aov_sums.albedo, acc->aov_sums.albedo, sizeof(vec3_f32)*pixel_count);
+    }
+    if (acc->aov_sums.normal) {
+        memcpy(checkpoint->aov_sums.normal, acc->aov_sums.normal, sizeof(vec3_f32)*pixel_count);
+    }
+    if (acc->aov_sums.depth) {
+        memcpy(checkpoint->aov_sums.depth, acc->aov_sums.depth, sizeof(f32)*pixel_count);
+    }
+    checkpoint->pixel_count = pixel_count;
+    checkpoint->path = tracer->checkpoint_path;
+    checkpoint->temp_path = tracer->checkpoint_temp_path;
+
+    checkpoint->thread = os_thread_launch(rt_cpu_checkpoint_write, checkpoint);
+    if (os_is_handle_zero(checkpoint->thread)) {
+        rt_cpu_checkpoint_write(checkpoint);
+    }
+    acc->last_checkpoint = os_now_seconds();
+}
+
+internal void rt_cpu_checkpoint_wait(RT_CPU_Tracer* tracer) {
+    RT_CPU_Checkpoint* checkpoint = tracer->accumulation.checkpoint;
+    if (checkpoint != NULL && !os_is_handle_zero(checkpoint->thread)) {
+        os_thread_join(checkpoint->thread);
+        checkpoint->thread = os_zero_handle();
+    }
+}
+
+// @note runs on its own thread, the file at path is only replaced by a
+// complete one so an interrupted write leaves the last checkpoint intact
+internal void rt_cpu_checkpoint_write(void* data) {
+    RT_CPU_Checkpoint* checkpoint = (RT_CPU_Checkpoint*)data;
+    u64 pixel_count = checkpoint->pixel_count;
+
+    OS_Handle file = os_open_writeonly_file(checkpoint->temp_path);
+    if (os_is_handle_zero(file)) {
+        return; // @todo logging
+    }
+
+    bool ok = os_write_file(file, &checkpoint->header, sizeof(checkpoint->header)) == sizeof(checkpoint->header);
+    ok = ok && os_write_file(file, checkpoint->estimates, sizeof(RT_CPU_PixelEstimate)*pixel_count) == sizeof(RT_CPU_PixelEstimate)*pixel_count;
+    if (checkpoint->aov_sums.albedo) {
+        ok = ok && os_write_file(file, checkpoint->aov_sums.albedo, sizeof(vec3_f32)*pixel_count) == sizeof(vec3_f32)*pixel_count;
+    }
+    if (checkpoint->aov_sums.normal) {
+        ok = ok && os_write_file(file, checkpoint->aov_sums.normal, sizeof(vec3_f32)*pixel_count) == sizeof(vec3_f32)*pixel_count;
+    }
+    if (checkpoint->aov_sums.depth) {
+        ok = ok && os_write_file(file, checkpoint->aov_sums.depth, sizeof(f32)*pixel_count) == sizeof(f32)*pixel_count;
+    }
+    os_close_file(file);
+
+    ok = ok && os_rename_file(checkpoint->temp_path, checkpoint->path);
+    if (!ok) {
+        os_delete_file(checkpoint->temp_path);
+    }
+}
+
+// reads the sum of an aov the file has, skipping it when the session has no use for it
+static bool rt_cpu_checkpoint_read_sum(OS_FileReader* reader, void* out_sum, u64 size, bool in_file) {
+    if (!in_file) {
+        return true;
+    }
+    if (out_sum == NULL) {
+        os_file_reader_skip(reader, size);
+        return true;
+    }
+    return os_file_reader_read(reader, out_sum, size) == size;
+}
+
+// @note expects a fresh session with the settings to resume
+internal bool rt_cpu_checkpoint_read(RT_CPU_Tracer* tracer, NTString8 path) {
+    RT_CPU_Accumulation* acc = &tracer->accumulation;
+    RT_PixelRect rect = acc->target.rect;
+    u64 pixel_count = (u64)(rect.x1 - rect.x0)*(rect.y1 - rect.y0);
+
+    OS_Handle file = os_open_readonly_file(path);
+    if (os_is_handle_zero(file)) {
+        return false;
+    }
+
+    // @note a truncated file is turned down before reading megabytes of it,
+    // the reader reads the next block in the background while one is used
+    RT_CPU_CheckpointHeader header;
+    u32 aovs = rt_cpu_checkpoint_aovs(&acc->aov_sums);
+    bool ok = os_file_size(file) >= sizeof(header) + sizeof(RT_CPU_PixelEstimate)*pixel_count;
+    {DeferResource(Temp scratch = scratch_begin(NULL, 0), scratch_end(scratch)) {
+        OS_FileReader reader = os_file_reader_begin(scratch.arena, file, OS_FILE_READER_DEFAULT_BLOCK_SIZE);
+        ok = ok && os_file_reader_read(&reader, &header, sizeof(header)) == sizeof(header)
+            && header.magic == RT_CPU_CHECKPOINT_MAGIC
+            && header.version == RT_CPU_CHECKPOINT_VERSION
+            && header.settings_hash == rt_cpu_checkpoint_hash(tracer, &acc->settings)
+            && header.width == (u32)acc->target.width
+            && header.height == (u32)acc->target.height
+            && (header.aovs & aovs) == aovs;
+        ok = ok && os_file_reader_read(&reader, acc->estimates, sizeof(RT_CPU_PixelEstimate)*pixel_count) == sizeof(RT_CPU_PixelEstimate)*pixel_count;
+
+        ok = ok && rt_cpu_checkpoint_read_sum(&reader, acc->aov_sums.albedo, sizeof(vec3_f32)*pixel_count, header.aovs & RT_CPU_CheckpointAOVs_Albedo);
+        ok = ok && rt_cpu_checkpoint_read_sum(&reader, acc->aov_sums.normal, sizeof(vec3_f32)*pixel_count, header.aovs & RT_CPU_CheckpointAOVs_Normal);
+        ok = ok && rt_cpu_checkpoint_read_sum(&reader, acc->aov_sums.depth, sizeof(f32)*pixel_count, header.aovs & RT_CPU_CheckpointAOVs_Depth);
+    }}
+    os_close_file(file);
+
+    if (ok) {
+        acc->sample_count = header.sample_count;
+    }
+    return ok;
+}
+
+internal vec3_f32 rt_cpu_trace_path(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const rng3_f32* in_ray, const RT_CPU_PrimaryHit* in_primary) {
+    vec3_f32 radiance = make_scale_3f32(0.f);
+    vec3_f32 throughput = make_scale_3f32(1.f);
+    rng3_f32 ray = *in_ray;
+
+    // brdf pdf and shading point of the last bounce, used to weight emission
+    // against light sampling
+    bool mis = false;
+    f32 mis_pdf = 0.f;
+    vec3_f32 mis_p = zero_struct;
+    vec3_f32 mis_n = zero_struct;
+
+    for (u8 bounce = 0; bounce < tracer->max_bounces; bounce++) {
+        Assert(abs_f32(length2_3f32(ray.direction) - 1) < 0.001f);
+        ctx->sampler.bounce = bounce;
+        ctx->ray_count++;
+
+        RT_CPU_HitRecord record;
+        bool hit;
+        if (bounce == 0 && in_primary != NULL) {
+            hit = in_primary->hit;
+            record = in_primary->record;
+        } else {
+            hit = rt_cpu_intersect(tracer, &ray, geo_make_pos_interval(), &record);
+        }
+
+        if (!hit) {
+            if (bounce == 0) {
+                ctx->first_hit = (RT_CPU_FirstHit){.albedo = make_scale_3f32(1.f)};
+            }
+            radiance = add_3f32(radiance, elmul_3f32(throughput, rt_cpu_miss(tracer, ctx, &ray)));
+            break;
+        }
+
+        RT_CPU_ScatterRecord scatter;
+        bool scattered = rt_cpu_closest_hit(tracer, ctx, &ray, &record, &scatter);
+        if (bounce == 0) {
+            // @note attenuation is the albedo of diffuse surfaces and 1 otherwise
+            ctx->first_hit = (RT_CPU_FirstHit){.albedo = scatter.attenuation, .normal = record.n, .depth = record.t};
+        }
+
+        f32 emitted_weight = 1.f;
+        const RT_CPU_Light* light = NULL;
+        if (mis && (light = rt_cpu_hit_to_light(&tracer->tlas.lights, &record)) != NULL) {
+            vec3_f32 light_n = (light->type == RT_CPU_LightType_Tri) ? light->tri.n : record.n;
+            // @note lights were sampled from the hit point, not the offset origin
+            f32 light_pmf = rt_cpu_light_pmf(tracer, mis_p, mis_n, light);
+            f32 light_pdf = rt_cpu_light_pdf(light, light_pmf, mis_p, record.p, light_n);
+            emitted_weight = (mis_pdf*mis_pdf)/(mis_pdf*mis_pdf + light_pdf*light_pdf);
+        }
+        radiance = add_3f32(radiance, elmul_3f32(throughput, add_3f32(mul_3f32(scatter.emitted, emitted_weight), scatter.direct)));
+        if (!scattered) {
+            break;
+        }
+        throughput = elmul_3f32(throughput, scatter.attenuation);
+        mis = scatter.mis;
+        mis_pdf = scatter.pdf;
+        mis_p = record.p;
+        mis_n = record.n;
+
+        // terminate with probability inversely related to the throughput and
+        // scale the survivors so the estimate stays unbiased
+        if (tracer->russian_roulette && bounce + 1 >= RT_CPU_ROULETTE_MIN_BOUNCES) {
+            f32 survive = Max(Max(throughput.r, throughput.g), throughput.b);
+            survive = Clamp(survive, 0.f, 1.f - RT_CPU_ROULETTE_MIN_TERMINATION);
+            if (rt_cpu_sampler_1d(&ctx->sampler, RT_CPU_SampleDimension_Roulette) >= survive) {
+                break;
+            }
+            throughput = mul_3f32(throughput, 1.f/survive);
+        }
+
+        ray = scatter.ray;
+    }
+
+    return radiance;
+}
+
+#define RT_CPU_SURFACE_OFFSET 0.001f
+
+internal bool rt_cpu_closest_hit(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const rng3_f32* in_ray, RT_CPU_HitRecord* in_record, RT_CPU_ScatterRecord* out_scatter) {
+#if BUILD_DEBUG
+    rt_cpu_dump_add_ray_hit_record(in_ray, in_record, "out.rays");
+#endif
+
+    out_scatter->emitted = make_scale_3f32(0.f);
+    out_scatter->direct = make_scale_3f32(0.f);
+    out_scatter->attenuation = make_scale_3f32(1.f);
+    out_scatter->pdf = 0.f;
+    out_scatter->mis = false;
+
+    if (rt_is_zero_handle(in_record->material)) {
+        out_scatter->emitted = make_scale_3f32(1.f);
+        return false;
+    }
+
+    RT_Material* mat = &((RT_MaterialNode*)in_record->material.v64[0])->v;
+
+    if (mat->billboard && dot_3f32(in_record->n, in_ray->direction) > 0.f) {
+        in_record->n = mul_3f32(in_record->n, -1.f);
+    }
+
+    switch (mat->type) {
+        case RT_MaterialType_Lambertian:{
+            out_scatter->ray = (rng3_f32){
+                .origin = add_3f32(in_record->p, mul_3f32(in_record->n, RT_CPU_SURFACE_OFFSET)),
+                .direction = rt_cpu_cosine_sample_hemisphere(in_record->n, rt_cpu_sampler_2d(&ctx->sampler, RT_CPU_SampleDimension_BSDF)),
+            };
+
+            // drop extra terms since pdf = cos_theta / PI
+            vec3_f32 brdf_times_pi = mat->albedo;
+            out_scatter->attenuation = brdf_times_pi; // * (cos_theta / PI) / pdf
+            out_scatter->emitted = mat->emissive;
+
+            if (tracer->next_event_estimation && tracer->tlas.lights.count > 0) {
+                out_scatter->direct = rt_cpu_sample_direct(tracer, ctx, in_record, mul_3f32(brdf_times_pi, 1.f/PI_F32));
+                out_scatter->pdf = Max(dot_3f32(in_record->n, out_scatter->ray.direction), 0.f)/PI_F32;
+                out_scatter->mis = true;
+            }
+            return true;
+        }break;
+        case RT_MaterialType_Dieletric:{
+            Assert(!mat->billboard);
+
+            f32 idotn = -dot_3f32(in_record->n, in_ray->direction);
+            bool backface = idotn < 0.f;
+            vec3_f32 n_corr = mul_3f32(in_record->n, backface ? -1.f : 1.f);
+
+            f32 eta_i = ctx->ior[ctx->ior_count];
+            f32 eta_t = backface ? mat->ior : ctx->ior[Max(ctx->ior_count-1, 0)];
+            f32 eta = eta_i / eta_t;
+            bool tir = sqrt_f32(1-idotn*idotn)*eta > 1.f;
+            bool reflect = tir || rt_cpu_fresnel_schlick(eta_i, eta_t, abs_f32(idotn)) > rt_cpu_sampler_1d(&ctx->sampler, RT_CPU_SampleDimension_BSDFChoice);
+
+            if (reflect) {
+                out_scatter->ray = (rng3_f32){
+                    .origin=add_3f32(in_record->p, mul_3f32(n_corr, RT_CPU_SURFACE_OFFSET)),
+                    .direction = reflect_3f32(in_ray->direction, n_corr),
+                };
+            } else {
+                out_scatter->ray = (rng3_f32){
+                    .origin=add_3f32(in_record->p, mul_3f32(n_corr, -RT_CPU_SURFACE_OFFSET)),
+                    .direction = refract_3f32(in_ray->direction, n_corr, eta),
+                };
+
+                // @note the recursive tracer popped this once the refracted
+                // subpath returned, so along a single path it is never popped
+                Assert(ctx->ior_count + 1 < ArrayLength(ctx->ior));
+                ctx->ior_count++;
+                ctx->ior[ctx->ior_count] = eta_t;
+            }
+
+            out_scatter->emitted = mat->emissive;
+            return true;
+        }break;
+        case RT_MaterialType_Metal:{
+            vec3_f32 i = reflect_3f32(in_ray->direction, in_record->n);
+            // approximation of specular lobe, offset uniformly inside a sphere
+            vec3_f32 offset = rt_cpu_square_to_sphere(rt_cpu_sampler_2d(&ctx->sampler, RT_CPU_SampleDimension_BSDF));
+            f32 radius = cbrt_f32(rt_cpu_sampler_1d(&ctx->sampler, RT_CPU_SampleDimension_BSDFChoice));
+            i = add_3f32(i, mul_3f32(offset, radius*mat->roughness));
+
+            out_scatter->ray = (rng3_f32){
+                .origin=add_3f32(in_record->p, mul_3f32(in_record->n, RT_CPU_SURFACE_OFFSET)),
+                .direction=normalize_3f32(i),
+            };
+            return true;
+        }break;
+        case RT_MaterialType_Normal:{
+            out_scatter->emitted = rt_cpu_normal_to_radiance(in_record->n);
+            return false;
+        }break;
+        case RT_MaterialType_Light:{
+            out_scatter->emitted = mat->emissive;
+            return false;
+        }break;
+    }
+
+    NotImplemented;
+    return false;
+}
+
+internal vec3_f32 rt_cpu_miss(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const rng3_f32* in_ray) {
+#if BUILD_DEBUG
+    rt_cpu_dump_add_ray_miss_record(in_ray, "out.rays");
+#endif
+
+    if (!tracer->sky) {
+        return make_scale_3f32(0.f);
+    }
+
+    f32 y = Clamp(in_ray->direction.y, 0.f, 1.f);
+    f32 t = pow_f32(y, 0.5f);
 
     vec3_f32 sky = lerp_3f32(make_3f32(1.f, 1.f, 1.f), make_3f32(0.5f, 0.7f, 1.f), t);
 
@@ -370,6 +1722,258 @@ internal vec3_f32 rt_cpu_miss(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, c
     return sky;
 }
 
+// ============================================================================
+// lights
+// ============================================================================
+// cos(max(0, a - b)) and sin(max(0, a - b)) from the sines and cosines of a and b
+static f32 rt_cpu_cos_sub_clamped(f32 sin_a, f32 cos_a, f32 sin_b, f32 cos_b) {
+    return (cos_a > cos_b) ? 1.f : cos_a*cos_b + sin_a*sin_b;
+}
+
+static f32 rt_cpu_sin_sub_clamped(f32 sin_a, f32 cos_a, f32 sin_b, f32 cos_b) {
+    return (cos_a > cos_b) ? 0.f : sin_a*cos_b - cos_a*sin_b;
+}
+
+// importance of the lights below node for a receiver at p with normal n,
+// conservative over the node bounds, see pbrt-v4 LightBounds::Importance
+// @perf kept in sines and cosines, this runs twice per level per light sample
+internal f32 rt_cpu_light_tree_importance(const RT_CPU_LightTreeNode* node, vec3_f32 p, vec3_f32 n) {
+    vec3_f32 pc = mul_3f32(add_3f32(node->aabb.min, node->aabb.max), 0.5f);
+    f32 radius = 0.5f*length_3f32(sub_3f32(node->aabb.max, node->aabb.min));
+    vec3_f32 d = sub_3f32(p, pc);
+    f32 d2 = length2_3f32(d);
+    if (d2 == 0.f) {
+        return node->power;
+    }
+    vec3_f32 wi = mul_3f32(d, 1.f/sqrt_f32(d2));
+
+    // cone of directions subtended by the bounds, everything from inside
+    f32 cos_b = -1.f;
+    f32 sin_b = 0.f;
+    if (d2 > radius*radius) {
+        f32 sin2_b = radius*radius/d2;
+        cos_b = sqrt_f32(1.f - sin2_b);
+        sin_b = sqrt_f32(sin2_b);
+    }
+
+    // clamp so points close to or inside the bounds don't blow up
+    f32 dist2 = Max(d2, radius);
+
+    // emitters are two-sided so only the angle to the axis line matters
+    f32 cos_w = abs_f32(dot_3f32(node->axis, wi));
+    f32 sin_w = sqrt_f32(Max(0.f, 1.f - cos_w*cos_w));
+    f32 cos_o = node->cos_theta_o;
+    f32 sin_o = sqrt_f32(Max(0.f, 1.f - cos_o*cos_o));
+
+    f32 cos_x = rt_cpu_cos_sub_clamped(sin_w, cos_w, sin_o, cos_o);
+    f32 sin_x = rt_cpu_sin_sub_clamped(sin_w, cos_w, sin_o, cos_o);
+    f32 cos_p = rt_cpu_cos_sub_clamped(sin_x, cos_x, sin_b, cos_b);
+    if (cos_p <= 0.f) {
+        return 0.f;
+    }
+
+    f32 cos_i = -dot_3f32(n, wi);
+    f32 sin_i = sqrt_f32(Max(0.f, 1.f - cos_i*cos_i));
+    f32 cos_ip = rt_cpu_cos_sub_clamped(sin_i, cos_i, sin_b, cos_b);
+    if (cos_ip <= 0.f) {
+        return 0.f;
+    }
+
+    return node->power*cos_p*cos_ip/dist2;
+}
+
+static const RT_CPU_Light* rt_cpu_sample_light_tree(const RT_CPU_LightTable* lights, const RT_CPU_LightTree* tree, vec3_f32 p, vec3_f32 n, f32 u, f32* out_pmf) {
+    f32 pmf = 1.f;
+
+    const RT_CPU_LightTreeNode* node = &tree->nodes[RT_CPU_LIGHT_TREE_ROOT];
+    while (!node->leaf) {
+        const RT_CPU_LightTreeNode* l = &tree->nodes[node->children[0]];
+        const RT_CPU_LightTreeNode* r = &tree->nodes[node->children[1]];
+        f32 importance_l = rt_cpu_light_tree_importance(l, p, n);
+        f32 importance_r = rt_cpu_light_tree_importance(r, p, n);
+        if (importance_l + importance_r <= 0.f) {
+            return NULL;
+        }
+
+        // reuse u for the next level by rescaling it into the chosen range
+        f32 p_l = importance_l/(importance_l + importance_r);
+        if (u < p_l) {
+            u = Min(u/p_l, 1.f - EPSILON_F32);
+            pmf *= p_l;
+            node = l;
+        } else {
+            u = Min((u - p_l)/(1.f - p_l), 1.f - EPSILON_F32);
+            pmf *= 1.f - p_l;
+            node = r;
+        }
+    }
+
+    *out_pmf = pmf;
+    return &lights->lights[node->children[0]];
+}
+
+static const RT_CPU_Light* rt_cpu_sample_light_power(const RT_CPU_LightTable* lights, f32 u, f32* out_pmf) {
+    u *= lights->total_power;
+    u64 lo = 0, hi = lights->count - 1;
+    while (lo < hi) {
+        u64 mid = (lo + hi)/2;
+        if (lights->power_cdf[mid] <= u) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    const RT_CPU_Light* light = &lights->lights[lo];
+    *out_pmf = light->power / lights->total_power;
+    return light;
+}
+
+internal bool rt_cpu_sample_light(RT_CPU_Tracer* tracer, vec3_f32 p, vec3_f32 n, f32 u_light, vec2_f32 u_point, RT_CPU_LightSample* out_sample) {
+    const RT_CPU_LightTable* lights = &tracer->tlas.lights;
+    if (lights->count == 0 || lights->total_power <= 0.f) {
+        return false;
+    }
+
+    f32 pmf = 0.f;
+    const RT_CPU_Light* light = NULL;
+    switch (tracer->light_sampling) {
+        case RT_LightSampling_Power:{
+            light = rt_cpu_sample_light_power(lights, u_light, &pmf);
+        }break;
+        case RT_LightSampling_Tree:{
+            light = rt_cpu_sample_light_tree(lights, &tracer->tlas.light_tree, p, n, u_light, &pmf);
+        }break;
+    }
+    if (light == NULL || pmf <= 0.f) {
+        return false;
+    }
+
+    f32 r1 = u_point.x;
+    f32 r2 = u_point.y;
+    switch (light->type) {
+        case RT_CPU_LightType_Tri:{
+            // uniform barycentrics
+            f32 sqrt_r1 = sqrt_f32(r1);
+            f32 b0 = 1.f - sqrt_r1;
+            f32 b1 = r2*sqrt_r1;
+            out_sample->p = add_3f32(add_3f32(
+                mul_3f32(light->tri.v0, b0),
+                mul_3f32(light->tri.v1, b1)),
+                mul_3f32(light->tri.v2, 1.f - b0 - b1)
+            );
+            out_sample->n = light->tri.n;
+        }break;
+        case RT_CPU_LightType_Sphere:{
+            // uniform over the area, far side samples are occluded by the sphere
+            out_sample->n = rt_cpu_square_to_sphere(u_point);
+            out_sample->p = add_3f32(light->sphere.center, mul_3f32(out_sample->n, light->sphere.radius));
+        }break;
+    }
+
+    out_sample->light = light;
+    out_sample->pmf = pmf;
+    return true;
+}
+
+// probability that rt_cpu_sample_light picks light from p, walks from the
+// light's leaf to the root for the tree so it is O(log lights)
+internal f32 rt_cpu_light_pmf(RT_CPU_Tracer* tracer, vec3_f32 p, vec3_f32 n, const RT_CPU_Light* light) {
+    const RT_CPU_LightTable* lights = &tracer->tlas.lights;
+
+    switch (tracer->light_sampling) {
+        case RT_LightSampling_Power:{
+            return light->power / lights->total_power;
+        }break;
+        case RT_LightSampling_Tree:{
+            const RT_CPU_LightTree* tree = &tracer->tlas.light_tree;
+            u32 node_idx = tree->light_nodes[light - lights->lights];
+
+            f32 pmf = 1.f;
+            while (node_idx != RT_CPU_LIGHT_TREE_ROOT) {
+                const RT_CPU_LightTreeNode* parent = &tree->nodes[tree->nodes[node_idx].parent];
+                f32 importance_l = rt_cpu_light_tree_importance(&tree->nodes[parent->children[0]], p, n);
+                f32 importance_r = rt_cpu_light_tree_importance(&tree->nodes[parent->children[1]], p, n);
+                if (importance_l + importance_r <= 0.f) {
+                    return 0.f;
+                }
+
+                f32 importance = (parent->children[0] == node_idx) ? importance_l : importance_r;
+                pmf *= importance/(importance_l + importance_r);
+                node_idx = tree->nodes[node_idx].parent;
+            }
+            return pmf;
+        }break;
+    }
+
+    NotImplemented;
+    return 0.f;
+}
+
+// solid angle pdf of sampling p on light as seen from
+internal f32 rt_cpu_light_pdf(const RT_CPU_Light* light, f32 pmf, vec3_f32 from, vec3_f32 p, vec3_f32 n) {
+    vec3_f32 d = sub_3f32(p, from);
+    f32 dist2 = length2_3f32(d);
+    f32 cos_l = abs_f32(dot_3f32(n, d))/sqrt_f32(dist2);
+    if (cos_l <= 0.f || light->area <= 0.f) {
+        return 0.f;
+    }
+    return pmf*dist2/(cos_l*light->area);
+}
+
+internal const RT_CPU_Light* rt_cpu_hit_to_light(const RT_CPU_LightTable* lights, const RT_CPU_HitRecord* in_record) {
+    const RT_CPU_TLASNode* tlas_node = in_record->tlas_node;
+    if (tlas_node == NULL || tlas_node->light_offset == RT_CPU_NO_LIGHT) {
+        return NULL;
+    }
+
+    u64 idx = tlas_node->light_offset;
+    if (tlas_node->instance->type == RT_InstanceType_Mesh) {
+        idx += in_record->tri_idx/3;
+    }
+    Assert(idx < lights->count);
+    return &lights->lights[idx];
+}
+
+// one light sample with a shadow ray, weighted with the power heuristic against
+// cosine sampling of the brdf
+internal vec3_f32 rt_cpu_sample_direct(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const RT_CPU_HitRecord* in_record, vec3_f32 brdf) {
+    f32 u_light = rt_cpu_sampler_1d(&ctx->sampler, RT_CPU_SampleDimension_LightChoice);
+    vec2_f32 u_point = rt_cpu_sampler_2d(&ctx->sampler, RT_CPU_SampleDimension_Light);
+
+    RT_CPU_LightSample sample;
+    if (!rt_cpu_sample_light(tracer, in_record->p, in_record->n, u_light, u_point, &sample)) {
+        return make_scale_3f32(0.f);
+    }
+
+    vec3_f32 origin = add_3f32(in_record->p, mul_3f32(in_record->n, RT_CPU_SURFACE_OFFSET));
+    vec3_f32 d = sub_3f32(sample.p, origin);
+    f32 dist = length_3f32(d);
+    if (dist <= RT_CPU_SURFACE_OFFSET) {
+        return make_scale_3f32(0.f);
+    }
+    vec3_f32 wi = mul_3f32(d, 1.f/dist);
+
+    f32 cos_s = dot_3f32(in_record->n, wi);
+    f32 light_pdf = rt_cpu_light_pdf(sample.light, sample.pmf, origin, sample.p, sample.n);
+    if (cos_s <= 0.f || light_pdf <= 0.f) {
+        return make_scale_3f32(0.f);
+    }
+
+    // @note stop short of the light so it doesn't occlude itself
+    rng3_f32 shadow_ray = {.origin = origin, .direction = wi};
+    rng_f32 interval = make_rng_f32(EPSILON_F32, dist - RT_CPU_SURFACE_OFFSET);
+    RT_CPU_HitRecord shadow_record;
+    ctx->ray_count++;
+    if (rt_cpu_intersect(tracer, &shadow_ray, interval, &shadow_record)) {
+        return make_scale_3f32(0.f);
+    }
+
+    f32 brdf_pdf = cos_s/PI_F32;
+    f32 weight = (light_pdf*light_pdf)/(light_pdf*light_pdf + brdf_pdf*brdf_pdf);
+    return mul_3f32(elmul_3f32(sample.light->emissive, brdf), cos_s*weight/light_pdf);
+}
+
 // ============================================================================
 // intersection
 // ============================================================================
@@ -399,6 +2003,52 @@ static void rt_cpu_get_tri(const RT_CPU_BLASNode* blas_node, GEO_VertexAttribute
     }
 }
 
+internal void rt_cpu_resolve_hit_record(RT_CPU_Tracer* tracer, const rng3_f32* in_ray, f32 t, const RT_CPU_TLASHitRecord* hit_record, RT_CPU_HitRecord* out_record) {
+    const RT_CPU_TLASNode* tlas_node = hit_record->tlas_node;
+    const RT_Instance* instance = tlas_node->instance;
+
+    out_record->t = t;
+    out_record->p = add_3f32(in_ray->origin, mul_3f32(in_ray->direction, out_record->t));
+    out_record->material = instance->material;
+    out_record->tlas_node = tlas_node;
+    out_record->tri_idx = hit_record->tri_idx;
+    
+    // @todo flag on material showing which attributes are necessary for shading?
+    switch (instance->type) {
+        case RT_InstanceType_Sphere:{
+            const RT_SphereInstance* sphere_inst = &instance->sphere;
+
+            out_record->n = mul_3f32(sub_3f32(out_record->p, sphere_inst->center), 1.f/sphere_inst->radius);
+        }break;
+        case RT_InstanceType_Mesh:{
+            const RT_MeshInstance* mesh_inst = &instance->mesh;
+            const RT_CPU_BLASNode* blas_node = tlas_node->blas_node;
+            const RT_Mesh* mesh = blas_node->mesh;
+
+            Assert(mesh->primitive == GEO_Primitive_TRI_LIST); // @todo
+
+            vec3_f32 v0,v1,v2;
+            rt_cpu_get_tri(blas_node, GEO_VertexAttributes_P, hit_record->tri_idx, &v0, &v1, &v2);
+
+            vec3_f32 tri_n;
+            if (mesh->attrs & GEO_VertexAttributes_N) {
+                vec3_f32 n0,n1,n2;
+                rt_cpu_get_tri(blas_node, GEO_VertexAttributes_N, hit_record->tri_idx, &n0, &n1, &n2);
+                tri_n = add_3f32(add_3f32(
+                    mul_3f32(n0, hit_record->uv.U),
+                    mul_3f32(n1, hit_record->uv.V)),
+                    mul_3f32(n2, 1 - hit_record->uv.U - hit_record->uv.V)
+                );
+            } else {
+                Assert(tracer->winding_order == GEO_WindingOrder_CCW);
+                tri_n = cross_3f32(sub_3f32(v1, v0), sub_3f32(v2, v0));
+            }
+
+            out_record->n = normalize_3f32(rt_cpu_transform_dir(tri_n, mesh_inst->rotation, mesh_inst->scale));
+        }
+    }
+}
+
 internal bool rt_cpu_intersect(RT_CPU_Tracer* tracer, const rng3_f32* in_ray, rng_f32 interval, RT_CPU_HitRecord* out_record) {
     RT_CPU_TLASData tlas_data = {
         .hit_record = {},
@@ -409,51 +2059,123 @@ internal bool rt_cpu_intersect(RT_CPU_Tracer* tracer, const rng3_f32* in_ray, rn
     // convert tlas hit record into hit record
     // (avoids costly calculations if multiple intersections occur)
     if (hit) {
-        RT_CPU_TLASHitRecord* hit_record = &tlas_data.hit_record;
-        const RT_CPU_TLASNode* tlas_node = hit_record->tlas_node;
+        rt_cpu_resolve_hit_record(tracer, in_ray, interval.max, &tlas_data.hit_record, out_record);
+    }
+
+    return hit;
+}
+
+static bool rt_cpu_blas_node_hit(u64 id, const rng3_f32* in_ray, rng_f32* inout_t_interval, void* _data);
+
+// advances a single traversal by one node, returns true once finished
+static bool rt_cpu_interleaved_ray_step(RT_CPU_Tracer* tracer, const rng3_f32* in_ray, RT_CPU_InterleavedRay* r) {
+    if (r->blas_tlas_node != NULL) {
+        u64 id = lbvh_query_ray_step(&r->blas_query, &r->local_ray, &r->interval);
+        if (id > 0 && rt_cpu_blas_node_hit(id, &r->local_ray, &r->interval, &r->blas_data)) {
+            r->hit = true;
+            r->hit_record.tlas_node = r->blas_tlas_node;
+            r->hit_record.tri_idx = r->blas_data.hit_record.tri_idx;
+            r->hit_record.uv = r->blas_data.hit_record.uv;
+        }
+
+        if (lbvh_query_ray_done(&r->blas_query)) {
+            r->blas_tlas_node = NULL;
+        }
+        return false;
+    }
+
+    if (lbvh_query_ray_done(&r->tlas_query)) {
+        return true;
+    }
+
+    u64 id = lbvh_query_ray_step(&r->tlas_query, in_ray, &r->interval);
+    if (id > 0) {
+        Assert(id <= tracer->tlas.node_count);
+        const RT_CPU_TLASNode* tlas_node = &tracer->tlas.nodes[id-1];
         const RT_Instance* instance = tlas_node->instance;
 
-        out_record->t = interval.max;
-        out_record->p = add_3f32(in_ray->origin, mul_3f32(in_ray->direction, out_record->t));
-        out_record->material = instance->material;
-        
-        // @todo flag on material showing which attributes are necessary for shading?
         switch (instance->type) {
             case RT_InstanceType_Sphere:{
-                const RT_SphereInstance* sphere_inst = &instance->sphere;
-
-                out_record->n = mul_3f32(sub_3f32(out_record->p, sphere_inst->center), 1.f/sphere_inst->radius);
+                if (geo_intersect_sphere(in_ray, instance->sphere.center, instance->sphere.radius, &r->interval)) {
+                    r->hit = true;
+                    r->hit_record.tlas_node = tlas_node;
+                }
             }break;
             case RT_InstanceType_Mesh:{
+                // descend into the blas on the next step, the root will be
+                // fetched while the other rays advance
                 const RT_MeshInstance* mesh_inst = &instance->mesh;
                 const RT_CPU_BLASNode* blas_node = tlas_node->blas_node;
                 const RT_Mesh* mesh = blas_node->mesh;
 
-                Assert(mesh->primitive == GEO_Primitive_TRI_LIST); // @todo
+                r->blas_tlas_node = tlas_node;
+                r->local_ray = rt_cpu_inv_transform_ray(*in_ray, mesh_inst->translation, mesh_inst->rotation, mesh_inst->scale);
+                r->blas_data = (RT_CPU_BLASNodeData){
+                    .hit_record = {},
+                    .p_start = OffsetPtr(mesh->vertices, geo_vertex_offset(mesh->attrs, GEO_VertexAttributes_P), GEO_VertexType_P),
+                    .p_stride = geo_vertex_stride(mesh->attrs, GEO_VertexAttributes_P),
+                    .auto_index = blas_node->auto_index,
+                    .mesh = mesh,
+                };
+                lbvh_query_ray_begin(&r->blas_query, &blas_node->lbvh);
+            }break;
+        }
+    }
 
-                vec3_f32 v0,v1,v2;
-                rt_cpu_get_tri(blas_node, GEO_VertexAttributes_P, hit_record->tri_idx, &v0, &v1, &v2);
-
-                vec3_f32 tri_n;
-                if (mesh->attrs & GEO_VertexAttributes_N) {
-                    vec3_f32 n0,n1,n2;
-                    rt_cpu_get_tri(blas_node, GEO_VertexAttributes_N, hit_record->tri_idx, &n0, &n1, &n2);
-                    tri_n = add_3f32(add_3f32(
-                        mul_3f32(n0, hit_record->uv.U),
-                        mul_3f32(n1, hit_record->uv.V)),
-                        mul_3f32(n2, 1 - hit_record->uv.U - hit_record->uv.V)
-                    );
-                } else {
-                    Assert(tracer->winding_order == GEO_WindingOrder_CCW);
-                    tri_n = cross_3f32(sub_3f32(v1, v0), sub_3f32(v2, v0));
-                }
+    return r->blas_tlas_node == NULL && lbvh_query_ray_done(&r->tlas_query);
+}
 
-                out_record->n = normalize_3f32(rt_cpu_transform_dir(tri_n, mesh_inst->rotation, mesh_inst->scale));
-            }
+static void rt_cpu_interleaved_ray_begin(RT_CPU_Tracer* tracer, RT_CPU_InterleavedRay* r, u64 ray_idx, rng_f32 interval) {
+    r->ray_idx = ray_idx;
+    r->interval = interval;
+    r->hit = false;
+    r->blas_tlas_node = NULL;
+    lbvh_query_ray_begin(&r->tlas_query, &tracer->tlas.lbvh);
+}
+
+// @note produces the same hits as calling rt_cpu_intersect on each ray
+internal void rt_cpu_intersect_interleaved(RT_CPU_Tracer* tracer, const rng3_f32* in_rays, const rng_f32* in_intervals, RT_CPU_HitRecord* out_records, bool* out_hits, u64 count) {
+    RT_CPU_InterleavedRay lanes[RT_CPU_INTERLEAVE_LANES];
+    bool lanes_active[RT_CPU_INTERLEAVE_LANES];
+    u64 active_count = 0;
+    u64 next_ray_idx = 0;
+
+    for EachIndex(lane, RT_CPU_INTERLEAVE_LANES) {
+        lanes_active[lane] = next_ray_idx < count;
+        if (lanes_active[lane]) {
+            rt_cpu_interleaved_ray_begin(tracer, &lanes[lane], next_ray_idx, in_intervals[next_ray_idx]);
+            next_ray_idx++;
+            active_count++;
         }
     }
 
-    return hit;
+    // round robin one node per ray, a lane is refilled as soon as its ray finishes
+    while (active_count > 0) {
+        for EachIndex(lane, RT_CPU_INTERLEAVE_LANES) {
+            RT_CPU_InterleavedRay* r = &lanes[lane];
+            if (!lanes_active[lane]) {
+                continue;
+            }
+
+            const rng3_f32* ray = &in_rays[r->ray_idx];
+            if (!rt_cpu_interleaved_ray_step(tracer, ray, r)) {
+                continue;
+            }
+
+            out_hits[r->ray_idx] = r->hit;
+            if (r->hit) {
+                rt_cpu_resolve_hit_record(tracer, ray, r->interval.max, &r->hit_record, &out_records[r->ray_idx]);
+            }
+
+            if (next_ray_idx < count) {
+                rt_cpu_interleaved_ray_begin(tracer, r, next_ray_idx, in_intervals[next_ray_idx]);
+                next_ray_idx++;
+            } else {
+                lanes_active[lane] = false;
+                active_count--;
+            }
+        }
+    }
 }
 
 static bool rt_cpu_blas_node_hit(u64 id, const rng3_f32* in_ray, rng_f32* inout_t_interval, void* _data) {
@@ -546,9 +2268,9 @@ static vec3_f32 rt_cpu_transform_uvw_to_hemisphere(vec3_f32 s, vec3_f32 n) {
     );
 }
 
-internal vec3_f32 rt_cpu_cosine_sample_hemisphere(vec3_f32 n) {
-    f32 r1 = rand_unit_f32();
-    f32 r2 = rand_unit_f32();
+internal vec3_f32 rt_cpu_cosine_sample_hemisphere(vec3_f32 n, vec2_f32 r) {
+    f32 r1 = r.x;
+    f32 r2 = r.y;
 
     f32 phi = 2*PI_F32*r1;
     f32 u = cos_f32(phi)*sqrt_f32(r2);
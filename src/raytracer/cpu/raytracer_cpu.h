@@ -1,5 +1,7 @@
 #pragma once
 
+typedef struct RT_CPU_TLASNode RT_CPU_TLASNode;
+
 typedef struct RT_CPU_HitRecord RT_CPU_HitRecord;
 struct RT_CPU_HitRecord {
     vec3_f32 p;
@@ -7,6 +9,10 @@ struct RT_CPU_HitRecord {
     f32 t;
 
     RT_Handle material;
+
+    // identifies the primitive, e.g. to find its entry in the light table
+    const RT_CPU_TLASNode* tlas_node;
+    u32 tri_idx;
 };
 
 typedef struct RT_CPU_BLASNode RT_CPU_BLASNode;
@@ -22,55 +28,393 @@ struct RT_CPU_BLAS {
     u64 node_count;
 };
 
-typedef struct RT_CPU_TLASNode RT_CPU_TLASNode;
+#define RT_CPU_NO_LIGHT MAX_U64
+
 struct RT_CPU_TLASNode {
     const RT_Instance* instance;
     RT_CPU_BLASNode* blas_node;
+
+    // index of the first light of this instance (one per triangle for meshes)
+    u64 light_offset;
+};
+
+typedef enum RT_CPU_LightType {
+    RT_CPU_LightType_Tri,
+    RT_CPU_LightType_Sphere,
+    RT_CPU_LightType_Count ENUM_CASE_UNUSED,
+} RT_CPU_LightType;
+
+// emissive primitive in world space, lights are two-sided
+typedef struct RT_CPU_Light RT_CPU_Light;
+struct RT_CPU_Light {
+    RT_CPU_LightType type;
+    union {
+        struct {
+            vec3_f32 v0;
+            vec3_f32 v1;
+            vec3_f32 v2;
+            vec3_f32 n;
+        } tri;
+        struct {
+            vec3_f32 center;
+            f32 radius;
+        } sphere;
+    };
+    vec3_f32 emissive;
+    f32 area;
+    f32 power;
 };
 
+typedef struct RT_CPU_LightTable RT_CPU_LightTable;
+struct RT_CPU_LightTable {
+    RT_CPU_Light* lights;
+    f32* power_cdf;
+    u64 count;
+    f32 total_power;
+};
+
+// bounds of the lights below a node, the orientation cone holds the emitter
+// normals (cos_theta_o = -1 covers every direction)
+typedef struct RT_CPU_LightTreeNode RT_CPU_LightTreeNode;
+struct RT_CPU_LightTreeNode {
+    rng3_f32 aabb;
+    vec3_f32 axis;
+    f32 cos_theta_o;
+    f32 power;
+
+    u32 parent;
+    // @note child node indices, leaves store their light index in children[0]
+    u32 children[2];
+    bool leaf;
+};
+
+typedef struct RT_CPU_LightTree RT_CPU_LightTree;
+struct RT_CPU_LightTree {
+    RT_CPU_LightTreeNode* nodes;
+    u64 node_count;
+
+    // leaf node of each light, used to walk back up when evaluating the pmf
+    u32* light_nodes;
+};
+
+#define RT_CPU_LIGHT_TREE_ROOT 0
+
 typedef struct RT_CPU_TLAS RT_CPU_TLAS;
 struct RT_CPU_TLAS {
     LBVH_Tree lbvh;
     RT_CPU_TLASNode* nodes;
     u64 node_count;
+
+    RT_CPU_LightTable lights;
+    RT_CPU_LightTree light_tree;
+};
+
+// running estimate of a pixel, luminance variance is tracked with welford's
+// algorithm to decide where adaptive sampling spends more samples
+typedef struct RT_CPU_PixelEstimate RT_CPU_PixelEstimate;
+struct RT_CPU_PixelEstimate {
+    vec3_f32 mean;
+    f32 luminance_mean;
+    f32 luminance_m2;
+    u32 count;
+};
+
+// where the pixels of a cast go, the pixels in rect are traced and pixel (x, y)
+// of the image is at (y - buffer.y0)*stride + x - buffer.x0 of the buffers
+typedef struct RT_CPU_Target RT_CPU_Target;
+struct RT_CPU_Target {
+    int width;
+    int height;
+    RT_PixelRect rect;
+    RT_PixelRect buffer;
+    int stride;
+};
+
+// which aov sums follow the estimates in a checkpoint
+typedef enum RT_CPU_CheckpointAOVs {
+    RT_CPU_CheckpointAOVs_ZERO   = 0,
+    RT_CPU_CheckpointAOVs_Albedo = 1 << 0,
+    RT_CPU_CheckpointAOVs_Normal = 1 << 1,
+    RT_CPU_CheckpointAOVs_Depth  = 1 << 2,
+} RT_CPU_CheckpointAOVs;
+
+// a checkpoint file is this header, the RT_CPU_PixelEstimate of every traced
+// pixel and then every aov sum it has, all in native byte order. a pixel's sampler
+// is fully determined by the settings and its sample count
+typedef struct RT_CPU_CheckpointHeader RT_CPU_CheckpointHeader;
+struct RT_CPU_CheckpointHeader {
+    u32 magic;
+    u32 version;
+    // of everything that changes what a sample adds, see rt_cpu_checkpoint_hash
+    u32 settings_hash;
+    u32 width;
+    u32 height;
+    u32 sample_count;
+    u32 aovs;
+    u32 reserved;
+};
+
+#define RT_CPU_CHECKPOINT_MAGIC 0x4b435452 // "RTCK"
+#define RT_CPU_CHECKPOINT_VERSION 1
+
+// copy of a session being written to disk
+typedef struct RT_CPU_Checkpoint RT_CPU_Checkpoint;
+struct RT_CPU_Checkpoint {
+    RT_CPU_CheckpointHeader header;
+    u64 pixel_count;
+    RT_CPU_PixelEstimate* estimates;
+    RT_CastAOVs aov_sums;
+
+    NTString8 path;
+    NTString8 temp_path;
+    OS_Handle thread;
+};
+
+// progressive render, see rt_tracer_begin_accumulation
+typedef struct RT_CPU_Accumulation RT_CPU_Accumulation;
+struct RT_CPU_Accumulation {
+    RT_CastSettings settings;
+    // the estimates and sums cover the rect of target
+    RT_CPU_Target target;
+    u32 sample_count;
+
+    RT_CPU_PixelEstimate* estimates;
+    // sums of the first hit aovs the settings asked for
+    RT_CastAOVs aov_sums;
+
+    f64 last_checkpoint;
+    // allocated with the first checkpoint of the session
+    RT_CPU_Checkpoint* checkpoint;
 };
 
 typedef struct RT_CPU_Tracer RT_CPU_Tracer;
+#define RT_CPU_BVH_ARENA_RESERVE GB(4)
+// @note only address space, chunks past it are reserved on their own
+#define RT_CPU_BLAS_LANES_RESERVE GB(64)
+#define RT_CPU_BLAS_LANE_CHUNK_SIZE KB(64)
+
+typedef struct RT_CPU_BLASBuild RT_CPU_BLASBuild;
+struct RT_CPU_BLASBuild {
+    RT_CPU_Tracer* tracer;
+    const RT_Mesh* mesh;
+    // made in mesh order by rt_tracer_begin_build
+    Arena* lane;
+    JOB_Task* task;
+};
+
 struct RT_CPU_Tracer {
     Arena* arena;
     u8 max_bounces;
     GEO_WindingOrder winding_order;
     bool sky;
+    RT_TraversalMode traversal;
+    bool russian_roulette;
+    bool next_event_estimation;
+    RT_LightSampling light_sampling;
 
+    // the bvh arenas reserve their address space up front
+    ArenaFlags bvh_arena_flags;
     Arena* tlas_arena;
     RT_CPU_TLAS tlas;
 
     Arena* blas_arena;
     RT_CPU_BLAS blas;
+    // scheduled builds push their lbvh into lanes of this
+    ArenaConcurrent* blas_lanes;
+
+    // see rt_tracer_begin_build, one build per blas node
+    JOB_Graph* build_graph;
+    RT_World* build_world;
+    RT_CPU_BLASBuild* blas_builds;
+
+    Arena* accumulation_arena;
+    RT_CPU_Accumulation accumulation;
+
+    Arena* checkpoint_arena;
+    NTString8 checkpoint_path;
+    NTString8 checkpoint_temp_path;
+    f64 checkpoint_interval;
+};
+
+// what the camera ray hit, see RT_CastAOVs
+typedef struct RT_CPU_FirstHit RT_CPU_FirstHit;
+struct RT_CPU_FirstHit {
+    vec3_f32 albedo;
+    vec3_f32 normal;
+    f32 depth;
 };
 
 typedef struct RT_CPU_TraceContext RT_CPU_TraceContext;
 struct RT_CPU_TraceContext {
+    RT_CPU_Sampler sampler;
     u8 ior_count;
     f32 ior[RT_MAX_MAX_BOUNCES];
+
+    // written by rt_cpu_trace_path
+    RT_CPU_FirstHit first_hit;
+    u32 ray_count;
+};
+
+#define RT_CPU_TILE_SIZE 32
+
+// band of a streamed cast, full once rendered until it was written
+typedef struct RT_CPU_Band RT_CPU_Band;
+struct RT_CPU_Band {
+    void* pixels;
+    int y;
+    int rows;
+    bool full;
+};
+
+typedef struct RT_CPU_Stream RT_CPU_Stream;
+struct RT_CPU_Stream {
+    RT_StreamSettings settings;
+    RT_CPU_Band* bands;
+    u32 band_count;
+
+    // guarded by the mutex, signaled when a band fills up or empties
+    OS_Handle mutex;
+    OS_Handle cv;
+    u32 bands_total;
+};
+
+#define RT_CPU_STREAM_BAND_HEIGHT RT_CPU_TILE_SIZE
+// one band renders while the one before it is written
+#define RT_CPU_STREAM_BAND_COUNT 2
+
+// a cast split into tiles, the mutex is only set for asynchronous casts
+typedef struct RT_CPU_CastJob RT_CPU_CastJob;
+struct RT_CPU_CastJob {
+    RT_CPU_Tracer* tracer;
+    RT_CastSettings settings;
+    vec3_f32* out_radiance;
+    // set instead of out_radiance for packed casts
+    PixelFormat format;
+    void* out_pixels;
+    RT_CPU_Target target;
+    u32 tiles_x;
+    u32 tile_count;
+
+    RT_CastProgressFunction* progress;
+    void* user_data;
+    OS_Handle thread;
+    f64 start;
+
+    // guarded by the mutex
+    OS_Handle mutex;
+    u32 tiles_done;
+    u64 ray_count;
+    bool cancelled;
+    RT_CastStatus status;
+};
+
+// result of shading a hit, the path continues along ray if scattered
+typedef struct RT_CPU_ScatterRecord RT_CPU_ScatterRecord;
+struct RT_CPU_ScatterRecord {
+    vec3_f32 emitted;
+    vec3_f32 direct;
+    vec3_f32 attenuation;
+    rng3_f32 ray;
+
+    // solid angle pdf of ray, emission found along it is weighted against
+    // light sampling when mis is set
+    f32 pdf;
+    bool mis;
+};
+
+typedef struct RT_CPU_LightSample RT_CPU_LightSample;
+struct RT_CPU_LightSample {
+    vec3_f32 p;
+    vec3_f32 n;
+    const RT_CPU_Light* light;
+    f32 pmf;
+};
+
+// first hit of a path when it was already found, e.g. by interleaved traversal
+typedef struct RT_CPU_PrimaryHit RT_CPU_PrimaryHit;
+struct RT_CPU_PrimaryHit {
+    bool hit;
+    RT_CPU_HitRecord record;
 };
 
+// error of dark pixels is relative to this so noise that vanishes after
+// tonemapping doesn't soak up the budget
+#define RT_CPU_ADAPTIVE_MIN_LUMINANCE 0.05f
+#define RT_CPU_ADAPTIVE_MIN_SAMPLES 2
+
+// rows of an accumulation pass are handed out in chunks of this many
+#define RT_CPU_ACCUMULATE_ROW_GRAIN 4
+// pixels of an adaptive round are handed out in chunks of this many
+#define RT_CPU_ADAPTIVE_PIXEL_GRAIN 64
+
+typedef struct RT_CPU_AccumulatePass RT_CPU_AccumulatePass;
+struct RT_CPU_AccumulatePass {
+    RT_CPU_Tracer* tracer;
+    u32 samples;
+};
+
+// paths shorter than this are never terminated by russian roulette
+#define RT_CPU_ROULETTE_MIN_BOUNCES 3
+#define RT_CPU_ROULETTE_MIN_TERMINATION 0.05f
+
 internal RT_CPU_Tracer* rt_cpu_handle_to_tracer(RT_Handle handle);
 internal RT_Handle      rt_cpu_tracer_to_handle(RT_CPU_Tracer* tracer);
+internal RT_CPU_CastJob* rt_cpu_handle_to_cast_job(RT_Handle handle);
+internal RT_Handle       rt_cpu_cast_job_to_handle(RT_CPU_CastJob* job);
 
 // ============================================================================
 // acceleration structures
 // ============================================================================
 internal void rt_cpu_build_blas(RT_CPU_BLAS* out_blas, Arena* arena, RT_World* world);
 internal void rt_cpu_build_tlas(RT_CPU_TLAS* out_tlas, Arena* arena, const RT_CPU_BLAS* in_blas, RT_World* world);
+internal void rt_cpu_build_light_table(RT_CPU_LightTable* out_lights, Arena* arena, RT_CPU_TLAS* inout_tlas, RT_World* world);
+internal void rt_cpu_build_light_tree(RT_CPU_LightTree* out_tree, Arena* arena, const RT_CPU_LightTable* in_lights);
+
+// ============================================================================
+// lights
+// ============================================================================
+internal bool     rt_cpu_sample_light(RT_CPU_Tracer* tracer, vec3_f32 p, vec3_f32 n, f32 u_light, vec2_f32 u_point, RT_CPU_LightSample* out_sample);
+internal f32      rt_cpu_light_pmf(RT_CPU_Tracer* tracer, vec3_f32 p, vec3_f32 n, const RT_CPU_Light* light);
+internal f32      rt_cpu_light_tree_importance(const RT_CPU_LightTreeNode* node, vec3_f32 p, vec3_f32 n);
+internal f32      rt_cpu_light_pdf(const RT_CPU_Light* light, f32 pmf, vec3_f32 from, vec3_f32 p, vec3_f32 n);
+internal const RT_CPU_Light* rt_cpu_hit_to_light(const RT_CPU_LightTable* lights, const RT_CPU_HitRecord* in_record);
+internal vec3_f32 rt_cpu_sample_direct(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const RT_CPU_HitRecord* in_record, vec3_f32 brdf);
 
 // ============================================================================
 // cpu kernels
 // ============================================================================
+internal RT_CPU_Target rt_cpu_make_target(const RT_CastSettings* settings, int width, int height);
+internal u64      rt_cpu_target_index(const RT_CPU_Target* target, int x, int y);
 internal void     rt_cpu_raygen(RT_CPU_Tracer* tracer, const RT_CastSettings* settings, vec3_f32* out_radiance, int width, int height);
-internal vec3_f32 rt_cpu_trace_ray(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const rng3_f32* in_ray, u8 depth, rng_f32 interval, RT_CPU_HitRecord* out_record);
-internal vec3_f32 rt_cpu_closest_hit(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const rng3_f32* in_ray, u8 depth, RT_CPU_HitRecord* in_record);
-internal vec3_f32 rt_cpu_miss(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const rng3_f32* in_ray, u8 depth);
+internal void     rt_cpu_raygen_packed(RT_CPU_Tracer* tracer, const RT_CastSettings* settings, PixelFormat format, void* out_pixels, int width, int height);
+internal void     rt_cpu_stream_writer_main(void* data);
+internal u64      rt_cpu_raygen_tile(RT_CPU_Tracer* tracer, const RT_CastSettings* settings, vec3_f32* out_radiance, const RT_CPU_Target* target, RT_PixelRect tile);
+internal void     rt_cpu_raygen_tiles(void* data, u64 begin, u64 end);
+internal void     rt_cpu_cast_job_init(RT_CPU_CastJob* job, RT_CPU_Tracer* tracer, const RT_CastSettings* settings, vec3_f32* out_radiance, int width, int height);
+internal void     rt_cpu_cast_job_main(void* data);
+internal void     rt_cpu_raygen_adaptive(RT_CPU_Tracer* tracer, const RT_CastSettings* settings, vec3_f32* out_radiance, const RT_CPU_Target* target);
+internal void     rt_cpu_sample_pixel(RT_CPU_Tracer* tracer, const RT_CastSettings* settings, const RT_CPU_Target* target, const RT_CastAOVs* aovs, int x, int y, u32 samples, RT_CPU_PixelEstimate* inout_estimate);
+internal void     rt_cpu_accumulate_rows(void* data, u64 begin, u64 end);
+internal void     rt_cpu_accumulation_reset(RT_CPU_Tracer* tracer, const RT_CastSettings* settings, int width, int height);
+
+// ============================================================================
+// checkpoints
+// ============================================================================
+internal u32  rt_cpu_checkpoint_hash(const RT_CPU_Tracer* tracer, const RT_CastSettings* settings);
+internal u32  rt_cpu_checkpoint_aovs(const RT_CastAOVs* aov_sums);
+internal void rt_cpu_checkpoint_begin(RT_CPU_Tracer* tracer);
+internal void rt_cpu_checkpoint_wait(RT_CPU_Tracer* tracer);
+internal void rt_cpu_checkpoint_write(void* data);
+internal bool rt_cpu_checkpoint_read(RT_CPU_Tracer* tracer, NTString8 path);
+internal void     rt_cpu_pixel_estimate_add(RT_CPU_PixelEstimate* inout_estimate, vec3_f32 radiance);
+internal f32      rt_cpu_pixel_estimate_error(const RT_CPU_PixelEstimate* estimate);
+internal bool     rt_cpu_wants_aovs(const RT_CastAOVs* aovs);
+internal void     rt_cpu_aovs_add(const RT_CastAOVs* aovs, u64 pixel, const RT_CPU_FirstHit* first_hit, vec3_f32 radiance);
+internal void     rt_cpu_aovs_resolve(const RT_CastAOVs* aovs, u64 pixel, u32 sample_count, vec3_f32 mean);
+internal rng3_f32 rt_cpu_primary_ray(const RT_CastSettings* settings, RT_CPU_Sampler* sampler, int x, int y, int width, int height);
+internal vec3_f32 rt_cpu_trace_path(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const rng3_f32* in_ray, const RT_CPU_PrimaryHit* in_primary);
+internal bool     rt_cpu_closest_hit(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const rng3_f32* in_ray, RT_CPU_HitRecord* in_record, RT_CPU_ScatterRecord* out_scatter);
+internal vec3_f32 rt_cpu_miss(RT_CPU_Tracer* tracer, RT_CPU_TraceContext* ctx, const rng3_f32* in_ray);
 
 // ============================================================================
 // intersection
@@ -103,13 +447,35 @@ struct RT_CPU_BLASNodeData {
     const RT_Mesh* mesh;
 };
 
+// state of a single ray during interleaved traversal, while inside a blas
+// blas_tlas_node is set and the local ray/query are live
+typedef struct RT_CPU_InterleavedRay RT_CPU_InterleavedRay;
+struct RT_CPU_InterleavedRay {
+    u64 ray_idx;
+    rng_f32 interval;
+    bool hit;
+    RT_CPU_TLASHitRecord hit_record;
+
+    LBVH_RayQuery tlas_query;
+
+    const RT_CPU_TLASNode* blas_tlas_node;
+    rng3_f32 local_ray;
+    RT_CPU_BLASNodeData blas_data;
+    LBVH_RayQuery blas_query;
+};
+
+// number of traversals each thread keeps in flight
+#define RT_CPU_INTERLEAVE_LANES 16
+
 internal bool rt_cpu_intersect(RT_CPU_Tracer* tracer, const rng3_f32* in_ray, rng_f32 interval, RT_CPU_HitRecord* out_record);
+internal void rt_cpu_intersect_interleaved(RT_CPU_Tracer* tracer, const rng3_f32* in_rays, const rng_f32* in_intervals, RT_CPU_HitRecord* out_records, bool* out_hits, u64 count);
+internal void rt_cpu_resolve_hit_record(RT_CPU_Tracer* tracer, const rng3_f32* in_ray, f32 t, const RT_CPU_TLASHitRecord* in_hit_record, RT_CPU_HitRecord* out_record);
 internal bool rt_cpu_intersect_tlas_node(const RT_CPU_TLASNode* tlas_node, const rng3_f32* in_ray, rng_f32* inout_t_interval, RT_CPU_TLASHitRecord* out_record);
 
 // ============================================================================
 // helpers
 // ============================================================================
-internal vec3_f32 rt_cpu_cosine_sample_hemisphere(vec3_f32 normal);
+internal vec3_f32 rt_cpu_cosine_sample_hemisphere(vec3_f32 normal, vec2_f32 r);
 
 internal f32 rt_cpu_fresnel_schlick(f32 eta_i, f32 eta_t, f32 cos_theta);
 internal vec3_f32 rt_cpu_normal_to_radiance(vec3_f32 normal);
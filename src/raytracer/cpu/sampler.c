@@ -0,0 +1,191 @@
+// ============================================================================
+// sampler
+// ============================================================================
+// @note keeps results below 1 since floats round up near it
+#define RT_CPU_U32_TO_UNIT_F32(x) ((f32)((x) >> 8)*(1.f/16777216.f))
+
+// generators of the rank-1 lattices in 0.32 fixed point so the fractional
+// part is exact, golden ratio and its 2d generalisation (R2, see Roberts 2018
+// "The Unreasonable Effectiveness of Quasirandom Sequences")
+#define RT_CPU_R1_ALPHA   2654435769u // 0.6180339887
+#define RT_CPU_R2_ALPHA_X 3242174889u // 0.7548776662
+#define RT_CPU_R2_ALPHA_Y 2447445413u // 0.5698402910
+
+internal u32 rt_cpu_hash_u32(u32 x) {
+    // lowbias32
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+internal u32 rt_cpu_hash_combine_u32(u32 seed, u32 v) {
+    return seed ^ (rt_cpu_hash_u32(v) + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+}
+
+// first two sobol dimensions, the rest are padded by shuffling in
+// rt_cpu_shuffled_scrambled_sobol_2d
+internal u32 rt_cpu_sobol_u32(u32 index, u32 dimension) {
+    Assert(dimension < 2);
+    if (dimension == 0) {
+        return reverse_bits_u32(index);
+    }
+
+    // the generator matrix of x + 1 is pascal's triangle mod 2, bit j (from the
+    // top) is the parity of the set index bits k that are supersets of j,
+    // summed over the 5 bits of k instead of looping over index bits
+    u32 x = index;
+    x ^= (x >> 1)  & 0x55555555u;
+    x ^= (x >> 2)  & 0x33333333u;
+    x ^= (x >> 4)  & 0x0f0f0f0fu;
+    x ^= (x >> 8)  & 0x00ff00ffu;
+    x ^= (x >> 16) & 0x0000ffffu;
+    return reverse_bits_u32(x);
+}
+
+static u32 rt_cpu_laine_karras_permutation_u32(u32 x, u32 seed) {
+    x += seed;
+    x ^= x*0x6c50b47cu;
+    x ^= x*0xb82f1e52u;
+    x ^= x*0xc7afe638u;
+    x ^= x*0x8d22f6e6u;
+    return x;
+}
+
+internal u32 rt_cpu_nested_uniform_scramble_u32(u32 x, u32 seed) {
+    x = reverse_bits_u32(x);
+    x = rt_cpu_laine_karras_permutation_u32(x, seed);
+    x = reverse_bits_u32(x);
+    return x;
+}
+
+internal vec2_f32 rt_cpu_shuffled_scrambled_sobol_2d(u32 index, u32 seed) {
+    // shuffling the index decorrelates dimensions that share the same two
+    // sobol dimensions while each stays a (0,2)-sequence
+    // @note only the top 24 bits end up in a float and owen scrambling never
+    // moves low bits up, index bits from 24 on only reach those low bits
+    index = rt_cpu_nested_uniform_scramble_u32(index, seed) & 0x00ffffffu;
+
+    // @perf same as scrambling rt_cpu_sobol_u32 with the reversals that cancel
+    // out dropped
+    u32 x = index;
+    u32 y = reverse_bits_u32(rt_cpu_sobol_u32(index, 1));
+    x = reverse_bits_u32(rt_cpu_laine_karras_permutation_u32(x, rt_cpu_hash_combine_u32(seed, 0)));
+    y = reverse_bits_u32(rt_cpu_laine_karras_permutation_u32(y, rt_cpu_hash_combine_u32(seed, 1)));
+    return make_2f32(RT_CPU_U32_TO_UNIT_F32(x), RT_CPU_U32_TO_UNIT_F32(y));
+}
+
+internal RT_CPU_Sampler rt_cpu_make_sampler(RT_SamplerType type, u32 seed, u32 strata, u32 x, u32 y, u32 sample_index) {
+    return (RT_CPU_Sampler){
+        .type = type,
+        .seed = rt_cpu_hash_combine_u32(rt_cpu_hash_combine_u32(rt_cpu_hash_u32(seed), x), y),
+        .x = x,
+        .y = y,
+        .sample_index = sample_index,
+        .bounce = 0,
+        .strata = Max(strata, 1u),
+    };
+}
+
+static u32 rt_cpu_sampler_dimension(const RT_CPU_Sampler* sampler, RT_CPU_SampleDimension dimension) {
+    u32 d = (u32)dimension;
+    if (d >= RT_CPU_SAMPLE_PATH_DIMENSIONS) {
+        d += sampler->bounce*RT_CPU_SAMPLE_BOUNCE_DIMENSIONS;
+    }
+    return d;
+}
+
+// blue noise dither of the pixel in 0.32 fixed point, shifted per dimension so
+// dimensions don't share a pattern
+static void rt_cpu_sampler_blue_noise_offset(const RT_CPU_Sampler* sampler, u32 d, u32* out_a, u32* out_b) {
+    u32 shift = rt_cpu_hash_u32(d);
+    u32 x = sampler->x + (shift & 0xffff);
+    u32 y = sampler->y + (shift >> 16);
+
+    *out_a = x*RT_CPU_R2_ALPHA_X + y*RT_CPU_R2_ALPHA_Y;
+    *out_b = x*RT_CPU_R2_ALPHA_Y + y*RT_CPU_R2_ALPHA_X;
+}
+
+internal vec2_f32 rt_cpu_sampler_2d(RT_CPU_Sampler* sampler, RT_CPU_SampleDimension dimension) {
+    u32 d = rt_cpu_sampler_dimension(sampler, dimension);
+    switch (sampler->type) {
+        case RT_SamplerType_Random:{
+            u32 h = rt_cpu_hash_combine_u32(rt_cpu_hash_combine_u32(sampler->seed, sampler->sample_index), d);
+            return make_2f32(RT_CPU_U32_TO_UNIT_F32(rt_cpu_hash_u32(h)), RT_CPU_U32_TO_UNIT_F32(rt_cpu_hash_u32(h ^ 0x5bd1e995u)));
+        }break;
+        case RT_SamplerType_Sobol:{
+            return rt_cpu_shuffled_scrambled_sobol_2d(sampler->sample_index, rt_cpu_hash_combine_u32(sampler->seed, d));
+        }break;
+        case RT_SamplerType_BlueNoise:{
+            // rank-1 lattice over the samples of a pixel, rotated by the dither,
+            // every dimension walks it in a different order so they don't
+            // correlate (same for all pixels to keep the dither intact)
+            u32 index = rt_cpu_nested_uniform_scramble_u32(sampler->sample_index, rt_cpu_hash_u32(~d));
+            u32 a, b;
+            rt_cpu_sampler_blue_noise_offset(sampler, d, &a, &b);
+            a += index*RT_CPU_R2_ALPHA_X;
+            b += index*RT_CPU_R2_ALPHA_Y;
+            return make_2f32(RT_CPU_U32_TO_UNIT_F32(a), RT_CPU_U32_TO_UNIT_F32(b));
+        }break;
+    }
+
+    NotImplemented;
+    return make_2f32(0.f, 0.f);
+}
+
+internal f32 rt_cpu_sampler_1d(RT_CPU_Sampler* sampler, RT_CPU_SampleDimension dimension) {
+    if (sampler->type == RT_SamplerType_BlueNoise) {
+        u32 d = rt_cpu_sampler_dimension(sampler, dimension);
+        u32 index = rt_cpu_nested_uniform_scramble_u32(sampler->sample_index, rt_cpu_hash_u32(~d));
+        u32 a, b;
+        rt_cpu_sampler_blue_noise_offset(sampler, d, &a, &b);
+        return RT_CPU_U32_TO_UNIT_F32(a + index*RT_CPU_R1_ALPHA);
+    }
+    return rt_cpu_sampler_2d(sampler, dimension).x;
+}
+
+// position inside the pixel
+internal vec2_f32 rt_cpu_sampler_pixel(RT_CPU_Sampler* sampler) {
+    if (sampler->type != RT_SamplerType_Random) {
+        return rt_cpu_sampler_2d(sampler, RT_CPU_SampleDimension_Pixel);
+    }
+
+    // jittered over a strata x strata grid, a single sample stays centered
+    if (sampler->strata == 1) {
+        return make_2f32(0.5f, 0.5f);
+    }
+    u32 stratum = sampler->sample_index % (sampler->strata*sampler->strata);
+    vec2_f32 jitter = rt_cpu_sampler_2d(sampler, RT_CPU_SampleDimension_Pixel);
+    return make_2f32(
+        ((f32)(stratum % sampler->strata) + jitter.x)/(f32)sampler->strata,
+        ((f32)(stratum / sampler->strata) + jitter.y)/(f32)sampler->strata
+    );
+}
+
+// concentric mapping, keeps the stratification of u
+internal vec2_f32 rt_cpu_square_to_disk(vec2_f32 u) {
+    f32 a = 2.f*u.x - 1.f;
+    f32 b = 2.f*u.y - 1.f;
+    if (a == 0.f && b == 0.f) {
+        return make_2f32(0.f, 0.f);
+    }
+
+    f32 r, phi;
+    if (abs_f32(a) > abs_f32(b)) {
+        r = a;
+        phi = (PI_F32/4.f)*(b/a);
+    } else {
+        r = b;
+        phi = (PI_F32/2.f) - (PI_F32/4.f)*(a/b);
+    }
+    return make_2f32(r*cos_f32(phi), r*sin_f32(phi));
+}
+
+internal vec3_f32 rt_cpu_square_to_sphere(vec2_f32 u) {
+    f32 z = 1.f - 2.f*u.x;
+    f32 r = sqrt_f32(Max(0.f, 1.f - z*z));
+    f32 phi = 2.f*PI_F32*u.y;
+    return make_3f32(r*cos_f32(phi), r*sin_f32(phi), z);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// ============================================================================
+// sampler
+// ============================================================================
+// every random number of a path is addressed by (pixel, sample index, dimension)
+// so paths are reproducible and samplers can place points with respect to
+// other samples of the same pixel
+
+// @note per bounce dimensions are offset by the sampler's bounce so each
+// bounce of a path gets its own set
+typedef enum RT_CPU_SampleDimension {
+    // per path
+    RT_CPU_SampleDimension_Pixel        = 0, // 2d
+    RT_CPU_SampleDimension_Lens         = 2, // 2d
+
+    // per bounce
+    RT_CPU_SampleDimension_BSDF         = 4, // 2d
+    RT_CPU_SampleDimension_BSDFChoice   = 6,
+    RT_CPU_SampleDimension_LightChoice  = 7,
+    RT_CPU_SampleDimension_Light        = 8, // 2d
+    RT_CPU_SampleDimension_Roulette     = 10,
+    RT_CPU_SampleDimension_Count ENUM_CASE_UNUSED,
+} RT_CPU_SampleDimension;
+
+#define RT_CPU_SAMPLE_PATH_DIMENSIONS   RT_CPU_SampleDimension_BSDF
+#define RT_CPU_SAMPLE_BOUNCE_DIMENSIONS (RT_CPU_SampleDimension_Count - RT_CPU_SAMPLE_PATH_DIMENSIONS)
+
+typedef struct RT_CPU_Sampler RT_CPU_Sampler;
+struct RT_CPU_Sampler {
+    RT_SamplerType type;
+    u32 seed;
+    u32 x;
+    u32 y;
+    u32 sample_index;
+    u32 bounce;
+
+    // samples x samples grid the random sampler jitters over
+    u32 strata;
+};
+
+internal RT_CPU_Sampler rt_cpu_make_sampler(RT_SamplerType type, u32 seed, u32 strata, u32 x, u32 y, u32 sample_index);
+internal f32            rt_cpu_sampler_1d(RT_CPU_Sampler* sampler, RT_CPU_SampleDimension dimension);
+internal vec2_f32       rt_cpu_sampler_2d(RT_CPU_Sampler* sampler, RT_CPU_SampleDimension dimension);
+internal vec2_f32       rt_cpu_sampler_pixel(RT_CPU_Sampler* sampler);
+
+// owen scrambled sobol, see Burley 2020 "Practical Hash-based Owen Scrambling"
+internal u32      rt_cpu_sobol_u32(u32 index, u32 dimension);
+internal u32      rt_cpu_nested_uniform_scramble_u32(u32 x, u32 seed);
+internal vec2_f32 rt_cpu_shuffled_scrambled_sobol_2d(u32 index, u32 seed);
+
+internal u32      rt_cpu_hash_u32(u32 x);
+internal u32      rt_cpu_hash_combine_u32(u32 seed, u32 v);
+
+// warps from the unit square
+internal vec2_f32 rt_cpu_square_to_disk(vec2_f32 u);
+internal vec3_f32 rt_cpu_square_to_sphere(vec2_f32 u);
@@ -152,14 +152,79 @@ void      rt_world_cleanup(RT_World* world);
 // ============================================================================
 // tracer
 // ============================================================================
+typedef enum RT_TraversalMode {
+    RT_TraversalMode_Single,
+    // keeps several primary rays in flight and switches between them while
+    // node fetches are outstanding, useful when the bvh is larger than cache
+    RT_TraversalMode_Interleaved,
+    RT_TraversalMode_Count ENUM_CASE_UNUSED,
+} RT_TraversalMode;
+
+typedef enum RT_LightSampling {
+    // proportional to power, ignores where the shading point is
+    RT_LightSampling_Power,
+    // stochastic traversal of a light hierarchy, proportional to the estimated
+    // contribution at the shading point
+    RT_LightSampling_Tree,
+    RT_LightSampling_Count ENUM_CASE_UNUSED,
+} RT_LightSampling;
+
 struct RT_TracerSettings {
     u8 max_bounces;
     GEO_WindingOrder winding_order;
     bool sky;
+    RT_TraversalMode traversal;
+    // randomly terminates paths with low throughput, reweighting survivors
+    bool russian_roulette;
+    // samples emissive surfaces directly from diffuse hits, combined with
+    // brdf sampling through multiple importance sampling
+    bool next_event_estimation;
+    RT_LightSampling light_sampling;
+    // keeps the bvhs in huge pages, fewer tlb misses while tracing large scenes
+    bool large_pages;
 };
 
 #define RT_MAX_MAX_BOUNCES 64
 
+typedef enum RT_SamplerType {
+    // independent uniform random numbers, the pixel is jittered over a
+    // samples x samples grid
+    RT_SamplerType_Random,
+    // owen scrambled sobol points per pixel, converges faster than random
+    RT_SamplerType_Sobol,
+    // rank-1 lattice per pixel rotated by a blue noise dither, spreads the
+    // error of low sample counts over high frequencies
+    RT_SamplerType_BlueNoise,
+    RT_SamplerType_Count ENUM_CASE_UNUSED,
+} RT_SamplerType;
+
+// pixels [x0, x1) x [y0, y1) of an image
+typedef struct RT_PixelRect RT_PixelRect;
+struct RT_PixelRect {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
+// optional per pixel outputs written next to the radiance, as many entries as
+// out_radiance, NULL to skip
+typedef struct RT_CastAOVs RT_CastAOVs;
+struct RT_CastAOVs {
+    u32* sample_count;
+
+    // surface seen by the camera averaged over the pixel's samples: its
+    // reflectance (1 for misses, emitters and specular surfaces), normal and
+    // distance along the ray (both 0 for misses)
+    vec3_f32* albedo;
+    vec3_f32* normal;
+    f32* depth;
+
+    // variance of the pixel's luminance estimate, from the spread of its
+    // samples so it needs at least 2 of them
+    f32* variance;
+};
+
 typedef struct RT_CastSettings RT_CastSettings;
 struct RT_CastSettings {
     vec3_f32 eye;
@@ -169,16 +234,166 @@ struct RT_CastSettings {
     vec3_f32 viewport;
 
     u8 samples;
+    RT_SamplerType sampler;
+    u32 seed;
     f32 ior;
 
     bool defocus;
     vec2_f32 defocus_disk;
     
     bool orthographic;
+
+    // spends samples x samples (at least 2x2) on every pixel, then more in
+    // rounds on pixels whose relative standard error is above adaptive_error
+    // until they converge or the image has used adaptive_budget samples per
+    // pixel on average
+    bool adaptive;
+    f32 adaptive_error;
+    u32 adaptive_budget;
+
+    // only traces the pixels in crop_window, the camera still frames the whole
+    // width x height image. with crop_buffer out_radiance and the aovs are
+    // crop_window sized, otherwise they are image sized and the pixels outside
+    // of it are left alone
+    bool crop;
+    RT_PixelRect crop_window;
+    bool crop_buffer;
+
+    RT_CastAOVs aovs;
 };
 
 rt_hook RT_Handle rt_make_tracer(RT_TracerSettings settings);
 rt_hook void      rt_tracer_build_blas(RT_Handle handle, RT_World* world);
 rt_hook void      rt_tracer_build_tlas(RT_Handle handle, RT_World* world);
 rt_hook void      rt_tracer_cleanup(RT_Handle handle);
+// rt_tracer_build_blas and rt_tracer_build_tlas as tasks of graph. the blas of
+// a mesh is built once the task that fills it in finished, independent meshes
+// build in parallel and the tlas once the last blas is done. the meshes have
+// to be added to world before rt_tracer_begin_build, tasks may fill them in
+// later. the blas of meshes that are ready by then are laid out in mesh order,
+// those of meshes filled in later in the order their builds run. wait on graph
+// before casting
+rt_hook void      rt_tracer_begin_build(RT_Handle handle, RT_World* world, JOB_Graph* graph);
+// @note loaded fills in mesh, NULL when the mesh is ready
+rt_hook JOB_Task* rt_tracer_schedule_blas(RT_Handle handle, RT_Handle mesh, JOB_Task* loaded);
+// @note the blas of meshes that weren't scheduled are built with it, the
+// instances have to be added by now
+rt_hook JOB_Task* rt_tracer_schedule_tlas(RT_Handle handle);
 rt_hook void      rt_tracer_cast(RT_Handle tracer, RT_CastSettings settings, vec3_f32* out_radiance, int width, int height);
+// casts into a framebuffer of pixels in format, tiles are traced in f32 and
+// packed as they finish. unless the format is f32 the aovs and adaptive are
+// ignored
+rt_hook void      rt_tracer_cast_packed(RT_Handle tracer, RT_CastSettings settings, PixelFormat format, void* out_pixels, int width, int height);
+
+// ============================================================================
+// asynchronous casts
+// ============================================================================
+// the image is rendered in tiles on the job system while the caller carries on
+typedef struct RT_CastProgress RT_CastProgress;
+struct RT_CastProgress {
+    u32 tiles_done;
+    u32 tile_count;
+    f64 rays_per_second;
+};
+
+// called after every tile from the thread that rendered it, never by two
+// threads at once. it holds up the tiles finishing after it so keep it short
+typedef void RT_CastProgressFunction(void* user_data, RT_CastProgress progress);
+
+typedef enum RT_CastStatus {
+    RT_CastStatus_Running,
+    RT_CastStatus_Done,
+    RT_CastStatus_Cancelled,
+    RT_CastStatus_Count ENUM_CASE_UNUSED,
+} RT_CastStatus;
+
+// @note adaptive is ignored, its rounds span the whole image. the buffers have
+// to outlive the job and every job has to be waited on, that releases it
+rt_hook RT_Handle     rt_tracer_cast_async(RT_Handle tracer, RT_CastSettings settings, vec3_f32* out_radiance, int width, int height, RT_CastProgressFunction* progress, void* user_data);
+rt_hook RT_CastStatus rt_cast_poll(RT_Handle job);
+rt_hook RT_CastStatus rt_cast_wait(RT_Handle job);
+// tiles already started finish, the others are skipped and keep what the
+// buffers had. returns right away, wait for the tiles in flight
+rt_hook void          rt_cast_cancel(RT_Handle job);
+
+// ============================================================================
+// streamed casts
+// ============================================================================
+// the image is rendered in bands of rows from top to bottom, every finished
+// band is handed to write_band on a separate thread while the next ones render.
+// only band_count bands are held at a time, so memory doesn't grow with the
+// image height
+typedef void RT_BandFunction(void* user_data, int y, int rows, const void* pixels);
+
+typedef struct RT_StreamSettings RT_StreamSettings;
+struct RT_StreamSettings {
+    // 0 picks defaults
+    int band_height;
+    int band_count;
+    // of the bands, packed like rt_tracer_cast_packed
+    PixelFormat format;
+
+    RT_BandFunction* write_band;
+    void* user_data;
+};
+
+// @note the aovs are ignored. a crop window narrows the streamed image to it,
+// y is relative to its top
+rt_hook void rt_tracer_cast_streamed(RT_Handle tracer, RT_CastSettings settings, int width, int height, RT_StreamSettings stream);
+
+// ============================================================================
+// progressive rendering
+// ============================================================================
+// an accumulation session keeps a running estimate of every pixel on the
+// tracer, each call adds samples on top of it and the estimate can be resolved
+// in between. a pixel's samples continue its sequence where the last call left
+// off, so all samples of a session together are as stratified as one cast of
+// the same count
+// @note adaptive is ignored, samples only sets the jitter grid of the random
+// sampler. the aovs of settings are filled in by resolve
+rt_hook void rt_tracer_begin_accumulation(RT_Handle tracer, RT_CastSettings settings, int width, int height);
+// adds samples to every pixel, returns the samples per pixel so far
+rt_hook u32  rt_tracer_accumulate(RT_Handle tracer, u32 samples);
+// adds samples until seconds have passed, as many per call as fit in the time
+// that's left, returns the samples per pixel so far
+rt_hook u32  rt_tracer_accumulate_for(RT_Handle tracer, f64 seconds);
+rt_hook void rt_tracer_resolve_accumulation(RT_Handle tracer, vec3_f32* out_radiance);
+rt_hook void rt_tracer_end_accumulation(RT_Handle tracer);
+
+// every interval seconds of accumulation the session is snapshotted to path, a
+// session resumed from the file continues bit for bit as if it never stopped
+// @note the state is copied between two passes and streamed to disk by another
+// thread, the file is only replaced once the write completed. 0 turns it off
+rt_hook void rt_tracer_set_checkpoint(RT_Handle tracer, NTString8 path, f64 interval);
+// snapshots the session now, e.g. before a deadline
+rt_hook void rt_tracer_checkpoint(RT_Handle tracer);
+// begins a session from the checkpoint at path, false (and no session) when it
+// can't be read or was taken with other settings or size. the scene has to be
+// the same, that isn't checked
+rt_hook bool rt_tracer_resume_accumulation(RT_Handle tracer, RT_CastSettings settings, int width, int height, NTString8 path);
+
+// ============================================================================
+// denoiser
+// ============================================================================
+// edge-avoiding a-trous wavelet filter (Dammertz et al. 2010) of the radiance
+// divided by albedo, neighbours are weighted by how close their color, albedo,
+// normal and depth are to the pixel's
+typedef struct RT_DenoiseSettings RT_DenoiseSettings;
+struct RT_DenoiseSettings {
+    // the 5x5 kernel is spread twice as far every iteration, 5 covers 125x125
+    u8 iterations;
+
+    // falloffs, color is in standard deviations of the pixel's noise (which
+    // drops every iteration as the filter averages it away), depth is relative
+    // to the depth change across the kernel
+    f32 sigma_color;
+    f32 sigma_albedo;
+    f32 sigma_normal;
+    f32 sigma_depth;
+};
+
+#define RT_DENOISE_MAX_ITERATIONS 8
+
+// @note needs the albedo, normal and depth aovs, the noise is estimated from
+// the neighbourhood without the variance aov. out_radiance may be radiance
+rt_hook void rt_denoise(RT_DenoiseSettings settings, const vec3_f32* radiance, RT_CastAOVs aovs, vec3_f32* out_radiance, int width, int height);
@@ -1,7 +1,9 @@
 #include "raytracer_core.c"
 
 #if RT_BACKEND == RT_BACKEND_CPU
+    #include "cpu/sampler.c"
     #include "cpu/raytracer_cpu.c"
+    #include "cpu/denoiser.c"
 #else
     #error Raytracer backend not supported.
 #endif
\ No newline at end of file
@@ -6,7 +6,9 @@
 #define RT_BACKEND RT_BACKEND_CPU
 
 #if RT_BACKEND == RT_BACKEND_CPU
+    #include "cpu/sampler.h"
     #include "cpu/raytracer_cpu.h"
+    #include "cpu/denoiser.h"
 #else
     #error Raytracer backend not supported.
 #endif
\ No newline at end of file